@@ -12,122 +12,732 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+#include <cstring>
+#include <future>  // NOLINT
+
 #include "common/macros.h"
 
 namespace bustub {
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
-    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
+                                                     LogManager *log_manager, ReplacerType replacer_type)
+    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager, replacer_type) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
-    : pool_size_(pool_size),
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerType replacer_type)
+    : pool_size_(0),
       num_instances_(num_instances),
       instance_index_(instance_index),
-      next_page_id_(instance_index),
       disk_manager_(disk_manager),
       log_manager_(log_manager) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
   BUSTUB_ASSERT(
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
-  // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
+  BUSTUB_ASSERT(pool_size > 0, "the buffer pool needs at least one frame");
+  switch (replacer_type) {
+    case ReplacerType::LRU_K:
+      replacer_ = new LRUKReplacer(pool_size);
+      break;
+    case ReplacerType::CLOCK:
+      replacer_ = new ClockReplacer(pool_size);
+      break;
+    case ReplacerType::LRU:
+    default:
+      replacer_ = new LRUReplacer(pool_size);
+      break;
+  }
 
   // Initially, every page is in the free list.
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_.emplace_back(static_cast<int>(i));
+  GrowFrames(pool_size);
+  cleaner_thread_ = std::thread(&BufferPoolManagerInstance::RunPageCleaner, this);
+  for (int i = 0; i < PREFETCH_THREADS; i++) {
+    prefetch_threads_.emplace_back(&BufferPoolManagerInstance::RunPrefetcher, this);
+  }
+  if (enable_warm_restart) {
+    LoadHotPages();
   }
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
-  delete[] pages_;
+  {
+    std::scoped_lock latch(cleaner_latch_);
+    cleaner_stop_ = true;
+  }
+  cleaner_cv_.notify_one();
+  cleaner_thread_.join();
+  {
+    std::scoped_lock latch(prefetch_latch_);
+    prefetch_stop_ = true;
+  }
+  prefetch_cv_.notify_all();
+  for (auto &thread : prefetch_threads_) {
+    thread.join();
+  }
+  if (enable_warm_restart) {
+    SaveHotPgsImp();
+  }
   delete replacer_;
 }
 
-Page* BufferPoolManagerInstance::GetPage(frame_id_t frame_id) {
-    Page* pages = GetPages();
-    Page* page = pages + frame_id * PAGE_SIZE;
-    return page;
-}
-
 bool BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) {
   // Make sure you call DiskManager::WritePage!
-    frame_id_t frameId = page_table_[page_id];
-    Page* p = GetPage(frameId);
-    const char *page_data = p->GetData();
-    // PIN page First
-//    replacer_->Pin(frameId);
-    disk_manager_->WritePage(page_id, page_data);
-    return true;
+  auto latch = LockBufTab();
+  frame_id_t frame_id;
+  if (!page_table_.Find(page_id, &frame_id)) {
+    return false;
+  }
+  Page *page = GetFrame(frame_id);
+  FlushLogUpTo(page->GetLSN());
+  // Clear the flag before writing so that a concurrent unpin marking the page dirty again is not lost.
+  MarkClean(page);
+  BeginWriteBack(page_id);
+  disk_manager_->WritePage(page_id, page->GetData());
+  EndWriteBack(page_id);
+  return true;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
-  Page* pages = GetPages();
-  int poolSize = GetPoolSize();
-  for (int i = 0; i < poolSize; ++i) {
-      Page* cur = pages + i * PAGE_SIZE;
-      const char *page_data = cur->GetData();
-      disk_manager_->WritePage(cur->page_id_, page_data);
-  }
-}
-
-//Page* BufferPoolManagerInstance::GetFreeBufId()
-//{
-//    Pages* pages = GetPages();
-//    int poolSize = GetPoolSize();
-//    for (int i = 0; i < poolSize; ++i) {
-//        Pages* cur = pages + i * PAGE_SIZE;
-//        const char *page_data = cur->GetData();
-//        disk_manager_->WritePage(page_id, page_data);
-//    }
-//}
-Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) {
+  auto latch = LockBufTab();
+  std::vector<std::pair<page_id_t, frame_id_t>> resident;
+  page_table_.ForEach(
+      [&resident](page_id_t page_id, frame_id_t frame_id) { resident.emplace_back(page_id, frame_id); });
+  // Frames cannot be evicted while bufTabMutex is held, so the whole pool goes to disk as one batch, in which runs of
+  // consecutive pages are coalesced into single writes.
+  std::vector<std::pair<page_id_t, const char *>> pages;
+  pages.reserve(resident.size());
+  lsn_t max_lsn = INVALID_LSN;
+  for (const auto &[page_id, frame_id] : resident) {
+    Page *page = GetFrame(frame_id);
+    max_lsn = std::max(max_lsn, page->GetLSN());
+    MarkClean(page);
+    BeginWriteBack(page_id);
+    pages.emplace_back(page_id, page->GetData());
+  }
+  // One log flush covers the whole batch.
+  FlushLogUpTo(max_lsn);
+  disk_manager_->WritePages(std::move(pages));
+  for (const auto &[page_id, frame_id] : resident) {
+    EndWriteBack(page_id);
+  }
+}
+
+BufferPoolStats BufferPoolManagerInstance::GetStats() {
+  BufferPoolStats stats;
+  stats.fetch_hits_ = fetch_hits_.Load();
+  stats.fetch_misses_ = fetch_misses_.load(std::memory_order_relaxed);
+  stats.evictions_ = evictions_.load(std::memory_order_relaxed);
+  stats.eviction_writes_ = eviction_writes_;
+  stats.cleaner_writes_ = cleaner_writes_;
+  stats.new_page_failures_ = new_page_failures_.load(std::memory_order_relaxed);
+  stats.pinned_frames_high_water_ = pinned_frames_high_water_.load(std::memory_order_relaxed);
+  stats.latch_waits_ = latch_waits_.load(std::memory_order_relaxed);
+  stats.latch_wait_ns_ = latch_wait_ns_.load(std::memory_order_relaxed);
+  stats.miss_latency_ = miss_latency_.GetSnapshot();
+  return stats;
+}
+
+std::unique_lock<std::mutex> BufferPoolManagerInstance::LockBufTab() {
+  std::unique_lock latch(bufTabMutex, std::try_to_lock);
+  if (!latch.owns_lock()) {
+    // Only contended acquisitions pay for reading the clock.
+    auto start = std::chrono::steady_clock::now();
+    latch.lock();
+    auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    latch_waits_.fetch_add(1, std::memory_order_relaxed);
+    latch_wait_ns_.fetch_add(waited.count(), std::memory_order_relaxed);
+  }
+  return latch;
+}
+
+void BufferPoolManagerInstance::CountPinnedFrame() {
+  size_t pinned = ++num_pinned_frames_;
+  size_t high_water = pinned_frames_high_water_.load(std::memory_order_relaxed);
+  while (pinned > high_water &&
+         !pinned_frames_high_water_.compare_exchange_weak(high_water, pinned, std::memory_order_relaxed)) {
+  }
+}
+
+void BufferPoolManagerInstance::MarkDirty(Page *page) {
+  if (page->is_dirty_.exchange(true)) {
+    absorbed_writes_++;
+  } else if (++num_dirty_ > GetDirtyPageLimit()) {
+    cleaner_cv_.notify_one();
+  }
+}
+
+bool BufferPoolManagerInstance::MarkClean(Page *page) {
+  if (!page->is_dirty_.exchange(false)) {
+    return false;
+  }
+  num_dirty_--;
+  return true;
+}
+
+void BufferPoolManagerInstance::RunPageCleaner() {
+  std::unique_lock latch(cleaner_latch_);
+  while (!cleaner_stop_) {
+    cleaner_cv_.wait_for(latch, page_cleaner_interval,
+                         [this] { return cleaner_stop_ || num_dirty_ > GetDirtyPageLimit(); });
+    if (cleaner_stop_) {
+      break;
+    }
+    latch.unlock();
+    while (num_dirty_ > GetDirtyPageLimit() && CleanDirtyPages() > 0) {
+    }
+    latch.lock();
+  }
+}
+
+size_t BufferPoolManagerInstance::CleanDirtyPages() {
+  std::vector<page_id_t> dirty;
+  page_table_.ForEach([this, &dirty](page_id_t page_id, frame_id_t frame_id) {
+    if (GetFrame(frame_id)->IsDirty()) {
+      dirty.push_back(page_id);
+    }
+  });
+  // Sweep the file in one direction across rounds so that the writes stay as sequential as possible.
+  std::sort(dirty.begin(), dirty.end());
+  auto resume = std::partition_point(dirty.begin(), dirty.end(),
+                                     [this](page_id_t page_id) { return page_id <= cleaner_cursor_; });
+  std::rotate(dirty.begin(), resume, dirty.end());
+  size_t written = WriteBackPages(dirty, cleaner_batch_size_, &cleaner_cursor_);
+  cleaner_writes_ += written;
+  return written;
+}
+
+size_t BufferPoolManagerInstance::WriteBackPages(const std::vector<page_id_t> &page_ids, size_t max_pages,
+                                                 page_id_t *last_written) {
+  size_t written = 0;
+  // Every page is copied out under its read latch and pin, and written from the copy, so the batch can be in flight at
+  // once without holding on to any frame. A page with a write in flight waits for the next round.
+  std::vector<char> copies(std::min(max_pages, page_ids.size()) * PAGE_SIZE);
+  struct Write {
+    page_id_t page_id_;
+    frame_id_t frame_id_;
+    lsn_t clean_lsn_;
+    std::future<void> done_;
+  };
+  std::vector<Write> writes;
+  for (size_t i = 0; i < page_ids.size() && written < max_pages; i++) {
+    page_id_t page_id = page_ids[i];
+    frame_id_t frame_id;
+    // Pin the page so that it cannot be evicted while it is being written, but leave the replacer alone: writing a
+    // page back is not an access.
+    if (!PinResidentPage(page_id, &frame_id, true)) {
+      continue;
+    }
+    Page *page = GetFrame(frame_id);
+    page->RLatch();
+    // WAL: a page may only reach the disk after the log records that changed it.
+    bool logged = !enable_logging || log_manager_ == nullptr || page->GetLSN() <= log_manager_->GetPersistentLSN();
+    if (logged && TryBeginWriteBack(page_id)) {
+      if (MarkClean(page)) {
+        char *copy = copies.data() + written * PAGE_SIZE;
+        memcpy(copy, page->GetData(), PAGE_SIZE);
+        // The copy has every change logged so far, and changes from here on wait for the read latch.
+        lsn_t clean_lsn = GetCleanLSN();
+        writes.push_back({page_id, frame_id, clean_lsn, disk_manager_->WritePageAsync(page_id, copy)});
+        written++;
+        if (last_written != nullptr) {
+          *last_written = page_id;
+        }
+      } else {
+        EndWriteBack(page_id);
+      }
+    }
+    page->RUnlatch();
+    UnpinResidentPage(page_id, false, true);
+  }
+  for (auto &write : writes) {
+    write.done_.wait();
+    // Until the write has landed the page keeps its old recLSN. Eviction waits for the write, so the frame still holds
+    // the page.
+    frames_[write.frame_id_].rec_lsn_ = write.clean_lsn_;
+    EndWriteBack(write.page_id_);
+  }
+  return written;
+}
+
+std::vector<std::pair<page_id_t, lsn_t>> BufferPoolManagerInstance::GetDirtyPgTblImp() {
+  auto latch = LockBufTab();
+  std::vector<std::pair<page_id_t, frame_id_t>> resident;
+  page_table_.ForEach(
+      [&resident](page_id_t page_id, frame_id_t frame_id) { resident.emplace_back(page_id, frame_id); });
+  std::vector<std::pair<page_id_t, lsn_t>> table;
+  // The page cleaner registers its write before it marks the page clean, and updates the recLSN before it unregisters.
+  std::scoped_lock write_back_latch(write_back_latch_);
+  for (const auto &[page_id, frame_id] : resident) {
+    Page *page = GetFrame(frame_id);
+    // The pin count is read first: a page unpinned after a change was marked dirty before it was unpinned.
+    bool pinned = page->GetPinCount() > 0;
+    if (pinned || page->IsDirty() || write_back_pending_.count(page_id) > 0) {
+      table.emplace_back(page_id, frames_[frame_id].rec_lsn_.load());
+    }
+  }
+  return table;
+}
+
+size_t BufferPoolManagerInstance::FlushDirtyPgsImp(lsn_t rec_lsn, size_t max_pages) {
+  std::vector<page_id_t> page_ids;
+  std::vector<page_id_t> in_flight;
+  page_table_.ForEach([this, rec_lsn, &page_ids, &in_flight](page_id_t page_id, frame_id_t frame_id) {
+    if (frames_[frame_id].rec_lsn_ >= rec_lsn) {
+      return;
+    }
+    // The dirty flag is read first: the page cleaner registers its write before it marks the page clean, and a page
+    // keeps its recLSN until the write has landed.
+    if (GetFrame(frame_id)->IsDirty()) {
+      page_ids.push_back(page_id);
+    }
+    std::scoped_lock write_back_latch(write_back_latch_);
+    if (write_back_pending_.count(page_id) > 0) {
+      in_flight.push_back(page_id);
+    }
+  });
+  std::sort(page_ids.begin(), page_ids.end());
+  size_t written = WriteBackPages(page_ids, max_pages, nullptr);
+  if (written > 0) {
+    return written;
+  }
+  // Nothing is left to write, but writes of the page cleaner may still be in flight: they are waited for, and counted
+  // so that the caller comes back for the pages changed while they were.
+  for (page_id_t page_id : in_flight) {
+    WaitForWriteBack(page_id);
+  }
+  return in_flight.size();
+}
+
+void BufferPoolManagerInstance::PrefetchPgsImp(const std::vector<page_id_t> &page_ids, AccessHint hint) {
+  if (!prefetch_enabled_) {
+    return;
+  }
+  {
+    std::scoped_lock latch(prefetch_latch_);
+    for (auto page_id : page_ids) {
+      ValidatePageId(page_id);
+      // Prefetching more than the pool can hold would only evict pages that were prefetched earlier.
+      if (prefetch_queue_.size() >= pool_size_) {
+        break;
+      }
+      frame_id_t frame_id;
+      if (!page_table_.Find(page_id, &frame_id) && prefetch_pending_.insert(page_id).second) {
+        prefetch_queue_.emplace_back(page_id, hint);
+      }
+    }
+  }
+  prefetch_cv_.notify_all();
+}
+
+bool BufferPoolManagerInstance::ReadResidentPgImp(page_id_t page_id, const std::function<void(Page *)> &reader) {
+  frame_id_t frame_id;
+  // Looking at a page is not an access, so leave the replacer alone.
+  if (!PinResidentPage(page_id, &frame_id, true)) {
+    return false;
+  }
+  Page *page = GetFrame(frame_id);
+  page->RLatch();
+  reader(page);
+  page->RUnlatch();
+  UnpinResidentPage(page_id, false, true);
+  return true;
+}
+
+void BufferPoolManagerInstance::RunPrefetcher() {
+  std::unique_lock latch(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(latch, [this] { return prefetch_stop_ || !prefetch_queue_.empty(); });
+    if (prefetch_stop_) {
+      return;
+    }
+    std::vector<std::pair<page_id_t, AccessHint>> batch;
+    while (!prefetch_queue_.empty() && batch.size() < static_cast<size_t>(PREFETCH_BATCH_SIZE)) {
+      auto entry = prefetch_queue_.front();
+      prefetch_queue_.pop_front();
+      // Unless a fetch got to the page first.
+      if (prefetch_pending_.erase(entry.first) != 0) {
+        batch.push_back(entry);
+      }
+    }
+    if (batch.empty()) {
+      continue;
+    }
+    latch.unlock();
+    PrefetchBatch(batch);
+    latch.lock();
+  }
+}
+
+void BufferPoolManagerInstance::SaveHotPgsImp() {
+  std::vector<std::pair<int64_t, page_id_t>> resident;
+  page_table_.ForEach([this, &resident](page_id_t page_id, frame_id_t frame_id) {
+    resident.emplace_back(frames_[frame_id].last_access_.load(std::memory_order_relaxed), page_id);
+  });
+  std::sort(resident.begin(), resident.end(), std::greater<>());
+  std::vector<page_id_t> page_ids;
+  page_ids.reserve(resident.size());
+  for (const auto &entry : resident) {
+    page_ids.push_back(entry.second);
+  }
+  disk_manager_->WriteManifest(instance_index_, page_ids);
+}
+
+void BufferPoolManagerInstance::LoadHotPages() {
+  std::vector<page_id_t> page_ids;
+  for (auto page_id : disk_manager_->ReadManifest(instance_index_)) {
+    // The manifest may come from a pool split into a different number of instances.
+    if (page_id >= 0 && static_cast<uint32_t>(page_id) % num_instances_ == instance_index_) {
+      page_ids.push_back(page_id);
+    }
+  }
+  page_ids.resize(std::min<size_t>(page_ids.size(), pool_size_));
+  for (size_t begin = 0; begin < page_ids.size(); begin += WARM_RESTART_BATCH_SIZE) {
+    auto end = page_ids.begin() + std::min<size_t>(begin + WARM_RESTART_BATCH_SIZE, page_ids.size());
+    std::sort(page_ids.begin() + begin, end);
+  }
+  PrefetchPgsImp(page_ids, AccessHint::NORMAL);
+}
+
+void BufferPoolManagerInstance::PrefetchBatch(const std::vector<std::pair<page_id_t, AccessHint>> &pages) {
+  std::vector<std::pair<page_id_t, frame_id_t>> claimed;
+  std::vector<AccessHint> hints;
+  {
+    auto latch = LockBufTab();
+    // Claimed frames are in neither the free list nor the replacer, so later claims cannot take them, and their pages
+    // are in prefetch_reads_, so misses wait for them instead of reading them into other frames.
+    for (const auto &[page_id, hint] : pages) {
+      frame_id_t frame_id;
+      if (page_table_.Find(page_id, &frame_id) || prefetch_reads_.count(page_id) > 0 ||
+          !ClaimFrame(page_id, hint, 0, &frame_id)) {
+        continue;
+      }
+      prefetch_reads_.emplace(page_id, frame_id);
+      claimed.emplace_back(page_id, frame_id);
+      hints.push_back(hint);
+    }
+  }
+  if (claimed.empty()) {
+    return;
+  }
+
+  // Scan readahead is mostly consecutive pages, which one vectored read per run serves best; anything else is read
+  // asynchronously so that the reads overlap.
+  std::vector<std::future<void>> reads;
+  std::vector<std::pair<page_id_t, char *>> scan_reads;
+  for (size_t i = 0; i < claimed.size(); i++) {
+    const auto &[page_id, frame_id] = claimed[i];
+    WaitForWriteBack(page_id);
+    if (hints[i] == AccessHint::SEQUENTIAL_SCAN) {
+      scan_reads.emplace_back(page_id, GetFrame(frame_id)->GetData());
+    } else {
+      reads.push_back(disk_manager_->ReadPageAsync(page_id, GetFrame(frame_id)->GetData()));
+    }
+  }
+  disk_manager_->ReadPages(std::move(scan_reads));
+  for (auto &read : reads) {
+    read.wait();
+  }
+
+  auto latch = LockBufTab();
+  for (const auto &[page_id, frame_id] : claimed) {
+    auto iter = prefetch_reads_.find(page_id);
+    if (iter != prefetch_reads_.end() && iter->second == frame_id) {
+      prefetch_reads_.erase(iter);
+      PublishFrame(page_id, frame_id);
+      continue;
+    }
+    // The page was dropped while it was read, so what was read may be stale: free the frame like DropPage does.
+    if (frames_[frame_id].ring_ != NO_RING) {
+      LeaveRing(frame_id);
+    } else {
+      replacer_->Remove(frame_id);
+    }
+    frames_[frame_id].prefetched_ = false;
+    GetFrame(frame_id)->page_id_ = INVALID_PAGE_ID;
+    if (static_cast<size_t>(frame_id) < pool_size_) {
+      free_list_.push_back(frame_id);
+      num_free_frames_ = free_list_.size();
+    }
+  }
+  prefetch_read_cv_.notify_all();
+}
+
+bool BufferPoolManagerInstance::LoadPage(page_id_t page_id, AccessHint hint, int pin_count, frame_id_t *frame_id) {
+  if (!ClaimFrame(page_id, hint, pin_count, frame_id)) {
+    return false;
+  }
+  WaitForWriteBack(page_id);
+  disk_manager_->ReadPage(page_id, GetFrame(*frame_id)->GetData());
+  PublishFrame(page_id, *frame_id);
+  return true;
+}
+
+void BufferPoolManagerInstance::BeginWriteBack(page_id_t page_id) {
+  std::unique_lock latch(write_back_latch_);
+  write_back_cv_.wait(latch, [this, page_id] { return write_back_pending_.count(page_id) == 0; });
+  write_back_pending_.insert(page_id);
+}
+
+bool BufferPoolManagerInstance::TryBeginWriteBack(page_id_t page_id) {
+  std::scoped_lock latch(write_back_latch_);
+  return write_back_pending_.insert(page_id).second;
+}
+
+void BufferPoolManagerInstance::EndWriteBack(page_id_t page_id) {
+  {
+    std::scoped_lock latch(write_back_latch_);
+    write_back_pending_.erase(page_id);
+  }
+  write_back_cv_.notify_all();
+}
+
+void BufferPoolManagerInstance::WaitForWriteBack(page_id_t page_id) {
+  std::unique_lock latch(write_back_latch_);
+  write_back_cv_.wait(latch, [this, page_id] { return write_back_pending_.count(page_id) == 0; });
+}
+
+bool BufferPoolManagerInstance::ClaimFrame(page_id_t page_id, AccessHint hint, int pin_count, frame_id_t *frame_id) {
+  if (!(hint == AccessHint::NORMAL ? FindVictimFrame(frame_id) : FindRingFrame(hint, frame_id))) {
+    return false;
+  }
+  Page *page = GetFrame(*frame_id);
+  page->page_id_ = page_id;
+  page->pin_count_ = pin_count;
+  if (pin_count > 0) {
+    CountPinnedFrame();
+  }
+  Touch(*frame_id);
+  page->is_dirty_ = false;
+  frames_[*frame_id].rec_lsn_ = GetCleanLSN();
+  frames_[*frame_id].prefetched_ = pin_count == 0;
+  return true;
+}
+
+void BufferPoolManagerInstance::PublishFrame(page_id_t page_id, frame_id_t frame_id) {
+  // Publish the page only once its contents are in place.
+  page_table_.Insert(page_id, frame_id);
+  if (frames_[frame_id].ring_ == NO_RING) {
+    if (GetFrame(frame_id)->pin_count_ > 0) {
+      replacer_->Pin(frame_id);
+    } else {
+      replacer_->Unpin(frame_id);
+    }
+  }
+}
+
+bool BufferPoolManagerInstance::PinResidentPage(page_id_t page_id, frame_id_t *frame_id, bool transient) {
+  return page_table_.Find(page_id, [this, frame_id, transient](frame_id_t found) {
+    *frame_id = found;
+    // Counted before the pin itself, see IsPinnedTransientlyOnly.
+    if (transient) {
+      frames_[found].transient_pins_++;
+    }
+    if (GetFrame(found)->pin_count_++ == 0) {
+      CountPinnedFrame();
+    }
+  });
+}
+
+bool BufferPoolManagerInstance::EvictFrame(frame_id_t frame_id) {
+  Page *victim = GetFrame(frame_id);
+  if (victim->page_id_ == INVALID_PAGE_ID) {
+    return false;
+  }
+  // Once the page has left the page table nobody can pin it any more, so checking the pin count under the shard's
+  // write latch is enough to make the frame ours.
+  if (!page_table_.RemoveIf(victim->page_id_, [victim, frame_id](frame_id_t found) {
+        return found == frame_id && victim->pin_count_ == 0;
+      })) {
+    return false;
+  }
+  if (MarkClean(victim)) {
+    FlushLogUpTo(victim->GetLSN());
+    BeginWriteBack(victim->GetPageId());
+    disk_manager_->WritePage(victim->GetPageId(), victim->GetData());
+    EndWriteBack(victim->GetPageId());
+    eviction_writes_++;
+  } else {
+    // A write by the page cleaner may still be in flight. Until it lands the page must stay where GetDirtyPgTblImp
+    // sees it.
+    WaitForWriteBack(victim->GetPageId());
+  }
+  evictions_.fetch_add(1, std::memory_order_relaxed);
+  if (frames_[frame_id].prefetched_.exchange(false)) {
+    prefetch_wasted_++;
+  }
+  return true;
+}
+
+bool BufferPoolManagerInstance::FindVictimFrame(frame_id_t *frame_id) {
+  if (!free_list_.empty()) {
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+    num_free_frames_ = free_list_.size();
+    return true;
+  }
+  // The replacer may offer frames that were pinned again after they became evictable, or that a shrink is retiring;
+  // those are skipped.
+  while (replacer_->Victim(frame_id)) {
+    if (static_cast<size_t>(*frame_id) < pool_size_ && frames_[*frame_id].ring_ == NO_RING && EvictFrame(*frame_id)) {
+      return true;
+    }
+  }
+  // Everything the replacer knows about is pinned; fall back to frames parked in a ring by a finished scan.
+  for (auto &ring : rings_) {
+    auto iter = std::find_if(ring.begin(), ring.end(), [this](frame_id_t id) { return EvictFrame(id); });
+    if (iter != ring.end()) {
+      *frame_id = *iter;
+      LeaveRing(*frame_id);
+      return true;
+    }
+  }
+  // Transient pins, taken to write a page back or to peek at it, bypass the replacer: a frame the replacer offered
+  // while it carried one is gone from the replacer, and a frame whose last pin is one is not back yet. Either only
+  // returns once the pin is released, so wait for those frames rather than fail.
+  for (size_t i = 0; i < pool_size_; i++) {
+    auto candidate = static_cast<frame_id_t>(i);
+    if (frames_[candidate].transient_pins_ > 0 && frames_[candidate].ring_ == NO_RING &&
+        EvictAfterTransientPins(candidate)) {
+      // The write-back's unpin may have handed the frame to the replacer again.
+      replacer_->Remove(candidate);
+      *frame_id = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BufferPoolManagerInstance::EvictAfterTransientPins(frame_id_t frame_id) {
+  // Transient pins are never held while waiting for bufTabMutex, so this cannot deadlock; anybody else who pins the
+  // frame may, so give up on it then.
+  while (GetFrame(frame_id)->pin_count_ > 0) {
+    if (!IsPinnedTransientlyOnly(frame_id)) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return EvictFrame(frame_id);
+}
+
+bool BufferPoolManagerInstance::IsPinnedTransientlyOnly(frame_id_t frame_id) {
+  // Transient pins are counted before the pin is taken and uncounted after it is released, so reading the count first
+  // never mistakes a transient pin for anybody else's.
+  int transient_pins = frames_[frame_id].transient_pins_;
+  return GetFrame(frame_id)->pin_count_ <= transient_pins;
+}
+
+void BufferPoolManagerInstance::FlushLogUpTo(lsn_t lsn) {
+  if (!enable_logging || log_manager_ == nullptr || lsn == INVALID_LSN) {
+    return;
+  }
+  if (lsn > log_manager_->GetPersistentLSN()) {
+    log_manager_->Flush(lsn);
+  }
+}
+
+bool BufferPoolManagerInstance::FindRingFrame(AccessHint hint, frame_id_t *frame_id) {
+  BUSTUB_ASSERT(hint != AccessHint::NORMAL, "normal accesses do not use a ring");
+  auto ring_index = static_cast<int8_t>(hint == AccessHint::SEQUENTIAL_SCAN ? 0 : 1);
+  auto &ring = rings_[ring_index];
+  if (ring.size() >= ring_size_) {
+    frame_id_t oldest = ring.front();
+    if (EvictFrame(oldest)) {
+      ring.pop_front();
+      ring.push_back(oldest);
+      *frame_id = oldest;
+      return true;
+    }
+    // The oldest frame is still in use; the replacer takes it over once it is unpinned. If the last unpin raced with
+    // leaving the ring it may not have seen the frame as ours, so hand it over here. Unpinning a frame the replacer
+    // already holds as evictable is a no-op for every replacer, so a double hand-over does not count as another use.
+    LeaveRing(oldest);
+    if (GetFrame(oldest)->pin_count_ == 0) {
+      replacer_->Unpin(oldest);
+    }
+  }
+  if (!FindVictimFrame(frame_id)) {
+    return false;
+  }
+  frames_[*frame_id].ring_ = ring_index;
+  ring.push_back(*frame_id);
+  return true;
+}
+
+void BufferPoolManagerInstance::LeaveRing(frame_id_t frame_id) {
+  auto &ring = rings_[frames_[frame_id].ring_];
+  ring.erase(std::find(ring.begin(), ring.end(), frame_id));
+  frames_[frame_id].ring_ = NO_RING;
+}
+
+Page *BufferPoolManagerInstance::NewPgImp(page_id_t *page_id, AccessHint hint) {
   // 0.   Make sure you call AllocatePage!
   // 1.   If all the pages in the buffer pool are pinned, return nullptr.
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
-    page_id_t nextPage = AllocatePage();
-    Page* pages = GetPages();
-    int len = GetPoolSize();
-    bool hasFreeSlot = false;
-//    int slot = -1;
-    for (int i = 0; i < len; ++i) {
-        Page* curPage = pages + i * PAGE_SIZE;
-        if (curPage->GetPinCount()) {
-            hasFreeSlot = true;
-//            slot = i;
-            break;
-        }
-    }
-    if (!hasFreeSlot) return nullptr;
-    if (free_list_.empty()) {
-        frame_id_t freeOne;
-        bool evcit = replacer_->Victim(&freeOne);
-        if (!evcit) {
-            return nullptr;
-        }
-        page_table_[nextPage] = freeOne;
-        Page* freePage = GetPage(freeOne);
-        freePage->ResetMemory();
-        *page_id = nextPage;
-        return freePage;
-    } else {
-        frame_id_t slot = *free_list_.begin();
-        page_table_[nextPage] = slot;
-        free_list_.pop_front();
-        Page* freePage = GetPage(freeOne);
-        freePage->ResetMemory();
-        *page_id = nextPage;
-        return freePage;
-    }
+  auto latch = LockBufTab();
+  frame_id_t frame_id;
+  if (!FindNewPageFrame(hint, &frame_id)) {
+    return nullptr;
+  }
+  *page_id = AllocatePage();
+  return InitNewPage(frame_id, *page_id);
+}
+
+Page *BufferPoolManagerInstance::NewPgInExtentImp(page_id_t *page_id, page_id_t *extent, AccessHint hint) {
+  BUSTUB_ASSERT(num_instances_ == 1, "instances of a parallel buffer pool create pages in extents through NewPageAt");
+  auto latch = LockBufTab();
+  frame_id_t frame_id;
+  if (!FindNewPageFrame(hint, &frame_id)) {
+    return nullptr;
+  }
+  // Like AllocatePage, drop a stale prefetch of the free page.
+  do {
+    *page_id = disk_manager_->AllocatePageInExtent(extent);
+  } while (!DropPage(*page_id));
+  return InitNewPage(frame_id, *page_id);
+}
+
+Page *BufferPoolManagerInstance::NewPageAt(page_id_t page_id, AccessHint hint, bool *resident) {
+  ValidatePageId(page_id);
+  auto latch = LockBufTab();
+  // A stale prefetch of the free page may hold the id; its frame is dropped like in AllocatePage.
+  *resident = !DropPage(page_id);
+  frame_id_t frame_id;
+  if (*resident || !FindNewPageFrame(hint, &frame_id)) {
+    return nullptr;
+  }
+  return InitNewPage(frame_id, page_id);
+}
+
+bool BufferPoolManagerInstance::FindNewPageFrame(AccessHint hint, frame_id_t *frame_id) {
+  if (!(hint == AccessHint::NORMAL ? FindVictimFrame(frame_id) : FindRingFrame(hint, frame_id))) {
+    new_page_failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
 }
 
-Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
+Page *BufferPoolManagerInstance::InitNewPage(frame_id_t frame_id, page_id_t page_id) {
+  Page *page = GetFrame(frame_id);
+  page->ResetMemory();
+  page->page_id_ = page_id;
+  page->pin_count_ = 1;
+  CountPinnedFrame();
+  Touch(frame_id);
+  page->is_dirty_ = false;
+  frames_[frame_id].rec_lsn_ = GetCleanLSN();
+  page_table_.Insert(page_id, frame_id);
+  if (frames_[frame_id].ring_ == NO_RING) {
+    replacer_->Pin(frame_id);
+  }
+  return page;
+}
+
+Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id, AccessHint hint) {
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
   // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
@@ -135,47 +745,57 @@ Page *BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) {
   // 2.     If R is dirty, write it back to the disk.
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  if (page_table_.count(page_id) > 0) {
-      frame_id_t frameId = page_table_[page_id];
-      Page* p = GetPage(frameId);
-      replacer_->Pin(frameId);
-      return p;
-  } else {
-//      bool hasFree = true;
-      frame_id_t frameId;
-      if (free_list_.empty()) {
-//          hasFree = false;
-          bool evcit = replacer_->Victim(&frameId);
-          if (!evcit) {
-              return nullptr;
-          }
-          Page* r = GetPage(frameId);
-          if (r->is_dirty_) {
-              FlushPgImp(r->GetPageId());
-          }
-          page_table_.erase(r->GetPageId());
-          page_table_[page_id] = frameId;
-          r->ResetMemory();
-          r->page_id_ = page_id;
-          disk_manager_->ReadPage(page_id, r->GetData());
-          return r;
-      } else {
-          auto iter = free_list_.begin();
-          frameId = *iter;
-          Page* r = GetPage(frameId);
-          if (r->IsDirty()) {
-              FlushPgImp(r->GetPageId());
-          }
-          page_table_.erase(r->GetPageId());
-          page_table_[page_id] = frameId;
-          r->ResetMemory();
-          r->page_id_ = page_id;
-          disk_manager_->ReadPage(page_id, r->GetData());
-          return r;
+  frame_id_t frame_id;
+  if (PinResidentPage(page_id, &frame_id)) {
+    Touch(frame_id);
+    fetch_hits_.Add();
+    if (frames_[frame_id].prefetched_ && frames_[frame_id].prefetched_.exchange(false)) {
+      prefetch_hits_++;
+    }
+    if (frames_[frame_id].ring_ == NO_RING) {
+      replacer_->Pin(frame_id);
+    } else if (hint == AccessHint::NORMAL) {
+      // A point access to a page brought in by a scan makes it part of the working set.
+      auto latch = LockBufTab();
+      if (frames_[frame_id].ring_ != NO_RING) {
+        LeaveRing(frame_id);
       }
+      replacer_->Pin(frame_id);
+    }
+    return GetFrame(frame_id);
   }
 
-  return nullptr;
+  auto start = std::chrono::steady_clock::now();
+  auto latch = LockBufTab();
+  // A prefetch reading the page in is waited for rather than read twice.
+  prefetch_read_cv_.wait(latch, [this, page_id] { return prefetch_reads_.count(page_id) == 0; });
+  // Another thread, or a prefetch, may have brought the page in while we were waiting for the latch.
+  if (PinResidentPage(page_id, &frame_id)) {
+    Touch(frame_id);
+    fetch_hits_.Add();
+    if (frames_[frame_id].prefetched_.exchange(false)) {
+      prefetch_hits_++;
+    }
+    if (frames_[frame_id].ring_ == NO_RING) {
+      replacer_->Pin(frame_id);
+    } else if (hint == AccessHint::NORMAL) {
+      LeaveRing(frame_id);
+      replacer_->Pin(frame_id);
+    }
+    return GetFrame(frame_id);
+  }
+  fetch_misses_.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::scoped_lock prefetch_latch(prefetch_latch_);
+    if (prefetch_pending_.erase(page_id) > 0) {
+      prefetch_misses_++;
+    }
+  }
+  if (!LoadPage(page_id, hint, 1, &frame_id)) {
+    return nullptr;
+  }
+  miss_latency_.Record(std::chrono::steady_clock::now() - start);
+  return GetFrame(frame_id);
 }
 
 bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
@@ -184,31 +804,183 @@ bool BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-    if (page_table_.count(page_id) > 0) {
-        frame_id_t slot = page_table_[page_id];
-        Page* p = GetPage(page_id);
-        if (p->GetPinCount()) return false;
-        page_table_.erase(page_id);
-        p->ResetMemory();
-        free_list_.push_back(slot);
-    } else {
-        return true;
+  auto latch = LockBufTab();
+  if (!DropPage(page_id)) {
+    return false;
+  }
+  DeallocatePage(page_id);
+  return true;
+}
+
+bool BufferPoolManagerInstance::DropPage(page_id_t page_id) {
+  // A page still being prefetched is not resident yet; the prefetch frees its frame once the read lands.
+  if (prefetch_reads_.erase(page_id) > 0) {
+    return true;
+  }
+  bool resident = false;
+  frame_id_t frame_id;
+  bool removed = page_table_.RemoveIf(page_id, [this, &resident, &frame_id](frame_id_t found) {
+    resident = true;
+    frame_id = found;
+    return GetFrame(found)->pin_count_ == 0;
+  });
+  if (!removed) {
+    return !resident;
+  }
+  if (frames_[frame_id].ring_ != NO_RING) {
+    LeaveRing(frame_id);
+  } else {
+    replacer_->Remove(frame_id);
+  }
+  Page *page = GetFrame(frame_id);
+  MarkClean(page);
+  frames_[frame_id].prefetched_ = false;
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  if (static_cast<size_t>(frame_id) < pool_size_) {
+    free_list_.push_back(frame_id);
+    num_free_frames_ = free_list_.size();
+  }
+  return true;
+}
+
+void BufferPoolManagerInstance::ResizeImp(size_t pool_size) {
+  BUSTUB_ASSERT(pool_size > 0, "the buffer pool needs at least one frame");
+  std::scoped_lock resize_latch(resize_latch_);
+  const size_t old_pool_size = pool_size_;
+  if (pool_size >= old_pool_size) {
+    auto latch = LockBufTab();
+    GrowFrames(pool_size);
+    return;
+  }
+
+  {
+    // From here on no retiring frame is handed out again.
+    auto latch = LockBufTab();
+    pool_size_ = pool_size;
+    ring_size_ = RingSize(pool_size);
+    free_list_.remove_if([pool_size](frame_id_t frame_id) { return static_cast<size_t>(frame_id) >= pool_size; });
+    num_free_frames_ = free_list_.size();
+    // Retiring ring frames go back to the replacer's care, so that their last unpin makes them evictable, and rings
+    // over the new size give up their oldest frames.
+    for (auto &ring : rings_) {
+      for (auto frame_id : std::vector<frame_id_t>(ring.begin(), ring.end())) {
+        if (static_cast<size_t>(frame_id) >= pool_size || ring.size() > ring_size_) {
+          LeaveRing(frame_id);
+          if (GetFrame(frame_id)->pin_count_ == 0) {
+            replacer_->Unpin(frame_id);
+          }
+        }
+      }
     }
-  return false;
+  }
+
+  // Pages pinned in retiring frames are left alone until they are unpinned.
+  while (true) {
+    {
+      auto latch = LockBufTab();
+      size_t pinned = 0;
+      for (size_t frame_id = pool_size; frame_id < old_pool_size; frame_id++) {
+        if (!RetireFrame(static_cast<frame_id_t>(frame_id))) {
+          pinned++;
+        }
+      }
+      if (pinned == 0) {
+        frames_.Shrink(pool_size);
+        while (arenas_.back().first >= pool_size) {
+          arenas_.pop_back();
+        }
+        arenas_.back().second->Shrink(pool_size - arenas_.back().first);
+        return;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void BufferPoolManagerInstance::GrowFrames(size_t pool_size) {
+  const size_t old_pool_size = pool_size_;
+  if (pool_size == old_pool_size) {
+    return;
+  }
+  frames_.Grow(pool_size);
+  replacer_->Resize(pool_size);
+  auto arena = std::make_unique<FrameArena>(pool_size - old_pool_size);
+  for (size_t i = old_pool_size; i < pool_size; i++) {
+    // A frame retired by an earlier shrink may still be allocated, but its data went with its arena.
+    Frame &frame = frames_[i];
+    frame.page_.data_ = arena->GetFrameData(static_cast<frame_id_t>(i - old_pool_size));
+    frame.page_.page_id_ = INVALID_PAGE_ID;
+    frame.ring_ = NO_RING;
+    frame.prefetched_ = false;
+    frame.transient_pins_ = 0;
+    free_list_.emplace_back(static_cast<frame_id_t>(i));
+  }
+  num_free_frames_ = free_list_.size();
+  arenas_.emplace_back(old_pool_size, std::move(arena));
+  pool_size_ = pool_size;
+  ring_size_ = RingSize(pool_size);
+}
+
+bool BufferPoolManagerInstance::RetireFrame(frame_id_t frame_id) {
+  Page *page = GetFrame(frame_id);
+  if (page->page_id_ != INVALID_PAGE_ID) {
+    if (!EvictFrame(frame_id)) {
+      return false;
+    }
+    page->page_id_ = INVALID_PAGE_ID;
+  }
+  replacer_->Remove(frame_id);
+  return true;
 }
 
 bool BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) {
+  return UnpinResidentPage(page_id, is_dirty, false);
+}
+
+bool BufferPoolManagerInstance::UnpinResidentPage(page_id_t page_id, bool is_dirty, bool transient) {
+  bool unpinned = false;
+  bool to_replacer = false;
+  frame_id_t frame_id;
+  page_table_.Find(page_id, [&](frame_id_t found) {
+    frame_id = found;
+    Page *page = GetFrame(found);
+    int pin_count = page->pin_count_;
+    if (pin_count <= 0) {
+      return;
+    }
     if (is_dirty) {
-        FlushPgImp(page_id);
+      // Mark before unpinning so that whoever evicts the page next sees that it must be written back.
+      MarkDirty(page);
     }
-    frame_id_t frameId = page_table_[page_id];
-    replacer_->Unpin(frameId);
-    return true;
+    while (pin_count > 0 && !page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+    }
+    unpinned = pin_count > 0;
+    // Once unpinned the frame may be evicted, and even retired by a shrink, so look at it while the shard latch still
+    // keeps it in place.
+    if (transient) {
+      // Uncounted after the pin is gone, see IsPinnedTransientlyOnly.
+      frames_[found].transient_pins_--;
+    }
+    if (pin_count == 1) {
+      num_pinned_frames_--;
+    }
+    to_replacer = pin_count == 1 && frames_[found].ring_ == NO_RING;
+  });
+  if (to_replacer) {
+    replacer_->Unpin(frame_id);
+  }
+  return unpinned;
 }
 
 page_id_t BufferPoolManagerInstance::AllocatePage() {
-  const page_id_t next_page_id = next_page_id_;
-  next_page_id_ += num_instances_;
+  // The disk manager reuses deallocated ids, and a prefetch may have read a free page in before it was reused. Such a
+  // frame is stale, so drop it rather than have two frames claim one page. Only a caller that fetched the page after
+  // deleting it can keep it pinned; then the id is skipped, and stays allocated until deleted.
+  page_id_t next_page_id;
+  do {
+    next_page_id = disk_manager_->AllocatePage(instance_index_, num_instances_);
+  } while (!DropPage(next_page_id));
   ValidatePageId(next_page_id);
   return next_page_id;
 }
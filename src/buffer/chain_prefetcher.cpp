@@ -0,0 +1,48 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// chain_prefetcher.cpp
+//
+// Identification: src/buffer/chain_prefetcher.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/chain_prefetcher.h"
+
+#include <vector>
+
+namespace bustub {
+
+void ChainPrefetcher::MoveTo(page_id_t page_id, page_id_t next_page_id) {
+  // The page the scan reached is no longer ahead of it. A scan that lands anywhere else has left the chain the window
+  // was built on.
+  if (!window_.empty() && window_.front() == page_id) {
+    window_.pop_front();
+  } else {
+    window_.clear();
+  }
+  const size_t window_size = buffer_pool_manager_->GetPrefetchWindow();
+  std::vector<page_id_t> page_ids;
+  if (window_.empty() && window_size > 0 && next_page_id != INVALID_PAGE_ID) {
+    window_.push_back(next_page_id);
+    page_ids.push_back(next_page_id);
+  }
+  // Follow the chain from the end of the window as far as its pages have been read in.
+  while (!window_.empty() && window_.size() < window_size) {
+    page_id_t after = INVALID_PAGE_ID;
+    auto read_link = [this, &after](Page *page) { after = next_page_id_(page); };
+    if (!buffer_pool_manager_->ReadResidentPage(window_.back(), read_link) || after == INVALID_PAGE_ID) {
+      break;
+    }
+    window_.push_back(after);
+    page_ids.push_back(after);
+  }
+  if (!page_ids.empty()) {
+    buffer_pool_manager_->PrefetchPages(page_ids, hint_);
+  }
+}
+
+}  // namespace bustub
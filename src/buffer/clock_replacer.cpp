@@ -12,18 +12,93 @@
 
 #include "buffer/clock_replacer.h"
 
+#include "common/macros.h"
+
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages, uint8_t max_usage)
+    : num_pages_(num_pages), max_usage_(max_usage), state_(num_pages) {
+  BUSTUB_ASSERT(max_usage_ > 0 && max_usage_ <= USAGE_MASK, "max usage must fit in the usage bits");
+}
 
 ClockReplacer::~ClockReplacer() = default;
 
-bool ClockReplacer::Victim(frame_id_t *frame_id) { return false; }
+bool ClockReplacer::Victim(frame_id_t *frame_id) {
+  std::scoped_lock latch(hand_latch_);
+  // Each frame needs at most max_usage_ passes to drain its counter, plus one to be picked. Concurrent unpins may
+  // keep refilling counters, so give up after that many sweeps rather than spinning.
+  const size_t num_pages = num_pages_.load();
+  const size_t max_steps = num_pages * (max_usage_ + 2);
+  // A full sweep that finds nothing evictable means there is nothing to find.
+  bool saw_evictable = false;
+  for (size_t step = 0; step < max_steps; step++) {
+    if (step % num_pages == 0) {
+      if (step > 0 && !saw_evictable) {
+        break;
+      }
+      saw_evictable = false;
+    }
+    auto candidate = static_cast<frame_id_t>(hand_);
+    hand_ = (hand_ + 1) % num_pages;
+    uint8_t state = state_[candidate].load();
+    if ((state & EVICTABLE) == 0) {
+      continue;
+    }
+    saw_evictable = true;
+    if ((state & USAGE_MASK) > 0) {
+      // Losing this race against a Pin or Unpin just means the frame keeps its fresher state.
+      state_[candidate].compare_exchange_strong(state, state - 1);
+      continue;
+    }
+    // Claim the frame; a concurrent Pin or Unpin that changes the state first wins and the hand moves on.
+    if (state_[candidate].compare_exchange_strong(state, 0)) {
+      *frame_id = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  state_[frame_id].fetch_and(static_cast<uint8_t>(~EVICTABLE));
+}
+
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  uint8_t old_state = state_[frame_id].load();
+  uint8_t new_state;
+  do {
+    if ((old_state & EVICTABLE) != 0) {
+      return;
+    }
+    auto usage = static_cast<uint8_t>(old_state & USAGE_MASK);
+    new_state = EVICTABLE | (usage < max_usage_ ? usage + 1 : usage);
+  } while (!state_[frame_id].compare_exchange_weak(old_state, new_state));
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::Remove(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  state_[frame_id].store(0);
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+void ClockReplacer::Resize(size_t num_pages) {
+  std::scoped_lock latch(hand_latch_);
+  if (num_pages > num_pages_) {
+    state_.Grow(num_pages);
+    num_pages_ = num_pages;
+  }
+}
 
-size_t ClockReplacer::Size() { return 0; }
+size_t ClockReplacer::Size() {
+  const size_t num_pages = num_pages_.load();
+  size_t size = 0;
+  for (size_t i = 0; i < num_pages; i++) {
+    if ((state_[i].load(std::memory_order_relaxed) & EVICTABLE) != 0) {
+      size++;
+    }
+  }
+  return size;
+}
 
 }  // namespace bustub
@@ -0,0 +1,61 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+FrameArena::FrameArena(size_t num_frames, bool try_hugetlb) : size_(num_frames * PAGE_SIZE) {
+  void *data = MAP_FAILED;
+  if (size_ >= HUGE_PAGE_SIZE) {
+    // Huge page mappings must be a whole number of huge pages.
+    size_ = (size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef MAP_HUGETLB
+    if (try_hugetlb) {
+      data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      hugetlb_ = data != MAP_FAILED;
+    }
+#endif
+  }
+  if (data == MAP_FAILED) {
+    data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "cannot map the buffer pool frames");
+    }
+#ifdef MADV_HUGEPAGE
+    if (size_ >= HUGE_PAGE_SIZE) {
+      // Only a hint; the kernel may not have transparent huge pages enabled.
+      madvise(data, size_, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  data_ = static_cast<char *>(data);
+}
+
+FrameArena::~FrameArena() { munmap(data_, size_); }
+
+void FrameArena::Shrink(size_t num_frames) {
+  size_t granularity = hugetlb_ ? HUGE_PAGE_SIZE : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t new_size = (num_frames * PAGE_SIZE + granularity - 1) / granularity * granularity;
+  // The destructor unmaps whatever is left, so the mapping is never emptied here.
+  if (new_size > 0 && new_size < size_) {
+    munmap(data_ + new_size, size_ - new_size);
+    size_ = new_size;
+  }
+}
+
+}  // namespace bustub
@@ -0,0 +1,157 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k)
+    : num_pages_(num_pages), k_(k), nodes_(num_pages), history_(num_pages * k) {
+  BUSTUB_ASSERT(k_ > 0, "k must be positive");
+  heap_.reserve(num_pages);
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+bool LRUKReplacer::Victim(frame_id_t *frame_id) {
+  std::scoped_lock latch(latch_);
+  if (heap_.empty()) {
+    return false;
+  }
+  *frame_id = heap_.front().second;
+  Erase(*frame_id);
+  // The frame is about to hold a different page; its history no longer applies.
+  nodes_[*frame_id] = FrameNode();
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  if (nodes_[frame_id].heap_index_ != NOT_EVICTABLE) {
+    Erase(frame_id);
+  }
+  RecordAccess(frame_id);
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  auto &node = nodes_[frame_id];
+  if (node.heap_index_ != NOT_EVICTABLE) {
+    return;
+  }
+  // A frame that is unpinned without ever being pinned still counts as having been accessed once.
+  if (node.num_accesses_ == 0) {
+    RecordAccess(frame_id);
+  }
+  Push(frame_id);
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  if (nodes_[frame_id].heap_index_ != NOT_EVICTABLE) {
+    Erase(frame_id);
+  }
+  nodes_[frame_id] = FrameNode();
+}
+
+void LRUKReplacer::Resize(size_t num_pages) {
+  std::scoped_lock latch(latch_);
+  if (num_pages > num_pages_) {
+    nodes_.resize(num_pages);
+    history_.resize(num_pages * k_);
+    heap_.reserve(num_pages);
+    num_pages_ = num_pages;
+  }
+}
+
+size_t LRUKReplacer::Size() {
+  std::scoped_lock latch(latch_);
+  return heap_.size();
+}
+
+void LRUKReplacer::RecordAccess(frame_id_t frame_id) {
+  auto &node = nodes_[frame_id];
+  uint64_t *ring = &history_[frame_id * k_];
+  if (node.num_accesses_ < k_) {
+    ring[(node.oldest_ + node.num_accesses_++) % k_] = current_timestamp_++;
+    return;
+  }
+  // The oldest access drops out of the window and its entry takes the new one.
+  ring[node.oldest_] = current_timestamp_++;
+  node.oldest_ = (node.oldest_ + 1) % k_;
+}
+
+uint64_t LRUKReplacer::KeyOf(frame_id_t frame_id) const {
+  const auto &node = nodes_[frame_id];
+  uint64_t oldest = history_[frame_id * k_ + node.oldest_];
+  return node.num_accesses_ >= k_ ? oldest + HOT : oldest;
+}
+
+void LRUKReplacer::Push(frame_id_t frame_id) {
+  heap_.emplace_back(KeyOf(frame_id), frame_id);
+  nodes_[frame_id].heap_index_ = heap_.size() - 1;
+  SiftUp(heap_.size() - 1);
+}
+
+void LRUKReplacer::Erase(frame_id_t frame_id) {
+  size_t index = nodes_[frame_id].heap_index_;
+  nodes_[frame_id].heap_index_ = NOT_EVICTABLE;
+  auto last = heap_.back();
+  heap_.pop_back();
+  if (index == heap_.size()) {
+    return;
+  }
+  // The last entry fills the hole, and goes whichever way its key takes it.
+  Place(index, last);
+  SiftUp(index);
+  SiftDown(nodes_[last.second].heap_index_);
+}
+
+void LRUKReplacer::SiftUp(size_t index) {
+  auto entry = heap_[index];
+  while (index > 0 && entry.first < heap_[(index - 1) / 2].first) {
+    Place(index, heap_[(index - 1) / 2]);
+    index = (index - 1) / 2;
+  }
+  Place(index, entry);
+}
+
+void LRUKReplacer::SiftDown(size_t index) {
+  auto entry = heap_[index];
+  while (true) {
+    size_t child = 2 * index + 1;
+    if (child >= heap_.size()) {
+      break;
+    }
+    if (child + 1 < heap_.size() && heap_[child + 1].first < heap_[child].first) {
+      child++;
+    }
+    if (entry.first < heap_[child].first) {
+      break;
+    }
+    Place(index, heap_[child]);
+    index = child;
+  }
+  Place(index, entry);
+}
+
+void LRUKReplacer::Place(size_t index, std::pair<uint64_t, frame_id_t> entry) {
+  heap_[index] = entry;
+  nodes_[entry.second].heap_index_ = index;
+}
+
+}  // namespace bustub
@@ -12,110 +12,94 @@
 
 #include "buffer/lru_replacer.h"
 
-namespace bustub {
+#include "common/macros.h"
 
-LRUReplacer::LRUReplacer(size_t num_pages) {
-//    free_list = (FreeList)malloc((num_pages + 1) * sizeof(freeList));
-//    free_list->pinCount = -1;
-//    free_list->prevSlot = NULL;
-//    free_list->nextSlot = NULL;
-//    free_list->pageId = INVALID_PAGE_ID;
-//    lruSize_ = 0;
-    lru_list.clear();
-    bufPinCnt.clear();
-    max_page_size_ = num_pages;
-}
+namespace bustub {
 
-LRUReplacer::~LRUReplacer() {
-    max_page_size_ = 0;
-}
+LRUReplacer::LRUReplacer(size_t num_pages) : num_pages_(num_pages), evictable_(num_pages), nodes_(num_pages) {}
 
-bool LRUReplacer::Victim(frame_id_t *id) {
-    if (lru_list.empty()) return false;
-    frame_id_t ecvit = *lru_list.begin();
-    Pin(ecvit);
-    *id = ecvit;
-    return true;
-//    for (auto iter = lru_list.begin(); iter != lru_list.end(); ++iter) {
-//        if (GetPinCount(*iter) == 0) {
-//            lruMutex.lock();
-//            *id = *iter;
-//            lru_list.erase(iter);
-//            lruMutex.unlock();
-//            ReleasePinLock();
-//            return true;
-//        }
-//    }
-//    return false;
-}
+LRUReplacer::~LRUReplacer() = default;
 
-void LRUReplacer::Pin(frame_id_t id) {
-//    AddPinCount(id);
-    if (!bufPinCnt.count(id)) return;
-    for (auto iter = lru_list.begin(); iter != lru_list.end(); ++iter) {
-        if (*iter == id) {
-            lruMutex.lock();
-            lru_list.erase(iter);
-            pinLatch_.lock();
-            bufPinCnt.erase(id);
-            pinLatch_.unlock();
-            lruMutex.unlock();
-            break;
-        }
+bool LRUReplacer::Victim(frame_id_t *frame_id) {
+  std::scoped_lock latch(latch_);
+  while (head_ != NIL) {
+    frame_id_t front = head_;
+    Unlink(front);
+    // Frames pinned since they were unpinned are only dropped now.
+    if (evictable_[front].exchange(false)) {
+      *frame_id = front;
+      return true;
     }
-    return;
+  }
+  return false;
 }
 
-void LRUReplacer::Unpin(frame_id_t id) {
-    if (lru_list.size() == max_page_size_) return;
-    if (bufPinCnt.count(id)) return;
-    lruMutex.lock();
-    pinLatch_.lock();
-    bufPinCnt[id] = 0;
-    pinLatch_.unlock();
-    lru_list.push_back(id);
-    lruMutex.unlock();
+void LRUReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  // Hits on a frame that is pinned already leave its cache line alone.
+  auto &evictable = evictable_[frame_id];
+  if (evictable.load(std::memory_order_relaxed)) {
+    evictable.store(false);
+  }
+}
 
-//    SetPinCount(id);
-//    if (GetPinCount(id) <= 0) {
-//        lruMutex.lock();
-//        lru_list.push_back(id);
-//        lruMutex.unlock();
-//    }
-////    pinLatch_.unlock();
-//    ReleasePinLock();
+void LRUReplacer::Unpin(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  // An evictable frame keeps its place; one that was pinned since it was unpinned moves to the tail.
+  if (evictable_[frame_id].load()) {
     return;
+  }
+  if (nodes_[frame_id].linked_) {
+    Unlink(frame_id);
+  }
+  PushBack(frame_id);
+  evictable_[frame_id] = true;
 }
 
-void LRUReplacer::GetPinLock()
-{
-    pinLatch_.lock();
+void LRUReplacer::Remove(frame_id_t frame_id) {
+  std::scoped_lock latch(latch_);
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  evictable_[frame_id] = false;
+  if (nodes_[frame_id].linked_) {
+    Unlink(frame_id);
+  }
 }
 
-void LRUReplacer::ReleasePinLock()
-{
-    pinLatch_.unlock();
-}
-int LRUReplacer::GetPinCount(frame_id_t id) {
-//    pinLatch_.lock();
-    GetPinLock();
-//    pinLatch_.unlock();
-    return bufPinCnt[id];
+void LRUReplacer::Resize(size_t num_pages) {
+  std::scoped_lock latch(latch_);
+  if (num_pages > num_pages_) {
+    evictable_.Grow(num_pages);
+    nodes_.resize(num_pages);
+    num_pages_ = num_pages;
+  }
 }
 
-void LRUReplacer::SetPinCount(frame_id_t id) {
-    GetPinLock();
-    bufPinCnt[id] = 0;
-    ReleasePinLock();
+size_t LRUReplacer::Size() {
+  const size_t num_pages = num_pages_.load();
+  size_t size = 0;
+  for (size_t i = 0; i < num_pages; i++) {
+    if (evictable_[i].load(std::memory_order_relaxed)) {
+      size++;
+    }
+  }
+  return size;
 }
 
-void LRUReplacer::AddPinCount(frame_id_t id) {
-    GetPinLock();
-    bufPinCnt[id]++;
-    ReleasePinLock();
+void LRUReplacer::Unlink(frame_id_t frame_id) {
+  auto &node = nodes_[frame_id];
+  (node.prev_ == NIL ? head_ : nodes_[node.prev_].next_) = node.next_;
+  (node.next_ == NIL ? tail_ : nodes_[node.next_].prev_) = node.prev_;
+  node = ListNode();
 }
-size_t LRUReplacer::Size() {
-    return lru_list.size();
+
+void LRUReplacer::PushBack(frame_id_t frame_id) {
+  auto &node = nodes_[frame_id];
+  node.prev_ = tail_;
+  node.next_ = NIL;
+  node.linked_ = true;
+  (tail_ == NIL ? head_ : nodes_[tail_].next_) = frame_id;
+  tail_ = frame_id;
 }
 
 }  // namespace bustub
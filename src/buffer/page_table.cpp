@@ -0,0 +1,36 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.cpp
+//
+// Identification: src/buffer/page_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/page_table.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+PageTable::PageTable(size_t num_shards) {
+  size_t capacity = 1;
+  while (capacity < num_shards) {
+    capacity <<= 1;
+  }
+  shard_mask_ = capacity - 1;
+  shards_ = std::make_unique<Shard[]>(capacity);
+}
+
+void PageTable::Insert(page_id_t page_id, frame_id_t frame_id) {
+  Shard &shard = GetShard(page_id);
+  std::unique_lock latch(shard.latch_);
+  bool inserted = shard.map_.emplace(page_id, frame_id).second;
+  BUSTUB_ASSERT(inserted, "page is already resident");
+  (void)inserted;
+}
+
+}  // namespace bustub
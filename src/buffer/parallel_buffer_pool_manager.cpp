@@ -12,11 +12,21 @@
 
 #include "buffer/parallel_buffer_pool_manager.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "common/macros.h"
+
 namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager) {
+                                                     LogManager *log_manager, ReplacerType replacer_type)
+    : disk_manager_(disk_manager) {
   // Allocate and create individual BufferPoolManagerInstances
+  for (size_t i = 0; i < num_instances; i++) {
+    instances_.emplace_back(std::make_unique<BufferPoolManagerInstance>(
+        pool_size, num_instances, i, disk_manager, log_manager, replacer_type));
+  }
 }
 
 // Update constructor to destruct all BufferPoolManagerInstances and deallocate any associated memory
@@ -24,46 +34,205 @@ ParallelBufferPoolManager::~ParallelBufferPoolManager() = default;
 
 size_t ParallelBufferPoolManager::GetPoolSize() {
   // Get size of all BufferPoolManagerInstances
-  return 0;
+  size_t pool_size = 0;
+  for (auto &instance : instances_) {
+    pool_size += instance->GetPoolSize();
+  }
+  return pool_size;
+}
+
+BufferPoolStats ParallelBufferPoolManager::GetStats() {
+  BufferPoolStats stats;
+  for (auto &instance : instances_) {
+    stats += instance->GetStats();
+  }
+  return stats;
+}
+
+void ParallelBufferPoolManager::SetCleanerDirtyTarget(double fraction) {
+  for (auto &instance : instances_) {
+    instance->SetCleanerDirtyTarget(fraction);
+  }
+}
+
+void ParallelBufferPoolManager::SetCleanerBatchSize(size_t batch_size) {
+  for (auto &instance : instances_) {
+    instance->SetCleanerBatchSize(batch_size);
+  }
+}
+
+size_t ParallelBufferPoolManager::GetAbsorbedWriteCount() {
+  size_t count = 0;
+  for (auto &instance : instances_) {
+    count += instance->GetAbsorbedWriteCount();
+  }
+  return count;
+}
+
+size_t ParallelBufferPoolManager::GetCleanerWriteCount() {
+  size_t count = 0;
+  for (auto &instance : instances_) {
+    count += instance->GetCleanerWriteCount();
+  }
+  return count;
+}
+
+void ParallelBufferPoolManager::SetPrefetchEnabled(bool enabled) {
+  for (auto &instance : instances_) {
+    instance->SetPrefetchEnabled(enabled);
+  }
+}
+
+size_t ParallelBufferPoolManager::GetPrefetchHitCount() {
+  size_t count = 0;
+  for (auto &instance : instances_) {
+    count += instance->GetPrefetchHitCount();
+  }
+  return count;
+}
+
+size_t ParallelBufferPoolManager::GetPrefetchMissCount() {
+  size_t count = 0;
+  for (auto &instance : instances_) {
+    count += instance->GetPrefetchMissCount();
+  }
+  return count;
 }
 
 BufferPoolManager *ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) {
   // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
-  return nullptr;
+  return instances_[page_id % instances_.size()].get();
 }
 
-Page *ParallelBufferPoolManager::FetchPgImp(page_id_t page_id) {
+Page *ParallelBufferPoolManager::FetchPgImp(page_id_t page_id, AccessHint hint) {
   // Fetch page for page_id from responsible BufferPoolManagerInstance
-  return nullptr;
+  return GetBufferPoolManager(page_id)->FetchPage(page_id, hint);
 }
 
 bool ParallelBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) {
   // Unpin page_id from responsible BufferPoolManagerInstance
-  return false;
+  return GetBufferPoolManager(page_id)->UnpinPage(page_id, is_dirty);
 }
 
 bool ParallelBufferPoolManager::FlushPgImp(page_id_t page_id) {
   // Flush page_id from responsible BufferPoolManagerInstance
-  return false;
+  return GetBufferPoolManager(page_id)->FlushPage(page_id);
 }
 
-Page *ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) {
+Page *ParallelBufferPoolManager::NewPgImp(page_id_t *page_id, AccessHint hint) {
   // create new page. We will request page allocation in a round robin manner from the underlying
   // BufferPoolManagerInstances
   // 1.   From a starting index of the BPMIs, call NewPageImpl until either 1) success and return 2) looped around to
   // starting index and return nullptr
   // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
   // is called
+  const size_t num_instances = instances_.size();
+  size_t start = next_instance_.fetch_add(1) % num_instances;
+  // (preference, instance index) in the order the instances are tried.
+  std::vector<std::pair<size_t, size_t>> order(num_instances);
+  for (size_t i = 0; i < num_instances; i++) {
+    size_t index = (start + i) % num_instances;
+    size_t preference = 0;
+    if (load_aware_allocation_) {
+      // A free frame beats any number of evictable ones, which cost an eviction and maybe a write. The counts are
+      // only a hint, so instances that look full are still tried last rather than skipped.
+      auto &instance = instances_[index];
+      preference = instance->GetFreeFrameCount() > 0 ? std::numeric_limits<size_t>::max()
+                                                     : instance->GetEvictableFrameCount();
+    }
+    order[i] = {preference, index};
+  }
+  // Instances that are equally attractive keep their round-robin order, which spreads new pages among them.
+  std::stable_sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+  for (const auto &[preference, index] : order) {
+    Page *page = instances_[index]->NewPage(page_id, hint);
+    if (page != nullptr) {
+      return page;
+    }
+  }
   return nullptr;
 }
 
+Page *ParallelBufferPoolManager::NewPgInExtentImp(page_id_t *page_id, page_id_t *extent, AccessHint hint) {
+  // The extent decides the page id, and the page id the instance.
+  while (true) {
+    *page_id = disk_manager_->AllocatePageInExtent(extent);
+    bool resident;
+    Page *page = instances_[*page_id % instances_.size()]->NewPageAt(*page_id, hint, &resident);
+    if (page != nullptr) {
+      return page;
+    }
+    if (!resident) {
+      // Give the id back to the extent; the next page of the extent will be this one again.
+      disk_manager_->DeallocatePage(*page_id);
+      return nullptr;
+    }
+    // The page is pinned although it was free, which only a caller that fetched it after deleting it can do. Skip the
+    // id, as AllocatePage does; it stays allocated until deleted.
+  }
+}
+
 bool ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) {
   // Delete page_id from responsible BufferPoolManagerInstance
-  return false;
+  return GetBufferPoolManager(page_id)->DeletePage(page_id);
 }
 
 void ParallelBufferPoolManager::FlushAllPgsImp() {
   // flush all pages from all BufferPoolManagerInstances
+  for (auto &instance : instances_) {
+    instance->FlushAllPages();
+  }
+}
+
+void ParallelBufferPoolManager::PrefetchPgsImp(const std::vector<page_id_t> &page_ids, AccessHint hint) {
+  std::vector<std::vector<page_id_t>> per_instance(instances_.size());
+  for (auto page_id : page_ids) {
+    per_instance[page_id % instances_.size()].push_back(page_id);
+  }
+  for (size_t i = 0; i < instances_.size(); i++) {
+    if (!per_instance[i].empty()) {
+      instances_[i]->PrefetchPages(per_instance[i], hint);
+    }
+  }
+}
+
+bool ParallelBufferPoolManager::ReadResidentPgImp(page_id_t page_id, const std::function<void(Page *)> &reader) {
+  return GetBufferPoolManager(page_id)->ReadResidentPage(page_id, reader);
+}
+
+void ParallelBufferPoolManager::ResizeImp(size_t pool_size) {
+  // Split the frames evenly; the first pool_size % n instances get one more.
+  const size_t num_instances = instances_.size();
+  BUSTUB_ASSERT(pool_size >= num_instances, "every instance needs at least one frame");
+  for (size_t i = 0; i < num_instances; i++) {
+    instances_[i]->Resize(pool_size / num_instances + (i < pool_size % num_instances ? 1 : 0));
+  }
+}
+
+void ParallelBufferPoolManager::SaveHotPgsImp() {
+  for (auto &instance : instances_) {
+    instance->SaveHotPages();
+  }
+}
+
+std::vector<std::pair<page_id_t, lsn_t>> ParallelBufferPoolManager::GetDirtyPgTblImp() {
+  std::vector<std::pair<page_id_t, lsn_t>> table;
+  for (auto &instance : instances_) {
+    auto instance_table = instance->GetDirtyPageTable();
+    table.insert(table.end(), instance_table.begin(), instance_table.end());
+  }
+  return table;
+}
+
+size_t ParallelBufferPoolManager::FlushDirtyPgsImp(lsn_t rec_lsn, size_t max_pages) {
+  size_t written = 0;
+  for (auto &instance : instances_) {
+    if (written == max_pages) {
+      break;
+    }
+    written += instance->FlushDirtyPages(rec_lsn, max_pages - written);
+  }
+  return written;
 }
 
 }  // namespace bustub
@@ -30,6 +30,18 @@ Transaction *TransactionManager::Begin(Transaction *txn, IsolationLevel isolatio
   if (txn == nullptr) {
     txn = new Transaction(next_txn_id_++, isolation_level);
   }
+
+  {
+    // As in FinishTransaction: a checkpoint must not miss a transaction whose begin is older than the checkpoint.
+    std::shared_lock finish_latch(finish_latch_);
+    if (enable_logging && log_manager_ != nullptr) {
+      LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::BEGIN);
+      txn->SetPrevLSN(log_manager_->AppendLogRecord(&log_record));
+      txn->SetBeginLSN(txn->GetPrevLSN());
+    }
+    std::scoped_lock latch(active_txns_latch_);
+    active_txns_[txn->GetTransactionId()] = txn;
+  }
   txn_map_mutex.lock();
   txn_map[txn->GetTransactionId()] = txn;
   txn_map_mutex.unlock();
@@ -52,6 +64,13 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
+  lsn_t lsn = FinishTransaction(txn, LogRecordType::COMMIT);
+  if (lsn != INVALID_LSN) {
+    // The commit is only acknowledged once its record is durable. Transactions committing at the same time wait for
+    // the same write of the log, and keep their locks until then.
+    log_manager_->Flush(lsn);
+  }
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
@@ -102,12 +121,48 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  FinishTransaction(txn, LogRecordType::ABORT);
+
   // Release all the locks.
   ReleaseLocks(txn);
   // Release the global transaction latch.
   global_txn_latch_.RUnlock();
 }
 
+std::vector<std::pair<txn_id_t, lsn_t>> TransactionManager::GetActiveTransactionTable(lsn_t *oldest_begin_lsn) {
+  std::unique_lock finish_latch(finish_latch_);
+  std::scoped_lock latch(active_txns_latch_);
+  std::vector<std::pair<txn_id_t, lsn_t>> table;
+  table.reserve(active_txns_.size());
+  lsn_t oldest = INVALID_LSN;
+  for (const auto &[txn_id, txn] : active_txns_) {
+    table.emplace_back(txn_id, txn->GetPrevLSN());
+    lsn_t begin_lsn = txn->GetBeginLSN();
+    if (begin_lsn != INVALID_LSN && (oldest == INVALID_LSN || begin_lsn < oldest)) {
+      oldest = begin_lsn;
+    }
+  }
+  if (oldest_begin_lsn != nullptr) {
+    *oldest_begin_lsn = oldest;
+  }
+  return table;
+}
+
+lsn_t TransactionManager::FinishTransaction(Transaction *txn, LogRecordType log_record_type) {
+  // Appending the record and leaving the table happen as one step as far as checkpoints are concerned. Otherwise a
+  // checkpoint could list a transaction whose commit is older than the checkpoint, and recovery would undo it.
+  std::shared_lock finish_latch(finish_latch_);
+  lsn_t lsn = INVALID_LSN;
+  if (enable_logging && log_manager_ != nullptr) {
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLSN(), log_record_type);
+    lsn = log_manager_->AppendLogRecord(&log_record);
+    txn->SetPrevLSN(lsn);
+  }
+  std::scoped_lock latch(active_txns_latch_);
+  active_txns_.erase(txn->GetTransactionId());
+  return lsn;
+}
+
 void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
 
 void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
@@ -14,10 +14,36 @@
 
 namespace bustub {
 
-SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan) : AbstractExecutor(exec_ctx) {}
+SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNode *plan)
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      table_info_(exec_ctx->GetCatalog()->GetTable(plan->GetTableOid())),
+      table_iter_(table_info_->table_->End()) {}
 
-void SeqScanExecutor::Init() {}
+void SeqScanExecutor::Init() {
+  // A full scan touches every page once, so keep it from evicting the working set of other queries.
+  table_iter_ = table_info_->table_->Begin(exec_ctx_->GetTransaction(), AccessHint::SEQUENTIAL_SCAN);
+}
 
-bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) { return false; }
+bool SeqScanExecutor::Next(Tuple *tuple, RID *rid) {
+  const Schema *table_schema = &table_info_->schema_;
+  const AbstractExpression *predicate = plan_->GetPredicate();
+  for (; table_iter_ != table_info_->table_->End(); ++table_iter_) {
+    const Tuple &candidate = *table_iter_;
+    if (predicate != nullptr && !predicate->Evaluate(&candidate, table_schema).GetAs<bool>()) {
+      continue;
+    }
+    std::vector<Value> values;
+    values.reserve(GetOutputSchema()->GetColumnCount());
+    for (const auto &column : GetOutputSchema()->GetColumns()) {
+      values.emplace_back(column.GetExpr()->Evaluate(&candidate, table_schema));
+    }
+    *tuple = Tuple(values, GetOutputSchema());
+    *rid = candidate.GetRid();
+    ++table_iter_;
+    return true;
+  }
+  return false;
+}
 
 }  // namespace bustub
@@ -12,18 +12,77 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "buffer/lru_replacer.h"
+#include "common/latency_histogram.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
 
 namespace bustub {
 
+/**
+ * How the caller is going to use the pages it asks for.
+ *
+ * SEQUENTIAL_SCAN and BULK_WRITE accesses touch many pages exactly once. Instead of competing for frames in the
+ * replacer, which would flush the working set of point lookups, they recycle a small private ring of frames.
+ */
+enum class AccessHint { NORMAL, SEQUENTIAL_SCAN, BULK_WRITE };
+
+/**
+ * A snapshot of the counters of a buffer pool. The counters are read one by one without stopping traffic, so a
+ * snapshot taken under load is only approximately consistent.
+ */
+struct BufferPoolStats {
+  /** Fetches that found their page resident. */
+  size_t fetch_hits_ = 0;
+  /** Fetches that had to read their page. */
+  size_t fetch_misses_ = 0;
+  /** Pages evicted to make room for other pages. */
+  size_t evictions_ = 0;
+  /** Dirty pages written back because their frame was needed. */
+  size_t eviction_writes_ = 0;
+  /** Dirty pages written back by the page cleaner. */
+  size_t cleaner_writes_ = 0;
+  /** NewPage calls that failed because every frame was pinned. */
+  size_t new_page_failures_ = 0;
+  /** Most frames pinned at the same time; for several instances, the sum of their high-water marks. */
+  size_t pinned_frames_high_water_ = 0;
+  /** Number of times a thread had to wait for an instance latch. */
+  size_t latch_waits_ = 0;
+  /** Total time spent waiting for instance latches, in nanoseconds. */
+  uint64_t latch_wait_ns_ = 0;
+  /** Time from the start of a fetch that misses until its page has been read. */
+  LatencyHistogram::Snapshot miss_latency_;
+
+  /** @return the fraction of fetches that hit, 0 if there were none */
+  double HitRatio() const {
+    size_t fetches = fetch_hits_ + fetch_misses_;
+    return fetches == 0 ? 0 : static_cast<double>(fetch_hits_) / static_cast<double>(fetches);
+  }
+
+  BufferPoolStats &operator+=(const BufferPoolStats &other) {
+    fetch_hits_ += other.fetch_hits_;
+    fetch_misses_ += other.fetch_misses_;
+    evictions_ += other.evictions_;
+    eviction_writes_ += other.eviction_writes_;
+    cleaner_writes_ += other.cleaner_writes_;
+    new_page_failures_ += other.new_page_failures_;
+    pinned_frames_high_water_ += other.pinned_frames_high_water_;
+    latch_waits_ += other.latch_waits_;
+    latch_wait_ns_ += other.latch_wait_ns_;
+    miss_latency_ += other.miss_latency_;
+    return *this;
+  }
+};
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
  */
@@ -40,8 +99,13 @@ class BufferPoolManager {
 
   /** Grading function. Do not modify! */
   Page *FetchPage(page_id_t page_id, bufferpool_callback_fn callback = nullptr) {
+    return FetchPage(page_id, AccessHint::NORMAL, callback);
+  }
+
+  /** Fetch a page on behalf of an access with the given hint. */
+  Page *FetchPage(page_id_t page_id, AccessHint hint, bufferpool_callback_fn callback = nullptr) {
     GradingCallback(callback, CallbackType::BEFORE, page_id);
-    auto *result = FetchPgImp(page_id);
+    auto *result = FetchPgImp(page_id, hint);
     GradingCallback(callback, CallbackType::AFTER, page_id);
     return result;
   }
@@ -64,12 +128,29 @@ class BufferPoolManager {
 
   /** Grading function. Do not modify! */
   Page *NewPage(page_id_t *page_id, bufferpool_callback_fn callback = nullptr) {
+    return NewPage(page_id, AccessHint::NORMAL, callback);
+  }
+
+  /** Create a new page on behalf of an access with the given hint. */
+  Page *NewPage(page_id_t *page_id, AccessHint hint, bufferpool_callback_fn callback = nullptr) {
     GradingCallback(callback, CallbackType::BEFORE, INVALID_PAGE_ID);
-    auto *result = NewPgImp(page_id);
+    auto *result = NewPgImp(page_id, hint);
     GradingCallback(callback, CallbackType::AFTER, *page_id);
     return result;
   }
 
+  /**
+   * Create a new page in the caller's extent, so that the pages of one table or index end up next to each other on
+   * disk (see DiskManager::AllocatePageInExtent).
+   * @param[out] page_id id of the new page
+   * @param[in,out] extent first page id of the caller's extent, INVALID_PAGE_ID before its first page
+   * @param hint how the caller is going to use the page
+   * @return nullptr if no new page could be created, otherwise pointer to the new page
+   */
+  Page *NewPageInExtent(page_id_t *page_id, page_id_t *extent, AccessHint hint = AccessHint::NORMAL) {
+    return NewPgInExtentImp(page_id, extent, hint);
+  }
+
   /** Grading function. Do not modify! */
   bool DeletePage(page_id_t page_id, bufferpool_callback_fn callback = nullptr) {
     GradingCallback(callback, CallbackType::BEFORE, page_id);
@@ -85,9 +166,74 @@ class BufferPoolManager {
     GradingCallback(callback, CallbackType::AFTER, INVALID_PAGE_ID);
   }
 
+  /**
+   * Ask for pages to be read into the buffer pool in the background, without pinning them. Returns immediately;
+   * pages that are already resident, or that cannot be given a frame, are skipped.
+   * @param page_ids the pages that are about to be fetched
+   * @param hint how the pages are going to be fetched
+   */
+  void PrefetchPages(const std::vector<page_id_t> &page_ids, AccessHint hint = AccessHint::NORMAL) {
+    PrefetchPgsImp(page_ids, hint);
+  }
+
+  /**
+   * Let a function look at a page under its read latch if the page is resident. Never reads the page from disk, and
+   * does not count as an access of the page.
+   * @param page_id the page to look at
+   * @param reader called with the page while it is pinned and read latched
+   * @return false if the page is not resident, in which case reader is not called
+   */
+  bool ReadResidentPage(page_id_t page_id, const std::function<void(Page *)> &reader) {
+    return ReadResidentPgImp(page_id, reader);
+  }
+
+  /**
+   * Set how many pages ahead of itself a scan that follows a chain of pages keeps prefetched, see ChainPrefetcher.
+   * @param window the number of pages, 0 to prefetch nothing
+   */
+  void SetPrefetchWindow(size_t window) { prefetch_window_ = window; }
+
+  /** @return how many pages ahead of itself a scan that follows a chain of pages keeps prefetched */
+  size_t GetPrefetchWindow() const { return prefetch_window_; }
+
+  /**
+   * Record which pages are resident, most recently used first, so that a buffer pool created later on the same
+   * database reads them back in. Buffer pools also do this when they are destroyed if enable_warm_restart is on.
+   */
+  void SaveHotPages() { SaveHotPgsImp(); }
+
+  /**
+   * Change the number of frames in the buffer pool while it is in use. Growing hands the new frames out right away.
+   * Shrinking stops handing out the frames beyond the new size, evicts them as they become unpinned and returns once
+   * the last one is released, so the caller must not hold a pin on any page while shrinking the pool.
+   * @param pool_size the new number of frames, must be positive
+   */
+  void Resize(size_t pool_size) { ResizeImp(pool_size); }
+
+  /**
+   * Take the dirty page table for a fuzzy checkpoint, without stopping anyone. It lists every page whose latest changes
+   * may not be on disk yet, with its recLSN: no log record older than the recLSN changed the page since it was last
+   * written. Pinned pages are listed even if they are clean, since they may be in the middle of a change.
+   * @return the pages with their recLSNs
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPageTable() { return GetDirtyPgTblImp(); }
+
+  /**
+   * Write back dirty pages whose recLSN is below the given LSN, the way the page cleaner does: from copies taken under
+   * the page latch, and skipping pages whose latest log record is not yet durable. Once there is nothing left to write,
+   * the writes of such pages that are still in flight elsewhere are waited for.
+   * @param rec_lsn only pages dirty since before this LSN are written
+   * @param max_pages the most pages to write
+   * @return the number of pages written or waited for, 0 once there is nothing left that can be written
+   */
+  size_t FlushDirtyPages(lsn_t rec_lsn, size_t max_pages) { return FlushDirtyPgsImp(rec_lsn, max_pages); }
+
   /** @return size of the buffer pool */
   virtual size_t GetPoolSize() = 0;
 
+  /** @return the counters of the buffer pool since it was created */
+  virtual BufferPoolStats GetStats() = 0;
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -105,9 +251,10 @@ class BufferPoolManager {
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
+   * @param hint how the caller is going to use the page
    * @return the requested page
    */
-  virtual Page *FetchPgImp(page_id_t page_id) = 0;
+  virtual Page *FetchPgImp(page_id_t page_id, AccessHint hint) = 0;
 
   /**
    * Unpin the target page from the buffer pool.
@@ -127,9 +274,19 @@ class BufferPoolManager {
   /**
    * Creates a new page in the buffer pool.
    * @param[out] page_id id of created page
+   * @param hint how the caller is going to use the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  virtual Page *NewPgImp(page_id_t *page_id, AccessHint hint) = 0;
+
+  /**
+   * Creates a new page in the buffer pool, in the caller's extent.
+   * @param[out] page_id id of created page
+   * @param[in,out] extent first page id of the caller's extent, INVALID_PAGE_ID before its first page
+   * @param hint how the caller is going to use the page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  virtual Page *NewPgImp(page_id_t *page_id) = 0;
+  virtual Page *NewPgInExtentImp(page_id_t *page_id, page_id_t *extent, AccessHint hint) = 0;
 
   /**
    * Deletes a page from the buffer pool.
@@ -142,5 +299,49 @@ class BufferPoolManager {
    * Flushes all the pages in the buffer pool to disk.
    */
   virtual void FlushAllPgsImp() = 0;
+
+  /**
+   * Queues pages to be read into the buffer pool in the background.
+   * @param page_ids the pages to read
+   * @param hint how the pages are going to be fetched
+   */
+  virtual void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, AccessHint hint) = 0;
+
+  /**
+   * Calls reader on the page under its read latch, if the page is resident.
+   * @param page_id the page to look at
+   * @param reader called with the page
+   * @return false if the page is not resident
+   */
+  virtual bool ReadResidentPgImp(page_id_t page_id, const std::function<void(Page *)> &reader) = 0;
+
+  /**
+   * Changes the number of frames in the buffer pool.
+   * @param pool_size the new number of frames
+   */
+  virtual void ResizeImp(size_t pool_size) = 0;
+
+  /**
+   * Writes the hot page manifest of the buffer pool.
+   */
+  virtual void SaveHotPgsImp() = 0;
+
+  /**
+   * Takes the dirty page table of the buffer pool.
+   * @return the pages with their recLSNs
+   */
+  virtual std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPgTblImp() = 0;
+
+  /**
+   * Writes back dirty pages whose recLSN is below the given LSN.
+   * @param rec_lsn only pages dirty since before this LSN are written
+   * @param max_pages the most pages to write
+   * @return the number of pages written
+   */
+  virtual size_t FlushDirtyPgsImp(lsn_t rec_lsn, size_t max_pages) = 0;
+
+ private:
+  /** Pages a scan keeps prefetched ahead of itself. */
+  std::atomic<size_t> prefetch_window_ = PREFETCH_WINDOW;
 };
 }  // namespace bustub
@@ -12,12 +12,29 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
-#include <mutex>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/chunked_array.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/frame_arena.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/page_table.h"
+#include "common/latency_histogram.h"
+#include "common/striped_counter.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -26,6 +43,26 @@ namespace bustub {
 
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * Fetching a resident page and unpinning a page only take a read latch on one shard of the page table; the pin count
+ * is bumped while that latch is held, and eviction removes a page from the page table under the shard's write latch
+ * only if its pin count is zero. Misses, new pages, deletes and flushes are serialized by bufTabMutex. The replacer is
+ * updated outside of any latch and may briefly offer a frame that has just been pinned again; such a victim is
+ * skipped.
+ *
+ * Unpinning a page as dirty only marks it. A page cleaner thread writes dirty pages back in page id order whenever more
+ * than a target fraction of the pool is dirty, and eviction writes back whatever dirty victim it picks.
+ *
+ * PrefetchPages queues pages for a small pool of I/O threads that read them into unpinned frames. A fetch that misses
+ * on a page that is still queued reads it itself and cancels the prefetch. Prefetch reads, page cleaner writes and
+ * FlushAllPages go through the DiskManager's asynchronous calls, so a whole batch is in flight at once.
+ *
+ * Frame bookkeeping lives in a ChunkedArray and frame data in one FrameArena per growth step, so Resize can add or
+ * retire frames without moving the ones in use. Frames at or beyond pool_size_ are being retired: they are never
+ * handed out again, and stale replacer victims among them are dropped.
+ *
+ * With enable_warm_restart on, an instance saves the ids of its resident pages, most recently accessed first, in a
+ * manifest kept by the DiskManager when it is destroyed, and a new instance on the same database prefetches them.
  */
 class BufferPoolManagerInstance : public BufferPoolManager {
  public:
@@ -34,8 +71,10 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
    */
-  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
   /**
    * Creates a new BufferPoolManagerInstance.
    * @param pool_size the size of the buffer pool
@@ -43,9 +82,11 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
@@ -55,17 +96,85 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override { return pool_size_; }
 
-  /** @return pointer to all the pages in the buffer pool */
-  Page *GetPages() { return pages_; }
+  /** @return the counters of the instance */
+  BufferPoolStats GetStats() override;
 
+  /**
+   * @param frame_id a frame below the pool size
+   * @return the page held by the frame
+   */
+  Page *GetFrame(frame_id_t frame_id) { return &frames_[frame_id].page_; }
+
+  /** @return number of frames on the free list; like the other load counts it may be stale by the time it is used */
+  size_t GetFreeFrameCount() const { return num_free_frames_; }
+
+  /** @return number of frames holding an unpinned page, which can be evicted to make room for another page */
+  size_t GetEvictableFrameCount() const {
+    size_t used = num_pinned_frames_ + num_free_frames_;
+    size_t pool_size = pool_size_;
+    return used < pool_size ? pool_size - used : 0;
+  }
+
+  /**
+   * Set how much of the pool may be dirty before the page cleaner starts writing pages back.
+   * @param fraction a fraction of the pool size; 1 leaves all writes to eviction and explicit flushes
+   */
+  void SetCleanerDirtyTarget(double fraction) {
+    cleaner_dirty_target_ = fraction;
+    cleaner_cv_.notify_one();
+  }
+
+  /**
+   * Set how many pages the page cleaner writes per round before it checks the dirty page count again.
+   * @param batch_size the number of pages, must be positive
+   */
+  void SetCleanerBatchSize(size_t batch_size) { cleaner_batch_size_ = batch_size; }
+
+  /** @return number of dirty pages in the pool */
+  size_t GetDirtyPageCount() const { return num_dirty_; }
+
+  /** @return number of dirty unpins of pages that were already dirty, each of which used to cost a write */
+  size_t GetAbsorbedWriteCount() const { return absorbed_writes_; }
+
+  /** @return number of pages written back by the page cleaner */
+  size_t GetCleanerWriteCount() const { return cleaner_writes_; }
+
+  /** @return number of dirty pages written back because their frame was needed for another page */
+  size_t GetEvictionWriteCount() const { return eviction_writes_; }
+
+  /**
+   * Turn prefetching on or off. While it is off PrefetchPages does nothing.
+   * @param enabled true to honor PrefetchPages
+   */
+  void SetPrefetchEnabled(bool enabled) { prefetch_enabled_ = enabled; }
+
+  /** @return number of fetches that found their page already read by a prefetch */
+  size_t GetPrefetchHitCount() const { return prefetch_hits_; }
+
+  /** @return number of fetches that had to read their page because its prefetch had not started yet */
+  size_t GetPrefetchMissCount() const { return prefetch_misses_; }
+
+  /** @return number of prefetched pages that were evicted before anybody fetched them */
+  size_t GetPrefetchWasteCount() const { return prefetch_wasted_; }
+
+  /**
+   * Create a page for an id that has already been allocated on disk.
+   * @param page_id id of the page, which must mod back to this instance
+   * @param hint how the caller is going to use the page
+   * @param[out] resident set to true iff the page was not created because a frame already holds the id and is pinned.
+   * A stale prefetch of the free page that nobody pinned is dropped instead.
+   * @return nullptr if the page could not be created, otherwise pointer to the new page
+   */
+  Page *NewPageAt(page_id_t page_id, AccessHint hint, bool *resident);
 
  protected:
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
+   * @param hint how the caller is going to use the page
    * @return the requested page
    */
-  Page *FetchPgImp(page_id_t page_id) override;
+  Page *FetchPgImp(page_id_t page_id, AccessHint hint) override;
 
   /**
    * Unpin the target page from the buffer pool.
@@ -85,9 +194,20 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /**
    * Creates a new page in the buffer pool.
    * @param[out] page_id id of created page
+   * @param hint how the caller is going to use the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *NewPgImp(page_id_t *page_id, AccessHint hint) override;
+
+  /**
+   * Creates a new page in the buffer pool, in the caller's extent. Only for instances that are not part of a parallel
+   * buffer pool manager, which creates pages in extents through NewPageAt instead.
+   * @param[out] page_id id of created page
+   * @param[in,out] extent first page id of the caller's extent, INVALID_PAGE_ID before its first page
+   * @param hint how the caller is going to use the page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  Page *NewPgImp(page_id_t *page_id) override;
+  Page *NewPgInExtentImp(page_id_t *page_id, page_id_t *extent, AccessHint hint) override;
 
   /**
    * Deletes a page from the buffer pool.
@@ -101,20 +221,295 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void FlushAllPgsImp() override;
 
-  Page *GetPage(page_id_t page_id);
   /**
-   * Allocate a page on disk.∂
+   * Queues pages to be read into the buffer pool by the prefetch threads.
+   * @param page_ids the pages to read
+   * @param hint how the pages are going to be fetched
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, AccessHint hint) override;
+
+  /**
+   * Calls reader on the page under its read latch, if the page is resident. The page is pinned transiently, like a
+   * page that is being written back, and the replacer does not hear about it.
+   * @param page_id the page to look at
+   * @param reader called with the page
+   * @return false if the page is not resident
+   */
+  bool ReadResidentPgImp(page_id_t page_id, const std::function<void(Page *)> &reader) override;
+
+  /**
+   * Changes the number of frames in the buffer pool.
+   * @param pool_size the new number of frames
+   */
+  void ResizeImp(size_t pool_size) override;
+
+  /**
+   * Writes the ids of the resident pages, most recently accessed first, to this instance's manifest.
+   */
+  void SaveHotPgsImp() override;
+
+  /**
+   * Lists the pages that are dirty, pinned or being written by the page cleaner, with their recLSNs. Evictions and
+   * flushes write under bufTabMutex, so holding it means that no page is missing because it is halfway to disk.
+   * @return the pages with their recLSNs
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPgTblImp() override;
+
+  /**
+   * Writes back dirty pages whose recLSN is below rec_lsn, in page id order.
+   * @param rec_lsn only pages dirty since before this LSN are written
+   * @param max_pages the most pages to write
+   * @return the number of pages written
+   */
+  size_t FlushDirtyPgsImp(lsn_t rec_lsn, size_t max_pages) override;
+
+  /**
+   * Queue the pages of this instance's manifest for the prefetch threads: as many of the hottest ones as the pool
+   * holds, in batches of WARM_RESTART_BATCH_SIZE sorted by page id so that the reads within a batch stay sequential.
+   */
+  void LoadHotPages();
+
+  /** @return bufTabMutex, locked; the time spent waiting for it is added to the latch wait counters */
+  std::unique_lock<std::mutex> LockBufTab();
+
+  /** Count a frame whose pin count has just left zero. */
+  void CountPinnedFrame();
+
+  /**
+   * Record an access to a frame for the hot page manifest.
+   * @param frame_id the frame
+   */
+  void Touch(frame_id_t frame_id) {
+    frames_[frame_id].last_access_.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                                         std::memory_order_relaxed);
+  }
+
+  /**
+   * Add the frames [pool_size_, pool_size) and put them on the free list. Caller must hold bufTabMutex.
+   * @param pool_size the new number of frames
+   */
+  void GrowFrames(size_t pool_size);
+
+  /**
+   * Evict the page held by a frame that is being retired and make the replacer forget the frame. Caller must hold
+   * bufTabMutex.
+   * @param frame_id a frame at or beyond pool_size_
+   * @return false if the frame is still pinned
+   */
+  bool RetireFrame(frame_id_t frame_id);
+
+  /** @return the maximum number of frames in each ring for a pool of the given size */
+  static size_t RingSize(size_t pool_size) {
+    return std::min(pool_size, std::clamp<size_t>(pool_size / 8, 2, BUFFER_RING_SIZE));
+  }
+
+  /** Body of a prefetch thread: read queued pages until the instance is destroyed. */
+  void RunPrefetcher();
+
+  /**
+   * Read pages into unpinned frames, skipping those already resident. The frames are claimed under bufTabMutex, the
+   * reads are issued together without it, and the pages are published under it again.
+   * @param pages the pages to read, each with how it is going to be fetched
+   */
+  void PrefetchBatch(const std::vector<std::pair<page_id_t, AccessHint>> &pages);
+
+  /**
+   * Read a page that is not resident into a frame found for the given access. Caller must hold bufTabMutex.
+   * @param page_id the page to read
+   * @param hint how the page is going to be fetched
+   * @param pin_count the pin count of the page once it is resident
+   * @param[out] frame_id the frame the page was read into
+   * @return false if every frame is pinned
+   */
+  bool LoadPage(page_id_t page_id, AccessHint hint, int pin_count, frame_id_t *frame_id);
+
+  /**
+   * Wait until no write of the page is in flight, then register one. Every write of a page goes between BeginWriteBack
+   * and EndWriteBack, so that two writes of one page never race and the later one always lands last.
+   * @param page_id the page about to be written
+   */
+  void BeginWriteBack(page_id_t page_id);
+
+  /**
+   * Register a write of the page unless one is already in flight.
+   * @param page_id the page about to be written
+   * @return false if a write of the page is in flight
+   */
+  bool TryBeginWriteBack(page_id_t page_id);
+
+  /**
+   * Unregister a write of the page once it has landed.
+   * @param page_id the page that was written
+   */
+  void EndWriteBack(page_id_t page_id);
+
+  /**
+   * Wait until no write of the page is in flight, so that reading the page from disk returns its latest contents.
+   * @param page_id the page about to be read
+   */
+  void WaitForWriteBack(page_id_t page_id);
+
+  /**
+   * First half of LoadPage: find a frame and set up its metadata for the page, but neither read the page nor make it
+   * visible. Caller must hold bufTabMutex until PublishFrame, unless the page is in prefetch_reads_.
+   * @return false if every frame is pinned
+   */
+  bool ClaimFrame(page_id_t page_id, AccessHint hint, int pin_count, frame_id_t *frame_id);
+
+  /**
+   * Second half of LoadPage: once the page has been read into a claimed frame, make it visible. Caller must hold
+   * bufTabMutex.
+   */
+  void PublishFrame(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Pin a resident page.
+   * @param page_id the page to pin
+   * @param[out] frame_id the frame holding the page
+   * @param transient true if the pin is only held for a moment to write the page back or peek at it, which is not an
+   * access of the page, see Frame::transient_pins_
+   * @return false if the page is not resident
+   */
+  bool PinResidentPage(page_id_t page_id, frame_id_t *frame_id, bool transient = false);
+
+  /**
+   * Unpin a page, the way UnpinPgImp does.
+   * @param page_id the page to unpin
+   * @param is_dirty true if the page was modified
+   * @param transient true to release a transient pin of PinResidentPage. It is uncounted under the page table shard's
+   * latch, before a shrink can retire the frame.
+   * @return false if the page was not pinned
+   */
+  bool UnpinResidentPage(page_id_t page_id, bool is_dirty, bool transient);
+
+  /**
+   * Mark a pinned page dirty.
+   * @param page the page
+   */
+  void MarkDirty(Page *page);
+
+  /**
+   * Mark a page clean before it is written back or discarded.
+   * @param page the page
+   * @return true if the page was dirty
+   */
+  bool MarkClean(Page *page);
+
+  /** @return the number of dirty pages above which the page cleaner starts writing pages back */
+  size_t GetDirtyPageLimit() const { return static_cast<size_t>(cleaner_dirty_target_ * pool_size_); }
+
+  /** Body of the page cleaner thread: clean batches of pages while the pool is above its dirty target. */
+  void RunPageCleaner();
+
+  /**
+   * Write back up to cleaner_batch_size_ dirty pages, in page id order starting after the last page written by the
+   * previous round. Pages whose LSN is not yet persistent in the log are skipped.
+   * @return the number of pages written
+   */
+  size_t CleanDirtyPages();
+
+  /**
+   * Write back the pages that are still dirty among the given ones, up to max_pages of them. Every page is copied under
+   * its read latch and the copies are written together. Pages whose LSN is not yet persistent in the log, and pages
+   * with a write already in flight, are skipped.
+   * @param page_ids the candidate pages, in the order to write them
+   * @param max_pages the most pages to write
+   * @param[out] last_written if not null, set to the last page written
+   * @return the number of pages written
+   */
+  size_t WriteBackPages(const std::vector<page_id_t> &page_ids, size_t max_pages, page_id_t *last_written);
+
+  /**
+   * @return an LSN that no change made to a page from now on is logged below, used as the recLSN of a page that is
+   * clean now
+   */
+  lsn_t GetCleanLSN() const { return log_manager_ == nullptr ? 0 : log_manager_->GetNextLSN(); }
+
+  /**
+   * Find a frame to hold a new page, preferring the free list over the replacer. A victim taken from the replacer is
+   * written back if dirty and removed from the page table. If every frame is pinned, but some only transiently, waits
+   * for one of those. Caller must hold bufTabMutex.
+   * @param[out] frame_id the frame that can be reused
+   * @return false if every frame is pinned
+   */
+  bool FindVictimFrame(frame_id_t *frame_id);
+
+  /**
+   * Find a frame for a page loaded on behalf of a SEQUENTIAL_SCAN or BULK_WRITE access. Until the access's ring is
+   * full, frames come from FindVictimFrame and join the ring. After that the oldest frame of the ring is recycled if it
+   * is unpinned; if it is still pinned it is handed back to the main pool and replaced by a frame from
+   * FindVictimFrame. Caller must hold bufTabMutex.
+   * @param hint the access the frame is for, must not be NORMAL
+   * @param[out] frame_id the frame that can be reused
+   * @return false if every frame is pinned
+   */
+  bool FindRingFrame(AccessHint hint, frame_id_t *frame_id);
+
+  /**
+   * Detach a frame from the ring that owns it, making it an ordinary frame managed by the replacer. The caller is
+   * responsible for handing the frame to the replacer if it is unpinned. Caller must hold bufTabMutex.
+   * @param frame_id a frame that belongs to a ring
+   */
+  void LeaveRing(frame_id_t frame_id);
+
+  /**
+   * Drop the page held by a frame from the page table if the frame is unpinned, and write it back if it is dirty.
+   * Caller must hold bufTabMutex.
+   * @param frame_id the frame that is about to be reused
+   * @return false if the frame holds no page or is pinned, in which case nothing happens
+   */
+  bool EvictFrame(frame_id_t frame_id);
+
+  /**
+   * Evict a frame that only holds transient pins, once they are released. Gives up as soon as anybody else pins the
+   * frame. Caller must hold bufTabMutex.
+   * @param frame_id the frame that is about to be reused
+   * @return true if the frame was evicted
+   */
+  bool EvictAfterTransientPins(frame_id_t frame_id);
+
+  /** @return true if every pin the frame holds may be a transient pin, including when it holds none */
+  bool IsPinnedTransientlyOnly(frame_id_t frame_id);
+
+  /**
+   * WAL: make sure the log records that changed a page are durable before the page is written. Blocks until they are.
+   * @param lsn the page LSN of the page about to be written
+   */
+  void FlushLogUpTo(lsn_t lsn);
+
+  /**
+   * Find a frame for a new page. Caller must hold bufTabMutex.
+   * @param hint how the caller is going to use the page
+   * @param[out] frame_id the frame
+   * @return false if every frame is pinned
+   */
+  bool FindNewPageFrame(AccessHint hint, frame_id_t *frame_id);
+
+  /**
+   * Set up a frame found by FindNewPageFrame for a new, zeroed page, pinned once. Caller must hold bufTabMutex.
+   * @return the page
+   */
+  Page *InitNewPage(frame_id_t frame_id, page_id_t page_id);
+
+  /**
+   * Drop a page from the buffer pool, without writing it back, and return its frame to the free list. A prefetch still
+   * reading the page in is cancelled. Caller must hold bufTabMutex.
+   * @param page_id the page to drop
+   * @return false if the page is pinned, true if it was dropped or was not resident
+   */
+  bool DropPage(page_id_t page_id);
+
+  /**
+   * Allocate a page on disk. Caller must hold bufTabMutex.
    * @return the id of the allocated page
    */
   page_id_t AllocatePage();
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, so that its id can be handed out again.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id) { disk_manager_->DeallocatePage(page_id); }
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -123,28 +518,129 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
-  /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
+  /** Number of pages in the buffer pool. Only changed under bufTabMutex. */
+  std::atomic<size_t> pool_size_;
   /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI) */
   const uint32_t num_instances_ = 1;
   /** Index of this BPI in the parallel BPM (if present, otherwise just 0) */
   const uint32_t instance_index_ = 0;
-  /** Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_ */
-  std::atomic<page_id_t> next_page_id_ = instance_index_;
 
-  /** Array of buffer pool pages. */
-  Page *pages_;
+  /** Value of Frame::ring_ for frames that are managed by the replacer. */
+  static constexpr int8_t NO_RING = -1;
+  /** Book-keeping of a frame. */
+  struct Frame {
+    /** The page held by the frame, pointing at the frame's data in one of arenas_. */
+    Page page_;
+    /**
+     * Index into rings_ of the ring the frame belongs to, or NO_RING. Ring frames never enter the replacer. Only
+     * written under bufTabMutex, but read by the latch-free hit and unpin paths.
+     */
+    std::atomic<int8_t> ring_;
+    /** True while the frame holds a prefetched page that nobody has fetched yet. */
+    std::atomic<bool> prefetched_;
+    /** Time of the last fetch of the page, on the steady clock. */
+    std::atomic<int64_t> last_access_;
+    /**
+     * While the page is dirty, its recLSN. While it is clean, the recLSN it gets once it is changed: every later change
+     * is logged at or after it. Only set where no change can be in progress, that is when the page is read or created
+     * and when the page cleaner has written a copy taken under the page's latch.
+     */
+    std::atomic<lsn_t> rec_lsn_;
+    /**
+     * Number of transient pins, held for a moment to write the page back or to peek at it. Such pins do not go
+     * through the replacer, so a frame the replacer hands out may still carry them; as long as they are the only pins,
+     * FindVictimFrame waits for them instead of giving up on the frame.
+     */
+    std::atomic<int> transient_pins_;
+  };
+  /** Every frame of the pool, including frames that are being retired by a shrink. */
+  ChunkedArray<Frame> frames_;
+  /** Data of the frames, one arena per growth step, each paired with the first frame it holds. */
+  std::vector<std::pair<size_t, std::unique_ptr<FrameArena>>> arenas_;
+  /** Serializes resizes, which drop bufTabMutex while they wait for pinned frames. */
+  std::mutex resize_latch_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
   /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  PageTable page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /** Frames recycled by SEQUENTIAL_SCAN (index 0) and BULK_WRITE (index 1) accesses, oldest first. */
+  std::array<std::deque<frame_id_t>, 2> rings_;
+  /** Maximum number of frames in each ring. */
+  size_t ring_size_;
+  /** Serializes changes to which page a frame holds, and protects free_list_, the rings and prefetch_reads_. */
   std::mutex bufTabMutex;
+  /**
+   * Pages a prefetch is reading in without holding bufTabMutex, with the frames claimed for them. DropPage cancels a
+   * prefetch by removing its page; the frame is then freed instead of published.
+   */
+  std::unordered_map<page_id_t, frame_id_t> prefetch_reads_;
+  /** Wakes up fetches waiting, under bufTabMutex, for a page in prefetch_reads_. */
+  std::condition_variable prefetch_read_cv_;
+  /** Size of free_list_, published for routing without taking bufTabMutex. */
+  std::atomic<size_t> num_free_frames_ = 0;
+  /** Number of frames with a non-zero pin count, maintained where pin counts leave or reach zero. */
+  std::atomic<size_t> num_pinned_frames_ = 0;
+
+  /** Statistics, see BufferPoolStats. Fetch hits are striped because they are counted on the latch-free path. */
+  StripedCounter fetch_hits_;
+  std::atomic<size_t> fetch_misses_ = 0;
+  std::atomic<size_t> evictions_ = 0;
+  std::atomic<size_t> new_page_failures_ = 0;
+  std::atomic<size_t> pinned_frames_high_water_ = 0;
+  std::atomic<size_t> latch_waits_ = 0;
+  std::atomic<uint64_t> latch_wait_ns_ = 0;
+  LatencyHistogram miss_latency_;
+
+  /** Number of dirty pages in the pool. */
+  std::atomic<size_t> num_dirty_ = 0;
+  /** Fraction of the pool that may be dirty before the page cleaner writes pages back. */
+  std::atomic<double> cleaner_dirty_target_ = PAGE_CLEANER_DIRTY_TARGET;
+  /** Number of pages the page cleaner writes per round. */
+  std::atomic<size_t> cleaner_batch_size_ = PAGE_CLEANER_BATCH_SIZE;
+  /** Write counters, see the corresponding getters. */
+  std::atomic<size_t> absorbed_writes_ = 0;
+  std::atomic<size_t> cleaner_writes_ = 0;
+  std::atomic<size_t> eviction_writes_ = 0;
+  /** Last page written by the page cleaner. Only used by the page cleaner thread. */
+  page_id_t cleaner_cursor_ = INVALID_PAGE_ID;
+  /** Protects cleaner_stop_. */
+  std::mutex cleaner_latch_;
+  /** Wakes up the page cleaner early when it should stop or the pool goes over its dirty target. */
+  std::condition_variable cleaner_cv_;
+  /** Set when the page cleaner should exit. */
+  bool cleaner_stop_ = false;
+  /** The page cleaner thread. */
+  std::thread cleaner_thread_;
+
+  /** Pages waiting for a prefetch thread, oldest first, with the hint they were requested with. */
+  std::deque<std::pair<page_id_t, AccessHint>> prefetch_queue_;
+  /** Pages in prefetch_queue_ whose prefetch has not been cancelled by a fetch. */
+  std::unordered_set<page_id_t> prefetch_pending_;
+  /** Pages with a write in flight. */
+  std::unordered_set<page_id_t> write_back_pending_;
+  /** Protects write_back_pending_. */
+  std::mutex write_back_latch_;
+  /** Wakes up threads waiting for a write to land. */
+  std::condition_variable write_back_cv_;
+  /** Protects prefetch_queue_, prefetch_pending_ and prefetch_stop_. */
+  std::mutex prefetch_latch_;
+  /** Wakes up the prefetch threads when pages are queued or they should stop. */
+  std::condition_variable prefetch_cv_;
+  /** Set when the prefetch threads should exit. */
+  bool prefetch_stop_ = false;
+  /** Whether PrefetchPages queues anything. */
+  std::atomic<bool> prefetch_enabled_ = true;
+  /** Prefetch counters, see the corresponding getters. */
+  std::atomic<size_t> prefetch_hits_ = 0;
+  std::atomic<size_t> prefetch_misses_ = 0;
+  std::atomic<size_t> prefetch_wasted_ = 0;
+  /** The prefetch threads. */
+  std::vector<std::thread> prefetch_threads_;
 };
 }  // namespace bustub
@@ -0,0 +1,61 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// chain_prefetcher.h
+//
+// Identification: src/include/buffer/chain_prefetcher.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/config.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * ChainPrefetcher keeps a window of pages ahead of a scan that follows a chain of pages, such as the pages of a table
+ * heap or the leaves of a B+ tree, queued for prefetching. The size of the window is the buffer pool's prefetch
+ * window.
+ *
+ * Only the page after the one the scan is on is known up front. The window is extended from its last page once that
+ * page has been read in, by peeking at it for the id of the page after it, so a cold scan fills the window over its
+ * first few pages and then keeps it full.
+ */
+class ChainPrefetcher {
+ public:
+  /** Reads the id of the page after a page of the chain, INVALID_PAGE_ID at the end of the chain. */
+  using NextPageIdFn = page_id_t (*)(Page *page);
+
+  /**
+   * Create a prefetcher with an empty window.
+   * @param buffer_pool_manager the buffer pool holding the chain
+   * @param hint how the scan fetches the pages
+   * @param next_page_id reads the link of a page of the chain
+   */
+  ChainPrefetcher(BufferPoolManager *buffer_pool_manager, AccessHint hint, NextPageIdFn next_page_id)
+      : buffer_pool_manager_(buffer_pool_manager), hint_(hint), next_page_id_(next_page_id) {}
+
+  /**
+   * Tell the prefetcher that the scan moved onto a page, and top up the window ahead of it.
+   * @param page_id the page the scan is on now
+   * @param next_page_id the page after it, INVALID_PAGE_ID at the end of the chain
+   */
+  void MoveTo(page_id_t page_id, page_id_t next_page_id);
+
+ private:
+  BufferPoolManager *buffer_pool_manager_;
+  AccessHint hint_;
+  NextPageIdFn next_page_id_;
+  /** Pages ahead of the scan whose prefetch has been asked for, in chain order. */
+  std::deque<page_id_t> window_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,82 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// chunked_array.h
+//
+// Identification: src/include/buffer/chunked_array.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+/**
+ * ChunkedArray is an array of per-frame bookkeeping that can grow and shrink while other threads index into it.
+ *
+ * Elements are allocated FRAME_CHUNK_SIZE at a time and reached through a fixed directory of chunk pointers, so an
+ * element never moves once allocated and lookups need no latch. Growing publishes new chunks with release stores;
+ * shrinking frees whole chunks beyond the new size, and the caller must guarantee that nobody still uses them.
+ * Grow and Shrink must be serialized by the caller.
+ */
+template <typename T>
+class ChunkedArray {
+ public:
+  /**
+   * Create an array with value-initialized elements.
+   * @param size the initial number of elements
+   */
+  explicit ChunkedArray(size_t size = 0) : chunks_(new std::atomic<T *>[MAX_FRAME_CHUNKS]) {
+    for (size_t i = 0; i < MAX_FRAME_CHUNKS; i++) {
+      chunks_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    Grow(size);
+  }
+
+  ~ChunkedArray() { Shrink(0); }
+
+  ChunkedArray(const ChunkedArray &) = delete;
+  ChunkedArray &operator=(const ChunkedArray &) = delete;
+
+  /** @return the element at index i, which must be below the current capacity */
+  T &operator[](size_t i) const {
+    return chunks_[i / FRAME_CHUNK_SIZE].load(std::memory_order_acquire)[i % FRAME_CHUNK_SIZE];
+  }
+
+  /** Allocate value-initialized elements until there are at least size of them. */
+  void Grow(size_t size) {
+    size_t num_chunks = (size + FRAME_CHUNK_SIZE - 1) / FRAME_CHUNK_SIZE;
+    BUSTUB_ASSERT(num_chunks <= MAX_FRAME_CHUNKS, "too many frames");
+    for (; num_chunks_ < num_chunks; num_chunks_++) {
+      chunks_[num_chunks_].store(new T[FRAME_CHUNK_SIZE](), std::memory_order_release);
+    }
+  }
+
+  /** Free the chunks that hold only elements at or beyond size. */
+  void Shrink(size_t size) {
+    size_t num_chunks = (size + FRAME_CHUNK_SIZE - 1) / FRAME_CHUNK_SIZE;
+    for (; num_chunks_ > num_chunks; num_chunks_--) {
+      delete[] chunks_[num_chunks_ - 1].exchange(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  /** @return the number of elements allocated */
+  size_t Capacity() const { return num_chunks_ * FRAME_CHUNK_SIZE; }
+
+ private:
+  /** Directory of chunk pointers; entries beyond num_chunks_ are null. */
+  std::unique_ptr<std::atomic<T *>[]> chunks_;
+  /** Number of allocated chunks. */
+  size_t num_chunks_ = 0;
+};
+
+}  // namespace bustub
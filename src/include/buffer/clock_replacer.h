@@ -12,10 +12,11 @@
 
 #pragma once
 
-#include <list>
+#include <atomic>
 #include <mutex>  // NOLINT
 #include <vector>
 
+#include "buffer/chunked_array.h"
 #include "buffer/replacer.h"
 #include "common/config.h"
 
@@ -23,14 +24,23 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * With max_usage > 1 it becomes GCLOCK: every unpin bumps a saturating usage counter instead of setting a single
+ * reference bit, and the hand decrements the counter on each pass. Unpinning a frame that is already evictable does
+ * nothing, so a frame is credited one use per pin/unpin cycle however often it is handed to the replacer.
+ *
+ * The usage counter and evictable flag of every frame are packed into one atomic byte, so Pin and Unpin touch nothing
+ * but that byte and never take a latch. Only Victim serializes, on the latch that guards the clock hand. There is no
+ * shared count of evictable frames for Pin and Unpin to contend on; Size() counts them from the state array instead.
  */
 class ClockReplacer : public Replacer {
  public:
   /**
    * Create a new ClockReplacer.
    * @param num_pages the maximum number of pages the ClockReplacer will be required to store
+   * @param max_usage the saturation point of the usage counter (1 gives plain CLOCK)
    */
-  explicit ClockReplacer(size_t num_pages);
+  explicit ClockReplacer(size_t num_pages, uint8_t max_usage = 1);
 
   /**
    * Destroys the ClockReplacer.
@@ -43,10 +53,28 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  void Remove(frame_id_t frame_id) override;
+
+  void Resize(size_t num_pages) override;
+
   size_t Size() override;
 
  private:
-  // TODO(student): implement me!
+  /** Number of frames in the clock. Only grows, under hand_latch_. */
+  std::atomic<size_t> num_pages_;
+  /** Saturation point of the usage counters. */
+  const uint8_t max_usage_;
+  /** Bit of a frame's state that is set while the frame is in the clock, i.e. unpinned. */
+  static constexpr uint8_t EVICTABLE = 0x80;
+  /** Bits of a frame's state that hold its usage counter (reference bit when max_usage_ == 1). */
+  static constexpr uint8_t USAGE_MASK = 0x7f;
+
+  /** Evictable flag and usage counter of every frame. */
+  ChunkedArray<std::atomic<uint8_t>> state_;
+  /** Position of the clock hand, only touched by Victim under hand_latch_. */
+  alignas(64) size_t hand_ = 0;
+  /** Serializes clock hand advances. */
+  std::mutex hand_latch_;
 };
 
 }  // namespace bustub
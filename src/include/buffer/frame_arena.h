@@ -0,0 +1,68 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * FrameArena holds the data of every frame of a buffer pool in one anonymous memory mapping.
+ *
+ * Frame i starts at offset i * PAGE_SIZE, so every frame is aligned to PAGE_SIZE and can be handed to O_DIRECT I/O as
+ * is. Arenas of at least one huge page are backed by explicit huge pages when the system has some reserved, and are
+ * otherwise advised for transparent huge pages, which cuts the number of TLB entries a large pool needs by 512.
+ */
+class FrameArena {
+ public:
+  /** Size of the huge pages the arena asks for. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * Map a zero-filled arena.
+   * @param num_frames the number of frames
+   * @param try_hugetlb whether to try explicit huge pages before falling back to transparent huge pages
+   */
+  explicit FrameArena(size_t num_frames, bool try_hugetlb = FRAME_ARENA_TRY_HUGETLB);
+
+  /** Unmap the arena. */
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  /**
+   * Unmap the frames beyond the first num_frames. The tail is released at the granularity of the pages backing the
+   * arena, so a huge page that is still partly in use stays mapped.
+   * @param num_frames the number of frames to keep
+   */
+  void Shrink(size_t num_frames);
+
+  /** @return the data of a frame */
+  char *GetFrameData(frame_id_t frame_id) { return data_ + static_cast<size_t>(frame_id) * PAGE_SIZE; }
+
+  /** @return true if the arena is backed by explicit huge pages */
+  bool IsHugeTlb() const { return hugetlb_; }
+
+ private:
+  /** Start of the mapping. */
+  char *data_;
+  /** Length of the mapping in bytes. */
+  size_t size_;
+  /** Whether the mapping uses explicit huge pages. */
+  bool hugetlb_ = false;
+};
+
+}  // namespace bustub
@@ -0,0 +1,123 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * A frame is "accessed" every time it is pinned, and the replacer remembers the logical timestamps of the last k
+ * accesses of every frame. The victim is the evictable frame with the largest backward k-distance, i.e. the oldest
+ * k-th most recent access. Frames that have been accessed fewer than k times have an infinite backward k-distance and
+ * are always evicted before frames that have reached k accesses, which is what keeps a single sequential scan from
+ * flushing the hot set; among them, the frame with the earliest access goes first.
+ *
+ * Evictable frames are kept in a binary min-heap on that eviction key, laid out in a vector and indexed by frame id,
+ * and every frame remembers its accesses in a fixed ring of k timestamps. Only Resize allocates, and
+ * Victim, Pin, Unpin and Remove take O(log n) array moves. Plain lists cannot do better without giving up the exact
+ * order: a frame that becomes evictable brings an eviction key from the past, which may belong anywhere among the
+ * others.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of accesses after which a frame is considered hot
+   */
+  explicit LRUKReplacer(size_t num_pages, size_t k = LRUK_REPLACER_K);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  bool Victim(frame_id_t *frame_id) override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  void Resize(size_t num_pages) override;
+
+  size_t Size() override;
+
+ private:
+  /** Heap position of a frame that is not evictable. */
+  static constexpr size_t NOT_EVICTABLE = std::numeric_limits<size_t>::max();
+  /** Added to the eviction key of a frame with k accesses, so that frames with fewer go first. */
+  static constexpr uint64_t HOT = uint64_t{1} << 63;
+
+  /** Per-frame bookkeeping. */
+  struct FrameNode {
+    /** Number of accesses in the history, at most k. */
+    size_t num_accesses_ = 0;
+    /** Index of the oldest access in the frame's ring of the history. */
+    size_t oldest_ = 0;
+    /** Position in heap_, or NOT_EVICTABLE. */
+    size_t heap_index_ = NOT_EVICTABLE;
+  };
+
+  /** Record an access of the frame at the current timestamp. Caller must hold latch_. */
+  void RecordAccess(frame_id_t frame_id);
+
+  /**
+   * @return the eviction key of the frame, which must have an access: its oldest remembered access, which is its k-th
+   * most recent one if it has k, plus HOT if it has k. Caller must hold latch_.
+   */
+  uint64_t KeyOf(frame_id_t frame_id) const;
+
+  /** Add the frame to the heap of evictable frames. Caller must hold latch_. */
+  void Push(frame_id_t frame_id);
+
+  /** Take the frame out of the heap of evictable frames. Caller must hold latch_. */
+  void Erase(frame_id_t frame_id);
+
+  /** Move the heap entry at index towards the root until its parent goes first. Caller must hold latch_. */
+  void SiftUp(size_t index);
+
+  /** Move the heap entry at index towards the leaves until it goes before its children. Caller must hold latch_. */
+  void SiftDown(size_t index);
+
+  /** Put an entry at a heap position and tell its frame. Caller must hold latch_. */
+  void Place(size_t index, std::pair<uint64_t, frame_id_t> entry);
+
+  /** Number of frames the replacer can track. */
+  size_t num_pages_;
+  /** Number of accesses the backward distance is measured over. */
+  const size_t k_;
+  /** Nodes for every frame. */
+  std::vector<FrameNode> nodes_;
+  /** The last k access timestamps of every frame, as a ring of k entries starting at frame_id * k. */
+  std::vector<uint64_t> history_;
+  /** Evictable frames with their eviction keys, a min-heap on the key. */
+  std::vector<std::pair<uint64_t, frame_id_t>> heap_;
+  /** Logical clock, advanced by every access. */
+  uint64_t current_timestamp_ = 0;
+  /** Protects all of the above. */
+  std::mutex latch_;
+};
+
+}  // namespace bustub
@@ -12,27 +12,23 @@
 
 #pragma once
 
-#include <list>
+#include <atomic>
 #include <mutex>  // NOLINT
 #include <vector>
-#include <unordered_map>
 
+#include "buffer/chunked_array.h"
 #include "buffer/replacer.h"
 #include "common/config.h"
-#include "storage/page/page.h"
 
 namespace bustub {
 
-//    typedef struct LRUlist {
-//        frame_id_t pageId;
-//        int64_t pinCount;
-//        LRUlist* prevSlot;
-//        LRUlist* nextSlot;
-//    }lruList;
-//
-//    using LRUList = lruList*;
 /**
  * LRUReplacer implements the Least Recently Used replacement policy.
+ *
+ * Evictable frames are kept in a doubly-linked list indexed by frame id, least recently unpinned first. Pin is what
+ * every buffer pool hit calls, so it takes no latch: it only clears the frame's evictable flag and leaves the frame in
+ * the list. Victim drops such stale entries as it comes across them and Unpin moves them to the tail, so every
+ * operation is O(1) and only Victim, Unpin and Remove serialize, on latch_.
  */
 class LRUReplacer : public Replacer {
  public:
@@ -53,24 +49,41 @@ class LRUReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
-  size_t Size() override;
-
-  void AddPinCount(frame_id_t id);
+  void Remove(frame_id_t frame_id) override;
 
-  int GetPinCount(frame_id_t id);
+  void Resize(size_t num_pages) override;
 
-  void SetPinCount(frame_id_t id);
-
-  void ReleasePinLock();
+  size_t Size() override;
 
-  void GetPinLock();
  private:
-  // TODO(student): implement me!
-  size_t max_page_size_ = 0;
-  std::unordered_map<frame_id_t, int> bufPinCnt;
-  std::mutex pinLatch_;
-  std::mutex lruMutex;
-  std::list<frame_id_t> lru_list;
+  /** Link of a frame that is not in the list, and of the ends of the list. */
+  static constexpr frame_id_t NIL = -1;
+
+  /** Position of a frame in the list, while it is in it. */
+  struct ListNode {
+    frame_id_t prev_ = NIL;
+    frame_id_t next_ = NIL;
+    bool linked_ = false;
+  };
+
+  /** Take the frame out of the list. Caller must hold latch_. */
+  void Unlink(frame_id_t frame_id);
+
+  /** Append the frame to the tail of the list. Caller must hold latch_. */
+  void PushBack(frame_id_t frame_id);
+
+  /** Number of frames the replacer can track. Only grows, under latch_. */
+  std::atomic<size_t> num_pages_;
+  /** Whether each frame is evictable. A frame in the list whose flag is clear was pinned after it was unpinned. */
+  ChunkedArray<std::atomic<bool>> evictable_;
+  /** List links of every frame. */
+  std::vector<ListNode> nodes_;
+  /** Least recently unpinned frame in the list. */
+  frame_id_t head_ = NIL;
+  /** Most recently unpinned frame in the list. */
+  frame_id_t tail_ = NIL;
+  /** Protects the list. */
+  std::mutex latch_;
 };
 
 }  // namespace bustub
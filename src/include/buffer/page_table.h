@@ -0,0 +1,123 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_table.h
+//
+// Identification: src/include/buffer/page_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <unordered_map>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * PageTable maps the ids of resident pages to the frames that hold them.
+ *
+ * The table is split into independently latched shards so that lookups for different pages never contend. Callers
+ * that need to act on a frame atomically with respect to its mapping (pinning it on a hit, or checking that it is
+ * unpinned before evicting it) pass a callback that runs while the shard latch is held.
+ */
+class PageTable {
+ public:
+  /**
+   * Create a new PageTable.
+   * @param num_shards the number of shards, rounded up to a power of two
+   */
+  explicit PageTable(size_t num_shards = PAGE_TABLE_SHARDS);
+
+  /**
+   * Look up a page and, if it is resident, call on_hit with its frame while the shard is read-latched. The mapping
+   * cannot be removed while on_hit runs.
+   * @param page_id the page to look up
+   * @param on_hit callback taking the frame id
+   * @return true if the page is resident
+   */
+  template <typename Callback>
+  bool Find(page_id_t page_id, Callback &&on_hit) {
+    Shard &shard = GetShard(page_id);
+    std::shared_lock latch(shard.latch_);
+    auto iter = shard.map_.find(page_id);
+    if (iter == shard.map_.end()) {
+      return false;
+    }
+    on_hit(iter->second);
+    return true;
+  }
+
+  /**
+   * Look up the frame of a resident page.
+   * @param page_id the page to look up
+   * @param[out] frame_id the frame holding the page
+   * @return true if the page is resident
+   */
+  bool Find(page_id_t page_id, frame_id_t *frame_id) {
+    return Find(page_id, [frame_id](frame_id_t found) { *frame_id = found; });
+  }
+
+  /**
+   * Map a page to a frame.
+   * @param page_id the page, which must not be resident yet
+   * @param frame_id the frame holding the page
+   */
+  void Insert(page_id_t page_id, frame_id_t frame_id);
+
+  /**
+   * Remove a page if can_remove, called with its frame while the shard is write-latched, agrees.
+   * @param page_id the page to remove
+   * @param can_remove predicate taking the frame id
+   * @return true if the page was resident and has been removed
+   */
+  template <typename Predicate>
+  bool RemoveIf(page_id_t page_id, Predicate &&can_remove) {
+    Shard &shard = GetShard(page_id);
+    std::unique_lock latch(shard.latch_);
+    auto iter = shard.map_.find(page_id);
+    if (iter == shard.map_.end() || !can_remove(iter->second)) {
+      return false;
+    }
+    shard.map_.erase(iter);
+    return true;
+  }
+
+  /**
+   * Call visit with every (page id, frame id) pair, read-latching one shard at a time.
+   * @param visit callback taking the page id and the frame id
+   */
+  template <typename Callback>
+  void ForEach(Callback &&visit) {
+    for (size_t i = 0; i <= shard_mask_; i++) {
+      std::shared_lock latch(shards_[i].latch_);
+      for (const auto &[page_id, frame_id] : shards_[i].map_) {
+        visit(page_id, frame_id);
+      }
+    }
+  }
+
+ private:
+  /** One independently latched part of the table, padded so that neighbouring latches do not share a cache line. */
+  struct alignas(64) Shard {
+    std::shared_mutex latch_;
+    std::unordered_map<page_id_t, frame_id_t> map_;
+  };
+
+  Shard &GetShard(page_id_t page_id) {
+    // Fibonacci hashing spreads the strided page ids of a parallel buffer pool instance over all shards.
+    return shards_[(static_cast<uint32_t>(page_id) * 2654435761U >> 16) & shard_mask_];
+  }
+
+  size_t shard_mask_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace bustub
@@ -12,7 +12,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/buffer_pool_manager_instance.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -27,9 +33,10 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    * @param pool_size the pool size of each BufferPoolManagerInstance
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy of every BufferPoolManagerInstance
    */
   ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                            LogManager *log_manager = nullptr);
+                            LogManager *log_manager = nullptr, ReplacerType replacer_type = ReplacerType::LRU);
 
   /**
    * Destroys an existing ParallelBufferPoolManager.
@@ -39,6 +46,38 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   size_t GetPoolSize() override;
 
+  /** @return the counters of all instances added up */
+  BufferPoolStats GetStats() override;
+
+  /** Set the page cleaner dirty target of every instance, see BufferPoolManagerInstance::SetCleanerDirtyTarget. */
+  void SetCleanerDirtyTarget(double fraction);
+
+  /** Set the page cleaner batch size of every instance, see BufferPoolManagerInstance::SetCleanerBatchSize. */
+  void SetCleanerBatchSize(size_t batch_size);
+
+  /** @return number of dirty unpins of already dirty pages, summed over all instances */
+  size_t GetAbsorbedWriteCount();
+
+  /** @return number of pages written back by the page cleaners, summed over all instances */
+  size_t GetCleanerWriteCount();
+
+  /**
+   * Choose how NewPage picks an instance. Load-aware allocation tries instances with free frames first, then those
+   * with the most evictable frames, and only then instances whose frames all look pinned; plain round-robin tries
+   * every instance in turn.
+   * @param enabled true for load-aware allocation, the default
+   */
+  void SetLoadAwareAllocation(bool enabled) { load_aware_allocation_ = enabled; }
+
+  /** Turn prefetching on or off in every instance, see BufferPoolManagerInstance::SetPrefetchEnabled. */
+  void SetPrefetchEnabled(bool enabled);
+
+  /** @return number of fetches served by a prefetched page, summed over all instances */
+  size_t GetPrefetchHitCount();
+
+  /** @return number of fetches that had to read a page whose prefetch was still queued, summed over all instances */
+  size_t GetPrefetchMissCount();
+
  protected:
   /**
    * @param page_id id of page
@@ -49,9 +88,10 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
+   * @param hint how the caller is going to use the page
    * @return the requested page
    */
-  Page *FetchPgImp(page_id_t page_id) override;
+  Page *FetchPgImp(page_id_t page_id, AccessHint hint) override;
 
   /**
    * Unpin the target page from the buffer pool.
@@ -71,9 +111,19 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /**
    * Creates a new page in the buffer pool.
    * @param[out] page_id id of created page
+   * @param hint how the caller is going to use the page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
-  Page *NewPgImp(page_id_t *page_id) override;
+  Page *NewPgImp(page_id_t *page_id, AccessHint hint) override;
+
+  /**
+   * Creates a new page in the caller's extent, in the instance its id maps to.
+   * @param[out] page_id id of created page
+   * @param[in,out] extent first page id of the caller's extent, INVALID_PAGE_ID before its first page
+   * @param hint how the caller is going to use the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  Page *NewPgInExtentImp(page_id_t *page_id, page_id_t *extent, AccessHint hint) override;
 
   /**
    * Deletes a page from the buffer pool.
@@ -86,5 +136,53 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    * Flushes all the pages in the buffer pool to disk.
    */
   void FlushAllPgsImp() override;
+
+  /**
+   * Queues pages to be read into the buffer pool in the background, each by its own instance.
+   * @param page_ids the pages to read
+   * @param hint how the pages are going to be fetched
+   */
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, AccessHint hint) override;
+
+  /**
+   * Calls reader on the page under its read latch, if the page is resident in its instance.
+   * @param page_id the page to look at
+   * @param reader called with the page
+   * @return false if the page is not resident
+   */
+  bool ReadResidentPgImp(page_id_t page_id, const std::function<void(Page *)> &reader) override;
+
+  /**
+   * Resizes every instance to an equal share of the new number of frames.
+   * @param pool_size the new total number of frames, at least one per instance
+   */
+  void ResizeImp(size_t pool_size) override;
+
+  /**
+   * Writes the hot page manifest of every instance.
+   */
+  void SaveHotPgsImp() override;
+
+  /**
+   * Takes the dirty page table of every instance.
+   * @return the pages with their recLSNs
+   */
+  std::vector<std::pair<page_id_t, lsn_t>> GetDirtyPgTblImp() override;
+
+  /**
+   * Writes back dirty pages whose recLSN is below rec_lsn, instance by instance, up to max_pages in all.
+   * @param rec_lsn only pages dirty since before this LSN are written
+   * @param max_pages the most pages to write
+   * @return the number of pages written
+   */
+  size_t FlushDirtyPgsImp(lsn_t rec_lsn, size_t max_pages) override;
+
+  DiskManager *disk_manager_;
+  /** The instances, page p lives in instances_[p % instances_.size()]. */
+  std::vector<std::unique_ptr<BufferPoolManagerInstance>> instances_;
+  /** Instance at which the next NewPgImp starts looking for a free frame. */
+  std::atomic<size_t> next_instance_{0};
+  /** Whether NewPgImp ranks instances by their free and evictable frames. */
+  std::atomic<bool> load_aware_allocation_{true};
 };
 }  // namespace bustub
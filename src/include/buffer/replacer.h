@@ -16,6 +16,11 @@
 
 namespace bustub {
 
+/**
+ * The replacement policies a BufferPoolManagerInstance can be constructed with.
+ */
+enum class ReplacerType { LRU, LRU_K, CLOCK };
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -43,6 +48,20 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Forgets a frame whose page has been deleted, so that its access history does not carry over to the next page
+   * loaded into it. Policies without per-frame history can simply stop tracking the frame.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
+  /**
+   * Makes room for frames up to num_pages when the buffer pool grows. Shrinking never releases storage: the buffer
+   * pool Removes the frames it retires, and a stale Victim beyond the pool size is simply skipped.
+   * @param num_pages the new number of frames in the buffer pool
+   */
+  virtual void Resize(size_t num_pages) = 0;
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual size_t Size() = 0;
 };
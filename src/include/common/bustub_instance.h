@@ -17,7 +17,7 @@
 #include "concurrency/lock_manager.h"
 #include "recovery/checkpoint_manager.h"
 #include "recovery/log_manager.h"
-#include "storage/disk/disk_manager.h"
+#include "storage/disk/file_disk_manager.h"
 
 namespace bustub {
 
@@ -27,7 +27,7 @@ class BustubInstance {
     enable_logging = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new FileDiskManager(db_file_name);
 
     // log related
     log_manager_ = new LogManager(disk_manager_);
@@ -39,7 +39,8 @@ class BustubInstance {
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
 
     // checkpoints
-    checkpoint_manager_ = new CheckpointManager(transaction_manager_, log_manager_, buffer_pool_manager_);
+    checkpoint_manager_ =
+        new CheckpointManager(transaction_manager_, log_manager_, buffer_pool_manager_, disk_manager_);
   }
 
   ~BustubInstance() {
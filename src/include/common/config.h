@@ -27,6 +27,21 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/**
+ * True if buffer pools should save their hot pages when they go away and read them back in when they are created. Off
+ * by default, since a pool that starts warm is not the empty pool most callers expect.
+ */
+extern std::atomic<bool> enable_warm_restart;
+
+/** True if asynchronous disk I/O should go through io_uring where the kernel supports it, false for a thread pool. */
+extern std::atomic<bool> enable_io_uring;
+
+/** Buffer pool page cleaners check for excess dirty pages every PAGE_CLEANER_INTERVAL milliseconds. */
+extern std::chrono::milliseconds page_cleaner_interval;
+
+/** A fuzzy checkpoint waits CHECKPOINT_WRITE_INTERVAL milliseconds between the rounds in which it writes pages back. */
+extern std::chrono::milliseconds checkpoint_write_interval;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
@@ -34,12 +49,45 @@ static constexpr int HEADER_PAGE_ID = 0;                                      //
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr int LOG_INSERT_SLOTS = 64;  // log appends that can be copying into the log buffer at once
+static constexpr int LOG_RECOVERY_READ_SIZE = 1 << 20;  // bytes of the log read at a time by recovery
+static constexpr size_t LOG_SEGMENT_SIZE = 16 << 20;    // default size of a log segment file in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int LRUK_REPLACER_K = 2;                                     // lookback window for lru-k replacer
+static constexpr int BUFFER_RING_SIZE = 32;  // max frames recycled by one scan or bulk write access strategy
+static constexpr int PAGE_TABLE_SHARDS = 16;  // independently latched shards of a buffer pool page table
+static constexpr double PAGE_CLEANER_DIRTY_TARGET = 0.25;  // fraction of a buffer pool the page cleaner keeps dirty
+static constexpr int PAGE_CLEANER_BATCH_SIZE = 16;         // max pages the page cleaner writes per round
+static constexpr int CHECKPOINT_WRITE_BATCH_SIZE = 16;  // max pages a fuzzy checkpoint writes back per round
+static constexpr int PREFETCH_THREADS = 2;  // background threads reading prefetched pages, per buffer pool instance
+static constexpr bool FRAME_ARENA_TRY_HUGETLB = true;  // back large buffer pools with reserved huge pages if any
+static constexpr int FRAME_CHUNK_SIZE = 1024;  // frames whose bookkeeping is allocated together when a pool grows
+static constexpr int MAX_FRAME_CHUNKS = 4096;  // max frame chunks, i.e. max frames per pool / FRAME_CHUNK_SIZE
+static constexpr int EXTENT_SIZE = 64;  // contiguous page ids set aside at a time for the pages of one table or index
+static constexpr int WARM_RESTART_BATCH_SIZE = 64;  // hot pages sorted by page id and queued together on warm restart
+static constexpr int PREFETCH_BATCH_SIZE = 16;  // max prefetched pages whose reads are in flight together
+static constexpr int PREFETCH_WINDOW = 4;  // default number of pages a scan keeps prefetched ahead of it
+static constexpr int ASYNC_IO_QUEUE_DEPTH = 64;  // submission queue entries of an io_uring I/O engine
+static constexpr int ASYNC_IO_THREADS = 4;  // threads of the I/O engine used where io_uring is unavailable
+static constexpr int DIRECT_IO_ALIGNMENT = 4096;  // alignment of buffers, offsets and sizes for O_DIRECT I/O
 
 using frame_id_t = int32_t;    // frame id type
+/**
+ * Page ids are 32 bits, which with 4 KB pages addresses 8 TB per database file; the disk manager computes file offsets
+ * in 64 bits, so it is only the id that caps the file. Widening page_id_t to int64_t also widens every on-page format
+ * that stores one: the page header layout in page.h (which asserts the 4-byte width), the table page and B+ tree
+ * headers, the hash table directory and header pages, and RID, whose Get() packs the page id into the upper 32 bits of
+ * an int64_t and would have to become a 16-byte key. The buffer pool manifests store page ids too, so existing
+ * databases would need them rewritten or discarded.
+ */
 using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
-using lsn_t = int32_t;         // log sequence number type
+/**
+ * An LSN is the byte offset of a log record in the log, so it is 64 bits: at 32 bits a busy database would run out of
+ * LSNs after writing 2 GB of log. Every page that stores one gives it 8 bytes right after the page id, where
+ * Page::GetLSN finds it whatever kind of page it is.
+ */
+using lsn_t = int64_t;         // log sequence number type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
 
@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// latency_histogram.h
+//
+// Identification: src/include/common/latency_histogram.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * LatencyHistogram counts durations in power-of-two buckets: bucket i holds durations of [2^i, 2^(i+1)) nanoseconds,
+ * and bucket 0 also holds zero. Recording is one relaxed atomic increment, so it can stay on in production.
+ */
+class LatencyHistogram {
+ public:
+  /** Number of buckets; the last one also holds every longer duration (2^47 ns is about 39 hours). */
+  static constexpr size_t NUM_BUCKETS = 48;
+
+  /** A copy of the bucket counts, which can be added up across histograms. */
+  struct Snapshot {
+    std::array<uint64_t, NUM_BUCKETS> buckets_{};
+
+    /** @return the number of recorded durations */
+    uint64_t Count() const {
+      uint64_t count = 0;
+      for (auto bucket : buckets_) {
+        count += bucket;
+      }
+      return count;
+    }
+
+    /**
+     * @param quantile a fraction between 0 and 1
+     * @return the upper bound, in nanoseconds, of the bucket holding the given quantile; 0 if nothing was recorded
+     */
+    uint64_t Percentile(double quantile) const {
+      uint64_t count = Count();
+      if (count == 0) {
+        return 0;
+      }
+      auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantile * static_cast<double>(count) + 0.5));
+      uint64_t seen = 0;
+      for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+          return (uint64_t{2} << i) - 1;
+        }
+      }
+      return (uint64_t{2} << (NUM_BUCKETS - 1)) - 1;
+    }
+
+    Snapshot &operator+=(const Snapshot &other) {
+      for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        buckets_[i] += other.buckets_[i];
+      }
+      return *this;
+    }
+  };
+
+  /** Record a duration. */
+  void Record(std::chrono::nanoseconds duration) {
+    auto nanoseconds = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 1));
+    auto bucket = std::min<size_t>(63 - __builtin_clzll(nanoseconds), NUM_BUCKETS - 1);
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** @return the current bucket counts; concurrent recordings may or may not be included */
+  Snapshot GetSnapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+      snapshot.buckets_[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_{};
+};
+
+}  // namespace bustub
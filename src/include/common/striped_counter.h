@@ -0,0 +1,55 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// striped_counter.h
+//
+// Identification: src/include/common/striped_counter.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <thread>  // NOLINT
+
+namespace bustub {
+
+/**
+ * StripedCounter is a statistics counter for hot paths. Each thread adds to one of several cache-line sized stripes,
+ * so threads bumping the counter concurrently rarely touch the same cache line; reading it sums the stripes.
+ */
+class StripedCounter {
+ public:
+  /** Add to the counter. */
+  void Add(size_t value = 1) { stripes_[ThreadStripe()].value_.fetch_add(value, std::memory_order_relaxed); }
+
+  /** @return the sum of everything added so far; concurrent additions may or may not be included */
+  size_t Load() const {
+    size_t sum = 0;
+    for (const auto &stripe : stripes_) {
+      sum += stripe.value_.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+ private:
+  static constexpr size_t NUM_STRIPES = 16;
+
+  /** @return the stripe the calling thread adds to */
+  static size_t ThreadStripe() {
+    static thread_local const size_t stripe = std::hash<std::thread::id>()(std::this_thread::get_id()) % NUM_STRIPES;
+    return stripe;
+  }
+
+  struct alignas(64) Stripe {
+    std::atomic<size_t> value_{0};
+  };
+  std::array<Stripe, NUM_STRIPES> stripes_;
+};
+
+}  // namespace bustub
@@ -154,6 +154,7 @@ class Transaction {
         thread_id_(std::this_thread::get_id()),
         txn_id_(txn_id),
         prev_lsn_(INVALID_LSN),
+        begin_lsn_(INVALID_LSN),
         shared_lock_set_{new std::unordered_set<RID>},
         exclusive_lock_set_{new std::unordered_set<RID>} {
     // Initialize the sets that will be tracked.
@@ -246,6 +247,15 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return the LSN of the transaction's BEGIN record, INVALID_LSN if it was not logged */
+  inline lsn_t GetBeginLSN() { return begin_lsn_; }
+
+  /**
+   * Set the LSN of the transaction's BEGIN record.
+   * @param begin_lsn the LSN
+   */
+  inline void SetBeginLSN(lsn_t begin_lsn) { begin_lsn_ = begin_lsn; }
+
  private:
   /** The current transaction state. */
   TransactionState state_;
@@ -260,8 +270,10 @@ class Transaction {
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
   /** The undo set of indexes. */
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
-  /** The LSN of the last record written by the transaction. */
-  lsn_t prev_lsn_;
+  /** The LSN of the last record written by the transaction. Read by checkpoints while the transaction runs. */
+  std::atomic<lsn_t> prev_lsn_;
+  /** The LSN of the first record written by the transaction. Undo after a crash reads the log back to it. */
+  lsn_t begin_lsn_;
 
   /** Concurrent index: the pages that were latched during index operation. */
   std::shared_ptr<std::deque<Page *>> page_set_;
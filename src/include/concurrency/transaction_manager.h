@@ -13,9 +13,12 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>  // NOLINT
 #include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
@@ -77,6 +80,16 @@ class TransactionManager {
     return res;
   }
 
+  /**
+   * Take the active transaction table for a fuzzy checkpoint, without stopping anyone. A transaction leaves the table
+   * once its commit or abort record is in the log, so anything missing from it has finished as far as recovery is
+   * concerned. A last LSN may lag behind a record being appended concurrently, which is later than the checkpoint.
+   * @param[out] oldest_begin_lsn if not null, set to the LSN of the oldest BEGIN record in the table, INVALID_LSN if
+   * there is none: undo may read the log back to there
+   * @return every active transaction with the LSN of its last log record
+   */
+  std::vector<std::pair<txn_id_t, lsn_t>> GetActiveTransactionTable(lsn_t *oldest_begin_lsn = nullptr);
+
   /** Prevents all transactions from performing operations, used for checkpointing. */
   void BlockAllTransactions();
 
@@ -84,6 +97,14 @@ class TransactionManager {
   void ResumeTransactions();
 
  private:
+  /**
+   * Log the commit or abort of a transaction and take it out of the active transaction table.
+   * @param txn the transaction
+   * @param log_record_type COMMIT or ABORT
+   * @return the LSN of the record, INVALID_LSN if logging is off
+   */
+  lsn_t FinishTransaction(Transaction *txn, LogRecordType log_record_type);
+
   /**
    * Releases all the locks held by the given transaction.
    * @param txn the transaction whose locks should be released
@@ -103,10 +124,20 @@ class TransactionManager {
 
   std::atomic<txn_id_t> next_txn_id_{0};
   LockManager *lock_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
+  LogManager *log_manager_;
 
   /** The global transaction latch is used for checkpointing. */
   ReaderWriterLatch global_txn_latch_;
+
+  /** Transactions that have begun and not yet logged their commit or abort. */
+  std::unordered_map<txn_id_t, Transaction *> active_txns_;
+  /** Protects active_txns_. */
+  std::mutex active_txns_latch_;
+  /**
+   * Shared by transactions while they log their begin or end and join or leave active_txns_, exclusive while a
+   * checkpoint reads it.
+   */
+  std::shared_mutex finish_latch_;
 };
 
 }  // namespace bustub
@@ -12,32 +12,64 @@
 
 #pragma once
 
+#include <atomic>
+#include <thread>  // NOLINT
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "recovery/log_manager.h"
+#include "storage/disk/disk_manager.h"
 
 namespace bustub {
 
 /**
- * CheckpointManager creates consistent checkpoints by blocking all other transactions temporarily.
+ * CheckpointManager takes fuzzy checkpoints, ARIES style, without stopping transactions.
+ *
+ * A checkpoint logs a CHECKPOINT_BEGIN record, then takes the active transaction table and the dirty page table while
+ * transactions keep running, and logs them in a CHECKPOINT_END record. Once that record and the pages written back so
+ * far are durable the master record points recovery at it: redo starts at the smallest recLSN of the dirty page
+ * table, or at the begin record if that comes first, and undo starts from the active transaction table. The log
+ * segments below both that point and the BEGIN record of every active transaction are no longer needed, and the disk
+ * manager retires them. The pages that were dirty are then written back in the background, a few at a time, so that
+ * the next checkpoint's redo starts later and the one after it retires more of the log.
  */
 class CheckpointManager {
  public:
   CheckpointManager(TransactionManager *transaction_manager, LogManager *log_manager,
-                    BufferPoolManager *buffer_pool_manager)
+                    BufferPoolManager *buffer_pool_manager, DiskManager *disk_manager)
       : transaction_manager_(transaction_manager),
         log_manager_(log_manager),
-        buffer_pool_manager_(buffer_pool_manager) {}
+        buffer_pool_manager_(buffer_pool_manager),
+        disk_manager_(disk_manager) {}
 
-  ~CheckpointManager() = default;
+  /** Stops writing back pages for the last checkpoint. */
+  ~CheckpointManager();
 
+  /**
+   * Take a checkpoint. Returns once it is durable and recovery would start from it, leaving the pages that were dirty
+   * to be written back in the background. A checkpoint still writing back pages finishes first. With logging off there
+   * is no log to checkpoint, and the whole buffer pool is written back instead.
+   */
   void BeginCheckpoint();
+
+  /**
+   * Wait until the pages that were dirty at the last checkpoint have been written back, except those changed since by
+   * log records that are not yet durable.
+   */
   void EndCheckpoint();
 
  private:
-  TransactionManager *transaction_manager_ __attribute__((__unused__));
-  LogManager *log_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** Body of the writer thread: write back the pages dirty since before rec_lsn, a few at a time. */
+  void WritePages(lsn_t rec_lsn);
+
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  DiskManager *disk_manager_;
+  /** Writes back the pages of the last checkpoint. */
+  std::thread writer_;
+  /** Set when the writer should give up early. */
+  std::atomic<bool> stop_writer_{false};
 };
 
 }  // namespace bustub
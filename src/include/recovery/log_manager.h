@@ -15,7 +15,9 @@
 #include <algorithm>
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
+#include <limits>
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -23,52 +25,125 @@
 namespace bustub {
 
 /**
- * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
- * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ * LogManager maintains a separate thread that is awakened whenever the log buffer is full, whenever a timeout happens
+ * or whenever somebody waits for the log to become durable. When the thread is awakened, it writes the part of the log
+ * buffer that is complete into the disk log file.
+ *
+ * The log buffer is a ring of two LOG_BUFFER_SIZE buffers, addressed by position in the log: the lsn of a record is
+ * the byte offset at which it starts. Appends do not take a latch. A record reserves its bytes with a fetch-add on
+ * next_lsn_ and is copied in while other records are copied in elsewhere in the ring. To tell which records are still
+ * being copied, every append holds one of LOG_INSERT_SLOTS insert slots, which records a lower bound of its lsn; the
+ * log is complete up to the lowest bound of any held slot.
+ *
+ * Commits are made durable in groups: a committing transaction appends its record and waits until the persistent LSN
+ * reaches it. Every record appended while a write is in flight goes out with the next write, so all the transactions
+ * waiting at once share a single write of the log.
  */
 class LogManager {
  public:
+  /**
+   * Create a log manager that appends to the log of the disk manager. On a reopened database the log continues where
+   * it ends on disk, so that the LSN of every record stays its offset in the log.
+   * @param disk_manager the disk manager holding the log
+   */
   explicit LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN), disk_manager_(disk_manager) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+      : next_lsn_(static_cast<lsn_t>(disk_manager->GetLogSize())),
+        persistent_lsn_(static_cast<lsn_t>(disk_manager->GetLogSize()) - 1),
+        disk_manager_(disk_manager) {
+    log_buffer_ = new char[LOG_RING_SIZE];
+    for (auto &slot : insert_slots_) {
+      slot = SLOT_FREE;
+    }
   }
 
   ~LogManager() {
+    StopFlushThread();
     delete[] log_buffer_;
-    delete[] flush_buffer_;
     log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
   }
 
+  /** Start the flush thread and turn logging on. */
   void RunFlushThread();
+  /** Write out whatever is still buffered, stop and join the flush thread and turn logging off. */
   void StopFlushThread();
 
+  /**
+   * Append a log record to the log buffer, waiting for room if the buffer is full. Safe to call from any number of
+   * threads at once.
+   * @param log_record the record, whose lsn is set
+   * @return the lsn of the record, i.e. its offset in the log
+   */
   lsn_t AppendLogRecord(LogRecord *log_record);
 
+  /**
+   * Block until every log record up to and including lsn is durable. Without a flush thread, the caller writes the
+   * log itself.
+   * @param lsn lsn of a record that has been appended
+   */
+  void Flush(lsn_t lsn);
+
+  /** @return the lsn the next record will get, i.e. the size of the log */
   inline lsn_t GetNextLSN() { return next_lsn_; }
+  /** @return the last byte of the log that is durable; every record with an lsn up to it is durable */
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline char *GetLogBuffer() { return log_buffer_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** Size of the ring the log buffer is made of. */
+  static constexpr size_t LOG_RING_SIZE = 2 * LOG_BUFFER_SIZE;
+  /** Value of an insert slot that no append holds. */
+  static constexpr lsn_t SLOT_FREE = std::numeric_limits<lsn_t>::max();
+
+  /** Body of the flush thread. */
+  void FlushThread();
+
+  /**
+   * Write out the complete part of the log buffer that is not durable yet, through the asynchronous log writes of the
+   * disk manager and with latch_ released until they complete. Waits for a write that is already in flight first.
+   * Caller must hold latch_.
+   * @return false if there was nothing to write
+   */
+  bool FlushLocked(std::unique_lock<std::mutex> *latch);
+
+  /** @return the position up to which every reserved record has been copied into the log buffer */
+  lsn_t GetCompleteLSN();
 
-  /** The atomic counter which records the next log sequence number. */
+  /** Wake up the flush thread, unless it has already been asked to run. */
+  void RequestFlush();
+
+  /** Claim a free insert slot, setting it to a lower bound of the lsn the caller is about to reserve. */
+  std::atomic<lsn_t> &ClaimInsertSlot();
+
+  /** Copy bytes into the log buffer at a position in the log, wrapping around the end of the ring. */
+  void CopyIn(size_t pos, const void *data, size_t size);
+
+  /** The atomic counter which records the next log sequence number, i.e. the end of the reserved part of the log. */
   std::atomic<lsn_t> next_lsn_;
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
   char *log_buffer_;
-  char *flush_buffer_;
+  /** A lower bound of the lsn of the append holding each slot, or SLOT_FREE. */
+  std::atomic<lsn_t> insert_slots_[LOG_INSERT_SLOTS];
+
+  /** True while part of the log buffer is being written. */
+  bool flushing_ = false;
+  /** True if somebody is waiting for the log buffer to be written, because it is full or to commit. */
+  std::atomic<bool> flush_requested_ = false;
+  bool stop_flush_thread_ = false;
 
+  /** Serializes writes of the log buffer and waits for them; appends do not take it unless the buffer is full. */
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_ = nullptr;
 
+  /** Wakes up the flush thread. */
   std::condition_variable cv_;
+  /** Signalled whenever a write of the log completes. */
+  std::condition_variable flushed_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
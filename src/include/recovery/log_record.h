@@ -12,8 +12,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 #include "storage/table/tuple.h"
@@ -32,12 +35,16 @@ enum class LogRecordType {
   ABORT,
   /** Creating a new page in the table heap. */
   NEWPAGE,
+  /** Start of a fuzzy checkpoint. */
+  CHECKPOINT_BEGIN,
+  /** End of a fuzzy checkpoint, carrying the active transaction table and the dirty page table. */
+  CHECKPOINT_END,
 };
 
 /**
  * For every write operation on the table page, you should write ahead a corresponding log record.
  *
- * For EACH log record, HEADER is like (5 fields in common, 20 bytes in total).
+ * For EACH log record, HEADER is like (5 fields in common, 28 bytes in total; the LSNs take 8 bytes, the rest 4).
  *---------------------------------------------
  * | size | LSN | transID | prevLSN | LogType |
  *---------------------------------------------
@@ -54,9 +61,13 @@ enum class LogRecordType {
  * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size | new_tuple_data |
  *-----------------------------------------------------------------------------------
  * For new page type log record
- *--------------------------
- * | HEADER | prev_page_id |
- *--------------------------
+ *-------------------------------------
+ * | HEADER | prev_page_id | page_id |
+ *-------------------------------------
+ * For checkpoint end type log record, whose prevLSN is the LSN of the checkpoint's begin record
+ *--------------------------------------------------------------------------------------------
+ * | HEADER | txn_count | (txn_id, last_lsn) * txn_count | page_count | (page_id, rec_lsn) * page_count |
+ *--------------------------------------------------------------------------------------------
  */
 class LogRecord {
   friend class LogManager;
@@ -110,6 +121,32 @@ class LogRecord {
     size_ = HEADER_SIZE + sizeof(page_id_t) * 2;
   }
 
+  /**
+   * Constructor for the CHECKPOINT_END type. A dirty page table too large for one record keeps its entries with the
+   * smallest recLSNs, which is all that redo needs to know where to start.
+   * @param begin_lsn LSN of the checkpoint's CHECKPOINT_BEGIN record
+   * @param active_txns every transaction that was active, with the LSN of its last log record
+   * @param dirty_pages every page that was dirty, with its recLSN
+   */
+  LogRecord(lsn_t begin_lsn, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+            std::vector<std::pair<page_id_t, lsn_t>> dirty_pages)
+      : txn_id_(INVALID_TXN_ID),
+        prev_lsn_(begin_lsn),
+        log_record_type_(LogRecordType::CHECKPOINT_END),
+        active_txns_(std::move(active_txns)),
+        dirty_pages_(std::move(dirty_pages)) {
+    const size_t entry_size = sizeof(int32_t) + sizeof(lsn_t);
+    size_t fixed_size = HEADER_SIZE + 2 * sizeof(int32_t) + active_txns_.size() * entry_size;
+    assert(fixed_size <= static_cast<size_t>(LOG_BUFFER_SIZE));
+    size_t max_pages = (LOG_BUFFER_SIZE - fixed_size) / entry_size;
+    if (dirty_pages_.size() > max_pages) {
+      std::sort(dirty_pages_.begin(), dirty_pages_.end(),
+                [](const auto &a, const auto &b) { return a.second < b.second; });
+      dirty_pages_.resize(max_pages);
+    }
+    size_ = static_cast<int32_t>(fixed_size + dirty_pages_.size() * entry_size);
+  }
+
   ~LogRecord() = default;
 
   inline Tuple &GetDeleteTuple() { return delete_tuple_; }
@@ -128,6 +165,10 @@ class LogRecord {
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTransactions() { return active_txns_; }
+
+  inline std::vector<std::pair<page_id_t, lsn_t>> &GetDirtyPages() { return dirty_pages_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -176,7 +217,11 @@ class LogRecord {
   // case4: for new page operation
   page_id_t prev_page_id_{INVALID_PAGE_ID};
   page_id_t page_id_{INVALID_PAGE_ID};
-  static const int HEADER_SIZE = 20;
+
+  // case5: for checkpoint end, the active transaction table and the dirty page table
+  std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+  std::vector<std::pair<page_id_t, lsn_t>> dirty_pages_;
+  static const int HEADER_SIZE = 28;
 };  // namespace bustub
 
 }  // namespace bustub
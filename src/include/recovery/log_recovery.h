@@ -13,8 +13,14 @@
 #pragma once
 
 #include <algorithm>
-#include <mutex>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
@@ -24,12 +30,28 @@ namespace bustub {
 
 /**
  * Read log file from disk, redo and undo.
+ *
+ * Recovery starts from the checkpoint the master record points at, if any. Its active transaction table seeds the
+ * transactions to undo, and redo starts at the smallest recLSN of its dirty page table, or at its begin record if that
+ * comes first: every change logged before that point is on disk already. Redo reads the log from there once,
+ * LOG_RECOVERY_READ_SIZE bytes at a time, and hands every record that changes a page to the redo worker its page id
+ * hashes to. Every worker replays its records in lsn order, so the records of one page are replayed in the order they
+ * were logged while different pages are replayed in parallel. Undo is serial.
  */
 class LogRecovery {
  public:
-  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
-      : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), offset_(0) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+  /**
+   * @param disk_manager the disk manager holding the log
+   * @param buffer_pool_manager the buffer pool to recover pages in; it must have a frame for every redo worker
+   * @param num_redo_workers number of threads replaying the log during redo
+   */
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager,
+              size_t num_redo_workers = std::max(1U, std::thread::hardware_concurrency()))
+      : disk_manager_(disk_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        offset_(0),
+        num_redo_workers_(num_redo_workers) {
+    log_buffer_ = new char[LOG_RECOVERY_READ_SIZE];
   }
 
   ~LogRecovery() {
@@ -37,20 +59,63 @@ class LogRecovery {
     log_buffer_ = nullptr;
   }
 
+  /**
+   * Replay the log from the redo point of the last checkpoint on.
+   * @throws Exception if a record cannot be replayed, e.g. an insert whose slot is taken
+   */
   void Redo();
   void Undo();
   bool DeserializeLogRecord(const char *data, LogRecord *log_record);
 
+  /** @return number of bytes of log read by the last Redo */
+  int64_t GetRedoLogSize() const { return offset_ - redo_lsn_; }
+
+  /** @return LSN at which the last Redo started reading the log */
+  lsn_t GetRedoLSN() const { return redo_lsn_; }
+
  private:
-  DiskManager *disk_manager_ __attribute__((__unused__));
-  BufferPoolManager *buffer_pool_manager_ __attribute__((__unused__));
+  /** A record that a redo worker replays against one page. */
+  struct RedoTask {
+    page_id_t page_id_;
+    LogRecord log_record_;
+  };
+
+  /** The queue of a redo worker. Batches are handed over whole, one per read of the log. */
+  struct RedoPartition {
+    std::deque<std::vector<RedoTask>> batches_;
+    bool done_ = false;
+    /** The failure of the first record the worker could not replay, if any. */
+    std::exception_ptr error_;
+    std::mutex latch_;
+    std::condition_variable cv_;
+  };
+
+  /** Body of a redo worker: replay the batches of a partition until it is done. */
+  void RunRedoWorker(RedoPartition *partition);
+
+  /** Replay one record against one page, unless the page already reflects it. */
+  void RedoRecord(page_id_t page_id, LogRecord *log_record);
+
+  /** Undo one record of a transaction that did not finish. */
+  void UndoRecord(LogRecord *log_record);
+
+  /** Find the last checkpoint, seed active_txn_ from it and set redo_lsn_. */
+  void ReadCheckpoint();
+
+  DiskManager *disk_manager_;
+  BufferPoolManager *buffer_pool_manager_;
 
-  /** Maintain active transactions and its corresponding latest lsn. */
+  /**
+   * Maintain active transactions and its corresponding latest lsn. An lsn is the offset of its record in the log, so
+   * this is all undo needs to find the records it has to undo.
+   */
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  /** Mapping the log sequence number to log file offset for undos. */
-  std::unordered_map<lsn_t, int> lsn_mapping_;
 
-  int offset_ __attribute__((__unused__));
+  /** Offset in the log at which Redo started reading. */
+  lsn_t redo_lsn_ = 0;
+  /** Offset in the log up to which Redo has read. */
+  int64_t offset_;
+  size_t num_redo_workers_;
   char *log_buffer_;
 };
 
@@ -13,96 +13,230 @@
 #pragma once
 
 #include <atomic>
-#include <fstream>
+#include <functional>
 #include <future>  // NOLINT
 #include <mutex>   // NOLINT
-#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
 
 namespace bustub {
 
 /**
- * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
- * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ * DiskManager is where the pages and the log of a database live. It takes care of the allocation and deallocation of
+ * pages, and of reading and writing pages and log records. FileDiskManager keeps them in files; other implementations
+ * (an in-memory store, a wrapper that injects latency and errors) stand in for the files.
+ *
+ * Page and log I/O are up to the implementation. Everything else has a default that needs no storage of its own: the
+ * free page map is kept in memory, the asynchronous calls complete before they return, manifests are not kept and the
+ * master record is forgotten with the disk manager.
  */
 class DiskManager {
  public:
-  /**
-   * Creates a new disk manager that writes to the specified database file.
-   * @param db_file the file name of the database file to write to
-   */
-  explicit DiskManager(const std::string &db_file);
+  DiskManager() = default;
 
-  ~DiskManager() = default;
+  virtual ~DiskManager() = default;
 
   /**
-   * Shut down the disk manager and close all the file resources.
+   * Shut down the disk manager and release its resources.
    */
-  void ShutDown();
+  virtual void ShutDown() {}
 
   /**
-   * Write a page to the database file.
+   * Write a page.
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data) = 0;
 
   /**
-   * Read a page from the database file.
+   * Read a page. Pages that were never written read as zeroes.
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void ReadPage(page_id_t page_id, char *page_data) = 0;
+
+  /**
+   * Write a batch of pages, by default one WritePage at a time.
+   * @param pages the pages to write, as (page id, raw page data) pairs
+   */
+  virtual void WritePages(std::vector<std::pair<page_id_t, const char *>> pages);
+
+  /**
+   * Read a batch of pages, by default one ReadPage at a time.
+   * @param pages the pages to read, as (page id, output buffer) pairs
+   */
+  virtual void ReadPages(std::vector<std::pair<page_id_t, char *>> pages);
+
+  /**
+   * Write a page asynchronously.
+   * @param page_id id of the page
+   * @param page_data raw page data, which must stay valid and unchanged until the write completes
+   * @param callback called once the write has completed and is durable, possibly on an I/O thread
+   */
+  virtual void WritePageAsync(page_id_t page_id, const char *page_data, std::function<void()> callback);
+
+  /**
+   * Write a page asynchronously.
+   * @param page_id id of the page
+   * @param page_data raw page data, which must stay valid and unchanged until the write completes
+   * @return a future that becomes ready once the write has completed
+   */
+  std::future<void> WritePageAsync(page_id_t page_id, const char *page_data);
+
+  /**
+   * Read a page asynchronously.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer, which must stay valid until the read completes
+   * @param callback called once the read has completed, possibly on an I/O thread
+   */
+  virtual void ReadPageAsync(page_id_t page_id, char *page_data, std::function<void()> callback);
+
+  /**
+   * Read a page asynchronously.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer, which must stay valid until the read completes
+   * @return a future that becomes ready once the read has completed
+   */
+  std::future<void> ReadPageAsync(page_id_t page_id, char *page_data);
+
+  /**
+   * Make every page written so far durable.
+   */
+  virtual void Sync() {}
+
+  /**
+   * Allocate a page, reusing the lowest freed page id before growing the database.
+   * @param instance_index index of the buffer pool instance asking for the page
+   * @param num_instances number of buffer pool instances sharing this disk manager
+   * @return an unallocated page id that mods back to instance_index
+   */
+  virtual page_id_t AllocatePage(uint32_t instance_index = 0, uint32_t num_instances = 1);
+
+  /**
+   * Allocate a page from an extent: EXTENT_SIZE contiguous page ids, aligned to EXTENT_SIZE, that are set aside for
+   * one table or index so that its pages end up next to each other on disk. AllocatePage never hands out ids of an
+   * extent that is set aside. Once the caller's extent is full, the lowest extent without any allocated page is set
+   * aside in its place. Extents are set aside in memory only: an extent stays set aside until it is full or the
+   * database is reopened.
+   * @param[in,out] extent first page id of the caller's extent, INVALID_PAGE_ID before its first page
+   * @return an unallocated page id in the caller's extent
+   */
+  virtual page_id_t AllocatePageInExtent(page_id_t *extent);
+
+  /**
+   * Return a page to the free page map so that a later AllocatePage can hand it out again.
+   * @param page_id id of the page to deallocate
+   */
+  virtual void DeallocatePage(page_id_t page_id);
+
+  /** @return true iff the page is currently allocated */
+  virtual bool IsAllocated(page_id_t page_id);
 
   /**
-   * Flush the entire log buffer into disk.
+   * Give back the space of the free pages at the end of the database.
+   * @return the number of pages the database shrank by
+   */
+  virtual size_t Compact() { return 0; }
+
+  /**
+   * Append to the log, and wait until it is durable.
    * @param log_data raw log data
    * @param size size of log entry
    */
-  void WriteLog(char *log_data, int size);
+  virtual void WriteLog(char *log_data, int size) = 0;
 
   /**
-   * Read a log entry from the log file.
+   * Read a log entry from the log. Whatever lies past the end of the log reads as zeroes.
    * @param[out] log_data output buffer
    * @param size size of the log entry
-   * @param offset offset of the log entry in the file
-   * @return true if the read was successful, false otherwise
+   * @param offset offset of the log entry in the log, i.e. its LSN
+   * @return true if the read was successful, false past the end of the log or below where it was truncated
    */
-  bool ReadLog(char *log_data, int size, int offset);
+  virtual bool ReadLog(char *log_data, int size, int64_t offset) = 0;
 
-  /** @return the number of disk flushes */
-  int GetNumFlushes() const;
+  /**
+   * Append to the log asynchronously. The log data is placed when this is called, so appends land in the order they
+   * were made, whichever completes first.
+   * @param log_data raw log data, which must stay valid and unchanged until the write completes
+   * @param size size of the log data
+   * @param callback called once the write has completed and is durable, possibly on an I/O thread
+   */
+  virtual void WriteLogAsync(const char *log_data, int size, std::function<void()> callback) = 0;
 
-  /** @return true iff the in-memory content has not been flushed yet */
-  bool GetFlushState() const;
+  /**
+   * Drop the log below lsn, a whole segment at a time. The segment lsn is in always stays.
+   * @param lsn the first LSN that must stay readable
+   * @return the number of segments dropped
+   */
+  virtual size_t TruncateLog(lsn_t lsn) = 0;
 
-  /** @return the number of disk writes */
-  int GetNumWrites() const;
+  /** @return the size of the log, i.e. the LSN the next append lands at; a reopened log continues at its end */
+  virtual size_t GetLogSize() = 0;
 
   /**
-   * Sets the future which is used to check for non-blocking flushes.
-   * @param f the non-blocking flush check
+   * Replace the hot page manifest of a buffer pool instance: the pages the instance should read back in when it is
+   * next created on this database, most important first.
+   * @param instance_index index of the buffer pool instance
+   * @param page_ids the pages to list
    */
-  inline void SetFlushLogFuture(std::future<void> *f) { flush_log_f_ = f; }
+  virtual void WriteManifest(uint32_t instance_index, const std::vector<page_id_t> &page_ids) {}
+
+  /**
+   * Read the hot page manifest of a buffer pool instance.
+   * @param instance_index index of the buffer pool instance
+   * @return the pages it lists, empty if there is no valid manifest
+   */
+  virtual std::vector<page_id_t> ReadManifest(uint32_t instance_index) { return {}; }
+
+  /**
+   * Durably replace the master record, which tells recovery where the last complete checkpoint is in the log.
+   * @param lsn LSN of the CHECKPOINT_END record of the checkpoint
+   */
+  virtual void WriteMasterRecord(lsn_t lsn) { master_lsn_ = lsn; }
+
+  /** @return the LSN last written with WriteMasterRecord, INVALID_LSN if there is no valid master record */
+  virtual lsn_t ReadMasterRecord() { return master_lsn_; }
+
+  /** @return the number of log flushes */
+  int GetNumFlushes() const { return num_flushes_; }
+
+  /** @return the number of page writes */
+  int GetNumWrites() const { return num_writes_; }
+
+  /** @return the number of calls the page writes took, fewer than GetNumWrites when batches coalesce */
+  int GetNumWriteCalls() const { return num_write_calls_; }
+
+ protected:
+  /**
+   * Called whenever a bit of the free page map changes, with fsm_latch_ held, so that an implementation can write
+   * the map page holding it through to storage.
+   * @param map_page index of the PAGE_SIZE bytes of allocation_map_ that changed
+   */
+  virtual void OnFreePageMapChange(size_t map_page) {}
+
+  std::atomic<int> num_flushes_{0};
+  std::atomic<int> num_writes_{0};
+  std::atomic<int> num_write_calls_{0};
 
-  /** Checks if the non-blocking flush future was set. */
-  inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
+  /** The free page map: one bit per page, set while the page is allocated, always a whole number of pages long. */
+  std::vector<uint8_t> allocation_map_;
+  /** Protects the free page map, the allocation hints and the extents set aside. */
+  std::mutex fsm_latch_;
 
  private:
-  int GetFileSize(const std::string &file_name);
-  // stream to write log file
-  std::fstream log_io_;
-  std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
-  std::string file_name_;
-  int num_flushes_;
-  int num_writes_;
-  bool flush_log_;
-  std::future<void> *flush_log_f_;
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  bool IsAllocatedLocked(page_id_t page_id) const;
+  bool IsReservedLocked(page_id_t page_id) const;
+  void SetAllocatedLocked(page_id_t page_id, bool allocated);
+
+  // per instance index: no page below this id that mods back to the index is free
+  std::vector<page_id_t> allocation_hints_;
+  // first page ids of the extents set aside by AllocatePageInExtent
+  std::unordered_set<page_id_t> reserved_extents_;
+  // the master record, when the implementation keeps none of its own
+  std::atomic<lsn_t> master_lsn_{INVALID_LSN};
 };
 
 }  // namespace bustub
@@ -0,0 +1,150 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// fault_injecting_disk_manager.h
+//
+// Identification: src/include/storage/disk/fault_injecting_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * The shape of an injected latency.
+ * NONE adds no delay.
+ * FIXED always waits min_.
+ * UNIFORM waits anywhere between min_ and max_.
+ * PARETO waits min_ most of the time and, now and then, far longer: a Pareto distribution with scale min_ and tail
+ * index shape_, capped at max_. The smaller the shape, the heavier the tail.
+ */
+enum class LatencyDistribution { NONE, FIXED, UNIFORM, PARETO };
+
+/**
+ * A latency distribution to inject.
+ */
+struct InjectedLatency {
+  LatencyDistribution distribution_ = LatencyDistribution::NONE;
+  std::chrono::microseconds min_{0};
+  std::chrono::microseconds max_{0};
+  double shape_ = 1.5;
+
+  /**
+   * Draw a latency.
+   * @param rng the random number generator to draw from
+   * @return the latency
+   */
+  std::chrono::microseconds Sample(std::mt19937_64 *rng) const;
+};
+
+/**
+ * What a FaultInjectingDiskManager injects. Errors are injected into page I/O only: a failed write never reaches the
+ * disk and a failed read leaves its buffer untouched, the way FileDiskManager itself drops I/O that fails.
+ */
+struct InjectedFaults {
+  InjectedLatency read_latency_;
+  InjectedLatency write_latency_;
+  /** Probability that a page read fails. */
+  double read_error_rate_ = 0;
+  /** Probability that a page write fails. */
+  double write_error_rate_ = 0;
+  /** Seed of the random number generator, so that a run can be repeated. */
+  uint64_t seed_ = 0;
+};
+
+/**
+ * FaultInjectingDiskManager wraps another disk manager, delaying its reads and writes by latencies drawn from
+ * configurable distributions and failing some of them. It lets benchmarks study slow or unreliable storage without the
+ * hardware. Reads and writes are delayed on the calling thread, so its asynchronous calls complete before returning.
+ */
+class FaultInjectingDiskManager : public DiskManager {
+ public:
+  /**
+   * Wrap a disk manager.
+   * @param disk_manager the disk manager doing the actual I/O, which must outlive the wrapper
+   * @param faults what to inject
+   */
+  FaultInjectingDiskManager(DiskManager *disk_manager, InjectedFaults faults);
+
+  void ShutDown() override { disk_manager_->ShutDown(); }
+
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** A batch is one request: it is delayed once, and fails or succeeds as a whole. */
+  void WritePages(std::vector<std::pair<page_id_t, const char *>> pages) override;
+
+  /** A batch is one request: it is delayed once, and fails or succeeds as a whole. */
+  void ReadPages(std::vector<std::pair<page_id_t, char *>> pages) override;
+
+  void Sync() override { disk_manager_->Sync(); }
+
+  page_id_t AllocatePage(uint32_t instance_index = 0, uint32_t num_instances = 1) override {
+    return disk_manager_->AllocatePage(instance_index, num_instances);
+  }
+
+  page_id_t AllocatePageInExtent(page_id_t *extent) override { return disk_manager_->AllocatePageInExtent(extent); }
+
+  void DeallocatePage(page_id_t page_id) override { disk_manager_->DeallocatePage(page_id); }
+
+  bool IsAllocated(page_id_t page_id) override { return disk_manager_->IsAllocated(page_id); }
+
+  size_t Compact() override { return disk_manager_->Compact(); }
+
+  /** Log writes are delayed like page writes, but never fail. */
+  void WriteLog(char *log_data, int size) override;
+
+  bool ReadLog(char *log_data, int size, int64_t offset) override;
+
+  void WriteLogAsync(const char *log_data, int size, std::function<void()> callback) override;
+
+  void WriteManifest(uint32_t instance_index, const std::vector<page_id_t> &page_ids) override {
+    disk_manager_->WriteManifest(instance_index, page_ids);
+  }
+
+  std::vector<page_id_t> ReadManifest(uint32_t instance_index) override {
+    return disk_manager_->ReadManifest(instance_index);
+  }
+
+  void WriteMasterRecord(lsn_t lsn) override { disk_manager_->WriteMasterRecord(lsn); }
+
+  lsn_t ReadMasterRecord() override { return disk_manager_->ReadMasterRecord(); }
+
+  size_t TruncateLog(lsn_t lsn) override { return disk_manager_->TruncateLog(lsn); }
+
+  size_t GetLogSize() override { return disk_manager_->GetLogSize(); }
+
+  /** @return the number of page reads and writes that were made to fail */
+  uint64_t GetNumInjectedErrors() const { return num_injected_errors_; }
+
+ private:
+  /**
+   * Wait for an injected latency, then decide whether the request fails.
+   * @return true iff the request is to fail
+   */
+  bool Inject(const InjectedLatency &latency, double error_rate);
+
+  DiskManager *disk_manager_;
+  const InjectedFaults faults_;
+  std::mt19937_64 rng_;
+  /** Protects rng_. */
+  std::mutex rng_latch_;
+  std::atomic<uint64_t> num_injected_errors_{0};
+};
+
+}  // namespace bustub
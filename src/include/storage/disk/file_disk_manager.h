@@ -0,0 +1,249 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// file_disk_manager.h
+//
+// Identification: src/include/storage/disk/file_disk_manager.h
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <fstream>
+#include <functional>
+#include <future>  // NOLINT
+#include <memory>
+#include <mutex>   // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rwlatch.h"
+#include "storage/disk/disk_manager.h"
+#include "storage/disk/io_engine.h"
+
+namespace bustub {
+
+/**
+ * How a DiskManager reads and writes pages of the database file.
+ * FSTREAM goes through one std::fstream under a latch and flushes the stream after every write.
+ * PREAD uses positional pread/pwrite on a file descriptor, so reads and writes of different pages run in parallel;
+ * writes only reach the page cache until Sync is called.
+ * DIRECT is PREAD on a descriptor opened with O_DIRECT, so that pages cached by the buffer pool are not cached by the
+ * kernel as well. Buffers that are not DIRECT_IO_ALIGNMENT aligned go through an aligned bounce buffer. Where the
+ * filesystem rejects O_DIRECT (tmpfs, for one) it quietly behaves like PREAD.
+ */
+enum class DiskIOBackend { FSTREAM, PREAD, DIRECT };
+
+/**
+ * Where the pages and the log of a database live. By default every page is in the one database file.
+ *
+ * With segment_pages_ set, the pages are split into segments of that many pages: page p lives in segment
+ * p / segment_pages_, at page p % segment_pages_ of the segment's file. Segment 0 is the database file itself, segment
+ * i > 0 the file "<database file name>.<i>", placed in directories_[(i - 1) % directories_.size()] or, without
+ * directories, next to the database file. Every segment has a file descriptor of its own, so segments striped across
+ * directories on different volumes spread the I/O across their devices. Small segments stripe finely; segments of
+ * 1 GB keep each file a manageable unit for backups.
+ *
+ * A segmented database needs a file descriptor backend: FSTREAM is replaced by PREAD.
+ *
+ * The log is always split into segments of log_segment_size_ bytes, next to the database file. A segment is named
+ * after the LSN of its first byte, "<database file stem>.log.<LSN in 16 hex digits>", so the segment holding an LSN is
+ * found by arithmetic alone. Segments that recovery no longer needs are retired by TruncateLog: moved to
+ * log_archive_directory_ if there is one, deleted otherwise.
+ */
+struct StorageLayout {
+  /** Pages per segment; 0 keeps every page in the database file. */
+  size_t segment_pages_ = 0;
+  /** Directories the segments after the first are striped across, round robin. */
+  std::vector<std::string> directories_;
+  /** Bytes per log segment. */
+  size_t log_segment_size_ = LOG_SEGMENT_SIZE;
+  /** Directory retired log segments are moved to, created if need be; empty to delete them. */
+  std::string log_archive_directory_;
+};
+
+/**
+ * FileDiskManager keeps a database in files: the pages in the database file (or its segments), the log in log
+ * segments, and the free page map, the manifests and the master record in side files next to the database file.
+ */
+class FileDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a new disk manager that writes to the specified database file.
+   * @param db_file the file name of the database file to write to
+   * @param backend how pages are read and written
+   * @param layout how pages are spread over files; a database must always be opened with the same layout
+   */
+  explicit FileDiskManager(const std::string &db_file, DiskIOBackend backend = DiskIOBackend::PREAD,
+                           StorageLayout layout = {});
+
+  ~FileDiskManager() override;
+
+  /**
+   * Shut down the disk manager and close all the file resources.
+   */
+  void ShutDown() override;
+
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /**
+   * Write a batch of pages. The batch is sorted by page id, and every run of consecutive pages is written with one
+   * pwritev.
+   * @param pages the pages to write, as (page id, raw page data) pairs
+   */
+  void WritePages(std::vector<std::pair<page_id_t, const char *>> pages) override;
+
+  /**
+   * Read a batch of pages. The batch is sorted by page id, and every run of consecutive pages is read with one preadv.
+   * Whatever lies past the end of the file reads as zeroes.
+   * @param pages the pages to read, as (page id, output buffer) pairs
+   */
+  void ReadPages(std::vector<std::pair<page_id_t, char *>> pages) override;
+
+  using DiskManager::ReadPageAsync;
+  using DiskManager::WritePageAsync;
+
+  /** The write goes through the I/O engine; the FSTREAM backend writes synchronously. */
+  void WritePageAsync(page_id_t page_id, const char *page_data, std::function<void()> callback) override;
+
+  /** The read goes through the I/O engine; the FSTREAM backend reads synchronously. */
+  void ReadPageAsync(page_id_t page_id, char *page_data, std::function<void()> callback) override;
+
+  void Sync() override;
+
+  /**
+   * Truncate the free pages at the end of the database file.
+   * @return the number of pages the file shrank by
+   */
+  size_t Compact() override;
+
+  /**
+   * Call Compact in a background thread every interval until the disk manager is shut down.
+   * @param interval time between two compactions
+   */
+  void StartCompaction(std::chrono::milliseconds interval);
+
+  void WriteLog(char *log_data, int size) override;
+
+  /** A log entry is read from as many segments as it spans; a segment that has been retired cannot be read. */
+  bool ReadLog(char *log_data, int size, int64_t offset) override;
+
+  void WriteLogAsync(const char *log_data, int size, std::function<void()> callback) override;
+
+  /**
+   * Retire every log segment that lies wholly below lsn: move it to the log archive directory, or delete it without
+   * one. The segment lsn is in always stays.
+   * @param lsn the first LSN that must stay readable
+   * @return the number of segments retired
+   */
+  size_t TruncateLog(lsn_t lsn) override;
+
+  size_t GetLogSize() override { return log_size_; }
+
+  /** @return the name of the log segment file that holds lsn, whether or not it exists */
+  std::string GetLogSegmentName(lsn_t lsn) const;
+
+  /** @return the I/O engine behind the asynchronous calls, nullptr for the FSTREAM backend */
+  IOEngine *GetIOEngine();
+
+  /** @return true iff pages are read and written with O_DIRECT */
+  bool IsDirectIO() const { return direct_io_; }
+
+  /** The manifest is a side file next to the database file. */
+  void WriteManifest(uint32_t instance_index, const std::vector<page_id_t> &page_ids) override;
+
+  std::vector<page_id_t> ReadManifest(uint32_t instance_index) override;
+
+  /** The master record is a side file next to the database file. */
+  void WriteMasterRecord(lsn_t lsn) override;
+
+  lsn_t ReadMasterRecord() override;
+
+  /** @return true iff the in-memory content has not been flushed yet */
+  bool GetFlushState() const;
+
+  /**
+   * Sets the future which is used to check for non-blocking flushes.
+   * @param f the non-blocking flush check
+   */
+  inline void SetFlushLogFuture(std::future<void> *f) { flush_log_f_ = f; }
+
+  /** Checks if the non-blocking flush future was set. */
+  inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
+
+ protected:
+  /** The free page map is written through, a map page at a time, on every change. */
+  void OnFreePageMapChange(size_t map_page) override;
+
+ private:
+  int64_t GetFileSize(const std::string &file_name);
+  void GrowFileSize(size_t size);
+  ssize_t ReadDbPage(char *page_data, page_id_t page_id);
+  bool WriteDbPage(const char *page_data, page_id_t page_id);
+  void DisableDirectIO();
+  int Locate(page_id_t page_id, size_t *offset);
+  std::string GetSegmentName(size_t segment) const;
+  int OpenSegment(size_t segment);
+  int OpenLogSegment(size_t offset, size_t *segment_offset, bool create = true);
+  void OpenLog(bool fresh);
+  bool TruncatePages(size_t num_pages);
+  void TransferPages(bool is_write, std::vector<std::pair<page_id_t, char *>> *pages);
+  std::string GetManifestName(uint32_t instance_index) const;
+  std::string GetMasterRecordName() const;
+  void OpenFreePageMap(bool fresh);
+  void StopCompaction();
+  // size of the log; appends are placed at offsets handed out from it
+  std::atomic<size_t> log_size_{0};
+  // descriptors of the log segments opened so far, by segment number
+  std::unordered_map<size_t, int> log_segment_fds_;
+  // number of the oldest segment that has not been retired
+  size_t log_first_segment_ = 0;
+  // protects log_segment_fds_ and log_first_segment_
+  std::mutex log_latch_;
+  // stream to write db file
+  std::fstream db_io_;
+  // file descriptor of the db file, used instead of db_io_ by the PREAD backend
+  int db_fd_ = -1;
+  const StorageLayout layout_;
+  const DiskIOBackend backend_;
+  // with segments: the descriptor of each segment, db_fd_ first; segments are opened on first use, in order
+  std::vector<int> segment_fds_;
+  // protects segment_fds_
+  ReaderWriterLatch segment_latch_;
+  // whether db_fd_ is open with O_DIRECT; cleared for good by the first I/O the filesystem rejects because of it
+  std::atomic<bool> direct_io_{false};
+  // size of the db file (with segments, the size the pages would take in one file), kept in memory so that reads need
+  // not stat the file
+  std::atomic<size_t> db_file_size_{0};
+  std::string file_name_;
+  // db file name without its extension, prefix of the manifest file names
+  std::string file_stem_;
+  bool flush_log_;
+  std::future<void> *flush_log_f_;
+  // With multiple buffer pool instances, need to protect file access
+  std::mutex db_io_latch_;
+  // stream to the free page map: one bit per page, set while the page is allocated, kept PAGE_SIZE bytes at a time
+  std::fstream fsm_io_;
+  std::string fsm_name_;
+  // fsm_latch_ also protects compaction_stop_, and is taken before db_io_latch_
+  std::thread compaction_thread_;
+  std::condition_variable compaction_cv_;
+  bool compaction_stop_ = false;
+  // engine of the asynchronous calls, started by the first of them; declared last so that it drains first
+  std::once_flag io_engine_once_;
+  std::unique_ptr<IOEngine> io_engine_;
+};
+
+}  // namespace bustub
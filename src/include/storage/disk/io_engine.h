@@ -0,0 +1,169 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// io_engine.h
+//
+// Identification: src/include/storage/disk/io_engine.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+struct io_uring_params;
+
+namespace bustub {
+
+/**
+ * A positional read or write of a file descriptor, handed to an IOEngine.
+ */
+struct IORequest {
+  bool is_write_;
+  int fd_;
+  char *data_;
+  size_t size_;
+  size_t offset_;
+  /** Called on an engine thread with the number of bytes transferred, or -errno on failure. */
+  std::function<void(ssize_t)> callback_;
+};
+
+/**
+ * IOEngine runs positional reads and writes asynchronously and reports their completion through callbacks.
+ */
+class IOEngine {
+ public:
+  IOEngine() = default;
+  virtual ~IOEngine() = default;
+
+  /**
+   * Queue a request. It may complete, and run its callback, before Submit returns.
+   * @param request the request
+   */
+  virtual void Submit(IORequest request) = 0;
+
+  /** @return the number of system calls the engine has made to submit requests, for observing batching */
+  virtual uint64_t GetNumSubmitCalls() const = 0;
+
+  /**
+   * Create an engine: io_uring if enable_io_uring is set and the kernel supports it, a thread pool otherwise.
+   * @return the engine
+   */
+  static std::unique_ptr<IOEngine> Create();
+};
+
+/**
+ * ThreadPoolIOEngine emulates asynchronous I/O with a fixed pool of threads doing blocking pread/pwrite.
+ */
+class ThreadPoolIOEngine : public IOEngine {
+ public:
+  /**
+   * Start the engine.
+   * @param num_threads number of I/O threads
+   */
+  explicit ThreadPoolIOEngine(size_t num_threads);
+
+  /**
+   * Stop the engine once every submitted request has completed.
+   */
+  ~ThreadPoolIOEngine() override;
+
+  void Submit(IORequest request) override;
+
+  uint64_t GetNumSubmitCalls() const override { return num_submit_calls_; }
+
+ private:
+  void Run();
+
+  std::vector<std::thread> threads_;
+  std::deque<IORequest> queue_;
+  bool stop_ = false;
+  std::atomic<uint64_t> num_submit_calls_ = 0;
+  /** Protects queue_ and stop_. */
+  std::mutex latch_;
+  std::condition_variable cv_;
+};
+
+/**
+ * IoUringIOEngine submits requests to an io_uring, using the raw system calls so that no library is needed.
+ *
+ * Submit only queues a request and wakes the ring thread through an eventfd that the ring itself polls. The ring
+ * thread moves everything queued since it last woke into the submission queue and hands it to the kernel with one
+ * io_uring_enter, which also waits for the next completion, so submissions from many threads are batched.
+ */
+class IoUringIOEngine : public IOEngine {
+ public:
+  /**
+   * Set up a ring and start its thread.
+   * @param queue_depth number of submission queue entries
+   * @return the engine, or nullptr if the kernel does not support io_uring or refuses to set up a ring
+   */
+  static std::unique_ptr<IoUringIOEngine> Create(unsigned queue_depth);
+
+  /**
+   * Stop the engine once every submitted request has completed, and tear down the ring.
+   */
+  ~IoUringIOEngine() override;
+
+  void Submit(IORequest request) override;
+
+  uint64_t GetNumSubmitCalls() const override { return num_submit_calls_; }
+
+ private:
+  /** A request owned by the ring while it is in flight. */
+  struct InFlight;
+
+  IoUringIOEngine() = default;
+
+  /** Map the rings of ring_fd_. @return false on failure */
+  bool MapRings(const io_uring_params &params);
+
+  void Run();
+
+  /** Append an SQE to the submission queue. Only called by the ring thread. */
+  void PushSqe(uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t offset, uint64_t user_data,
+               uint32_t poll_events = 0);
+
+  int ring_fd_ = -1;
+  int event_fd_ = -1;
+  void *sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  void *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned cq_entries_ = 0;
+  unsigned *sq_head_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_mask_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned *cq_mask_ = nullptr;
+  void *cqes_ = nullptr;
+  /** SQEs filled in since the last io_uring_enter. */
+  unsigned to_submit_ = 0;
+
+  std::thread thread_;
+  std::deque<IORequest> queue_;
+  bool stop_ = false;
+  std::atomic<uint64_t> num_submit_calls_ = 0;
+  /** Protects queue_ and stop_. */
+  std::mutex latch_;
+};
+
+}  // namespace bustub
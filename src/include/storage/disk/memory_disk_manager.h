@@ -0,0 +1,58 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// memory_disk_manager.h
+//
+// Identification: src/include/storage/disk/memory_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * MemoryDiskManager keeps pages and log in memory. Benchmarks of the buffer pool or the indexes that run on it measure
+ * neither filesystem overhead nor the host's disk, and its contents go away with it.
+ */
+class MemoryDiskManager : public DiskManager {
+ public:
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /** Pages that were never written read as zeroes. */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  void WriteLog(char *log_data, int size) override;
+
+  bool ReadLog(char *log_data, int size, int64_t offset) override;
+
+  void WriteLogAsync(const char *log_data, int size, std::function<void()> callback) override;
+
+  /** Drops the log below the segment lsn is in, as if every segment were LOG_SEGMENT_SIZE bytes. */
+  size_t TruncateLog(lsn_t lsn) override;
+
+  size_t GetLogSize() override;
+
+ private:
+  using PageData = std::array<char, PAGE_SIZE>;
+
+  /** Pages indexed by page id; null where a page was never written. */
+  std::vector<std::unique_ptr<PageData>> pages_;
+  /** The log from log_begin_ on. */
+  std::vector<char> log_;
+  size_t log_begin_ = 0;
+  /** Protects pages_ and log_. */
+  std::mutex latch_;
+};
+
+}  // namespace bustub
@@ -10,6 +10,7 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <fstream>
 #include <queue>
 #include <string>
 #include <vector>
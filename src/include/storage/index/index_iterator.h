@@ -13,17 +13,39 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/chain_prefetcher.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+/**
+ * IndexIterator walks the leaf level of a B+ tree along the sibling chain. It keeps the leaf it is positioned on
+ * pinned, and keeps the buffer pool's prefetch window of leaves ahead of it prefetched.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
  public:
-  // you may define your own constructor based on your member variables
+  /** Create an iterator that is at the end. */
   IndexIterator();
+
+  /**
+   * Create an iterator positioned on an entry of a leaf page.
+   * @param buffer_pool_manager the buffer pool holding the tree
+   * @param leaf_page_id the leaf to start from, or INVALID_PAGE_ID for an iterator that is at the end
+   * @param index the entry of the leaf to start from; if it is past the last entry the iterator moves on to the next
+   * non-empty leaf
+   */
+  IndexIterator(BufferPoolManager *buffer_pool_manager, page_id_t leaf_page_id, int index);
+
+  IndexIterator(const IndexIterator &other) = delete;
+  IndexIterator &operator=(const IndexIterator &other) = delete;
+  IndexIterator(IndexIterator &&other) noexcept;
+
   ~IndexIterator();
 
   bool IsEnd();
@@ -32,12 +54,27 @@ class IndexIterator {
 
   IndexIterator &operator++();
 
-  bool operator==(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator==(const IndexIterator &itr) const { return leaf_ == itr.leaf_ && index_ == itr.index_; }
 
-  bool operator!=(const IndexIterator &itr) const { throw std::runtime_error("unimplemented"); }
+  bool operator!=(const IndexIterator &itr) const { return !(*this == itr); }
 
  private:
-  // add your own private member variables here
+  /** Move to the next leaf while the current one has no entry at index_. */
+  void SkipExhaustedLeaves();
+
+  /** Move onto the given leaf page, releasing the current one and topping up the prefetch window. */
+  void MoveTo(page_id_t page_id);
+
+  /** @return the leaf after a leaf page */
+  static page_id_t NextLeafPageId(Page *page);
+
+  BufferPoolManager *buffer_pool_manager_ = nullptr;
+  /** The pinned leaf the iterator is on, nullptr at the end. */
+  LeafPage *leaf_ = nullptr;
+  /** Position within leaf_, 0 at the end. */
+  int index_ = 0;
+  /** Keeps the leaves ahead of the iterator prefetched. */
+  ChainPrefetcher prefetcher_{nullptr, AccessHint::SEQUENTIAL_SCAN, &IndexIterator::NextLeafPageId};
 };
 
 }  // namespace bustub
@@ -26,10 +26,10 @@ namespace bustub {
  *
  * Header Page for linear probing hash table.
  *
- * Header format (size in byte, 16 bytes in total):
- * -------------------------------------------------------------
- * | LSN (4) | Size (4) | PageId(4) | NextBlockIndex(4)
- * -------------------------------------------------------------
+ * Header format (size in byte, 32 bytes in total):
+ * ------------------------------------------------------------------------------------------
+ * | PageId(4) | LSN (8) | Padding (4) | Size (8) | NextBlockIndex(8) | BlockPageIds(4 each)
+ * ------------------------------------------------------------------------------------------
  */
 class HashTableHeaderPage {
  public:
@@ -90,9 +90,10 @@ class HashTableHeaderPage {
   size_t NumBlocks();
 
  private:
-  __attribute__((unused)) lsn_t lsn_;
-  __attribute__((unused)) size_t size_;
   __attribute__((unused)) page_id_t page_id_;
+  // Packed, so that the LSN is where Page::GetLSN reads it.
+  __attribute__((packed, unused)) lsn_t lsn_;
+  __attribute__((unused)) size_t size_;
   __attribute__((unused)) size_t next_ind_;
   __attribute__((unused)) page_id_t block_page_ids_[0];
 };
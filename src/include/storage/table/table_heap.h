@@ -95,12 +95,18 @@ class TableHeap {
    * @param rid rid of the tuple to read
    * @param tuple output variable for the tuple
    * @param txn transaction performing the read
+   * @param hint how the read accesses the table, SEQUENTIAL_SCAN for reads made while scanning
    * @return true if the read was successful (i.e. the tuple exists)
    */
-  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn);
+  bool GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, AccessHint hint = AccessHint::NORMAL);
 
-  /** @return the begin iterator of this table */
-  TableIterator Begin(Transaction *txn);
+  /**
+   * @param txn the transaction performing the scan
+   * @param hint how the scan accesses the table; full scans should pass SEQUENTIAL_SCAN so that they do not flush the
+   * buffer pool
+   * @return the begin iterator of this table
+   */
+  TableIterator Begin(Transaction *txn, AccessHint hint = AccessHint::NORMAL);
 
   /** @return the end iterator of this table */
   TableIterator End();
@@ -113,6 +119,11 @@ class TableHeap {
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  /**
+   * Extent new pages are allocated in, so that the heap is laid out sequentially on disk. Only appends touch it, and
+   * they hold the WLatch of the last page.
+   */
+  page_id_t extent_ = INVALID_PAGE_ID;
 };
 
 }  // namespace bustub
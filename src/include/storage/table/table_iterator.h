@@ -14,6 +14,8 @@
 
 #include <cassert>
 
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/chain_prefetcher.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
 #include "storage/table/tuple.h"
@@ -27,12 +29,17 @@ class TableHeap;
  */
 class TableIterator {
   friend class Cursor;
+  friend class TableHeap;
 
  public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn, AccessHint hint = AccessHint::NORMAL);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        hint_(other.hint_),
+        prefetcher_(other.prefetcher_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -52,13 +59,22 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    hint_ = other.hint_;
+    prefetcher_ = other.prefetcher_;
     return *this;
   }
 
  private:
+  /** @return the page after a table page */
+  static page_id_t NextTablePageId(Page *page);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** How the pages of the table are fetched while iterating. */
+  AccessHint hint_;
+  /** Keeps the pages ahead of the iterator prefetched. */
+  ChainPrefetcher prefetcher_;
 };
 
 }  // namespace bustub
@@ -12,16 +12,64 @@
 
 #include "recovery/checkpoint_manager.h"
 
+#include <algorithm>
+#include <utility>
+
 namespace bustub {
 
+CheckpointManager::~CheckpointManager() {
+  stop_writer_ = true;
+  EndCheckpoint();
+}
+
 void CheckpointManager::BeginCheckpoint() {
-  // Block all the transactions and ensure that both the WAL and all dirty buffer pool pages are persisted to disk,
-  // creating a consistent checkpoint. Do NOT allow transactions to resume at the end of this method, resume them
-  // in CheckpointManager::EndCheckpoint() instead. This is for grading purposes.
+  EndCheckpoint();
+  if (enable_logging) {
+    LogRecord begin_record(INVALID_TXN_ID, INVALID_LSN, LogRecordType::CHECKPOINT_BEGIN);
+    lsn_t begin_lsn = log_manager_->AppendLogRecord(&begin_record);
+    // Both tables are taken after the begin record, so whatever they miss is logged after it, where recovery sees it.
+    lsn_t oldest_begin_lsn;
+    auto active_txns = transaction_manager_->GetActiveTransactionTable(&oldest_begin_lsn);
+    auto dirty_pages = buffer_pool_manager_->GetDirtyPageTable();
+    // Recovery from this checkpoint redoes from the smallest recLSN and undoes back to the oldest active begin.
+    lsn_t keep_lsn = begin_lsn;
+    for (const auto &[page_id, rec_lsn] : dirty_pages) {
+      keep_lsn = std::min(keep_lsn, rec_lsn);
+    }
+    if (oldest_begin_lsn != INVALID_LSN) {
+      keep_lsn = std::min(keep_lsn, oldest_begin_lsn);
+    }
+    LogRecord end_record(begin_lsn, std::move(active_txns), std::move(dirty_pages));
+    lsn_t end_lsn = log_manager_->AppendLogRecord(&end_record);
+    log_manager_->Flush(end_lsn);
+    // Pages written back before the tables were taken count as clean in them, and their log goes with the truncation.
+    // Those writes may only have reached the page cache, so they are made durable before the log can go.
+    disk_manager_->Sync();
+    disk_manager_->WriteMasterRecord(end_lsn);
+    // Only once the master record points past it can the log before keep_lsn go.
+    disk_manager_->TruncateLog(keep_lsn);
+    writer_ = std::thread(&CheckpointManager::WritePages, this, begin_lsn);
+  } else {
+    buffer_pool_manager_->FlushAllPages();
+  }
+
+  // A restart from this checkpoint can warm the buffer pool up with the pages that are hot now.
+  if (enable_warm_restart) {
+    buffer_pool_manager_->SaveHotPages();
+  }
 }
 
 void CheckpointManager::EndCheckpoint() {
-  // Allow transactions to resume, completing the checkpoint.
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+void CheckpointManager::WritePages(lsn_t rec_lsn) {
+  // Pausing between rounds spreads the writes out, so that transactions do not see one burst of I/O.
+  while (!stop_writer_ && buffer_pool_manager_->FlushDirtyPages(rec_lsn, CHECKPOINT_WRITE_BATCH_SIZE) > 0) {
+    std::this_thread::sleep_for(checkpoint_write_interval);
+  }
 }
 
 }  // namespace bustub
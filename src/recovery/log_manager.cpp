@@ -12,6 +12,15 @@
 
 #include "recovery/log_manager.h"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "common/macros.h"
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,33 +31,247 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  std::scoped_lock latch(latch_);
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+  enable_logging = true;
+  stop_flush_thread_ = false;
+  flush_thread_ = new std::thread(&LogManager::FlushThread, this);
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  {
+    std::scoped_lock latch(latch_);
+    if (flush_thread_ == nullptr) {
+      return;
+    }
+    stop_flush_thread_ = true;
+  }
+  cv_.notify_one();
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  enable_logging = false;
+}
+
+void LogManager::FlushThread() {
+  std::unique_lock latch(latch_);
+  while (true) {
+    cv_.wait_for(latch, log_timeout, [this] { return stop_flush_thread_ || flush_requested_; });
+    // Requests made from here on, while the write is in flight, are served by the next round.
+    bool requested = flush_requested_.exchange(false);
+    if (FlushLocked(&latch)) {
+      continue;
+    }
+    if (persistent_lsn_ + 1 == next_lsn_) {
+      if (stop_flush_thread_) {
+        return;
+      }
+    } else if (requested || stop_flush_thread_) {
+      // What was asked for is still being copied into the log buffer. Try again shortly.
+      flush_requested_ = true;
+      latch.unlock();
+      std::this_thread::yield();
+      latch.lock();
+    }
+  }
+}
+
+bool LogManager::FlushLocked(std::unique_lock<std::mutex> *latch) {
+  flushed_cv_.wait(*latch, [this] { return !flushing_; });
+  auto begin = static_cast<size_t>(persistent_lsn_ + 1);
+  auto end = static_cast<size_t>(GetCompleteLSN());
+  if (end <= begin) {
+    return false;
+  }
+  flushing_ = true;
+  latch->unlock();
+  // The pieces, at most one buffer's worth each, are written at once and the log is durable up to end once the last
+  // of them completes. The disk manager places them in the order they are issued.
+  std::vector<std::pair<size_t, size_t>> pieces;
+  for (size_t pos = begin; pos < end;) {
+    size_t offset = pos % LOG_RING_SIZE;
+    size_t size = std::min({end - pos, LOG_RING_SIZE - offset, static_cast<size_t>(LOG_BUFFER_SIZE)});
+    pieces.emplace_back(offset, size);
+    pos += size;
+  }
+  auto pending = std::make_shared<std::atomic<size_t>>(pieces.size());
+  auto written = std::make_shared<std::promise<void>>();
+  auto durable = written->get_future();
+  for (const auto &[offset, size] : pieces) {
+    disk_manager_->WriteLogAsync(log_buffer_ + offset, static_cast<int>(size), [pending, written] {
+      if (--*pending == 0) {
+        written->set_value();
+      }
+    });
+  }
+  durable.wait();
+  latch->lock();
+  persistent_lsn_ = static_cast<lsn_t>(end - 1);
+  flushing_ = false;
+  flushed_cv_.notify_all();
+  return true;
+}
+
+lsn_t LogManager::GetCompleteLSN() {
+  // next_lsn_ is read first: an append that reserved below it had claimed its slot before, so the slot is seen below.
+  lsn_t complete = next_lsn_;
+  for (auto &slot : insert_slots_) {
+    complete = std::min(complete, slot.load());
+  }
+  return complete;
+}
+
+void LogManager::RequestFlush() {
+  if (!flush_requested_.exchange(true)) {
+    // Taking the latch makes sure that the flush thread is either waiting or has yet to check the flag.
+    std::scoped_lock latch(latch_);
+    cv_.notify_one();
+  }
+}
+
+void LogManager::Flush(lsn_t lsn) {
+  BUSTUB_ASSERT(lsn < next_lsn_, "cannot wait for a log record that has not been appended");
+  if (persistent_lsn_ >= lsn) {
+    return;
+  }
+  std::unique_lock latch(latch_);
+  while (persistent_lsn_ < lsn) {
+    if (flush_thread_ == nullptr) {
+      if (!FlushLocked(&latch)) {
+        latch.unlock();
+        std::this_thread::yield();
+        latch.lock();
+      }
+      continue;
+    }
+    flush_requested_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(latch);
+  }
+}
+
+std::atomic<lsn_t> &LogManager::ClaimInsertSlot() {
+  // Threads start looking at different slots, so that they rarely contend for one.
+  thread_local size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  for (size_t tries = 1;; tries++, hint++) {
+    auto &slot = insert_slots_[hint % LOG_INSERT_SLOTS];
+    lsn_t expected = SLOT_FREE;
+    if (slot.load(std::memory_order_relaxed) == SLOT_FREE && slot.compare_exchange_strong(expected, next_lsn_.load())) {
+      return slot;
+    }
+    if (tries % LOG_INSERT_SLOTS == 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void LogManager::CopyIn(size_t pos, const void *data, size_t size) {
+  size_t offset = pos % LOG_RING_SIZE;
+  size_t first = std::min(size, LOG_RING_SIZE - offset);
+  memcpy(log_buffer_ + offset, data, first);
+  memcpy(log_buffer_, static_cast<const char *>(data) + first, size - first);
+}
 
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
  * @return: lsn that is assigned to this log record
  *
- *
- * example below
- * // First, serialize the must have fields(20 bytes in total)
- * log_record.lsn_ = next_lsn_++;
- * memcpy(log_buffer_ + offset_, &log_record, 20);
- * int pos = offset_ + 20;
- *
- * if (log_record.log_record_type_ == LogRecordType::INSERT) {
- *    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
- *    pos += sizeof(RID);
- *    // we have provided serialize function for tuple class
- *    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
- *  }
- *
+ * Layout: the header (size, LSN, transID, prevLSN, LogType), followed by what the record type carries, see LogRecord.
  */
-lsn_t LogManager::AppendLogRecord(LogRecord *log_record) { return INVALID_LSN; }
+lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
+  auto size = static_cast<size_t>(log_record->size_);
+  BUSTUB_ASSERT(size <= static_cast<size_t>(LOG_BUFFER_SIZE), "log record does not fit in the log buffer");
+  // The slot holds the log back from being written past this record until it has been copied in.
+  auto &slot = ClaimInsertSlot();
+  lsn_t lsn = next_lsn_.fetch_add(static_cast<lsn_t>(size));
+  BUSTUB_ASSERT(lsn >= 0 && static_cast<size_t>(lsn) + size < static_cast<size_t>(SLOT_FREE), "log is too large");
+  slot = lsn;
+  log_record->lsn_ = lsn;
+
+  size_t pos = lsn;
+  size_t end = pos + size;
+  if (end > static_cast<size_t>(persistent_lsn_ + 1) + LOG_RING_SIZE) {
+    // The ring is full: wait until the part of the log this record goes in has been written.
+    std::unique_lock latch(latch_);
+    while (end > static_cast<size_t>(persistent_lsn_ + 1) + LOG_RING_SIZE) {
+      if (flush_thread_ == nullptr) {
+        if (!FlushLocked(&latch)) {
+          latch.unlock();
+          std::this_thread::yield();
+          latch.lock();
+        }
+        continue;
+      }
+      flush_requested_ = true;
+      cv_.notify_one();
+      flushed_cv_.wait(latch);
+    }
+  }
+
+  auto put = [this, &pos](const auto &value) {
+    CopyIn(pos, &value, sizeof(value));
+    pos += sizeof(value);
+  };
+  auto put_tuple = [this, &pos, &put](const Tuple &tuple) {
+    put(static_cast<int32_t>(tuple.GetLength()));
+    CopyIn(pos, tuple.GetData(), tuple.GetLength());
+    pos += tuple.GetLength();
+  };
+  put(log_record->size_);
+  put(log_record->lsn_);
+  put(log_record->txn_id_);
+  put(log_record->prev_lsn_);
+  put(log_record->log_record_type_);
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      put(log_record->insert_rid_);
+      put_tuple(log_record->insert_tuple_);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      put(log_record->delete_rid_);
+      put_tuple(log_record->delete_tuple_);
+      break;
+    case LogRecordType::UPDATE:
+      put(log_record->update_rid_);
+      put_tuple(log_record->old_tuple_);
+      put_tuple(log_record->new_tuple_);
+      break;
+    case LogRecordType::NEWPAGE:
+      put(log_record->prev_page_id_);
+      put(log_record->page_id_);
+      break;
+    case LogRecordType::CHECKPOINT_END:
+      put(static_cast<int32_t>(log_record->active_txns_.size()));
+      for (const auto &[txn_id, last_lsn] : log_record->active_txns_) {
+        put(txn_id);
+        put(last_lsn);
+      }
+      put(static_cast<int32_t>(log_record->dirty_pages_.size()));
+      for (const auto &[page_id, rec_lsn] : log_record->dirty_pages_) {
+        put(page_id);
+        put(rec_lsn);
+      }
+      break;
+    default:
+      break;
+  }
+  BUSTUB_ASSERT(pos == end, "log record size does not match its contents");
+  slot = SLOT_FREE;
+
+  // Once a buffer's worth of the log is waiting, have it written.
+  if (end >= static_cast<size_t>(persistent_lsn_ + 1) + LOG_BUFFER_SIZE) {
+    RequestFlush();
+  }
+  return lsn;
+}
 
 }  // namespace bustub
@@ -12,6 +12,11 @@
 
 #include "recovery/log_recovery.h"
 
+#include <cstring>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/macros.h"
 #include "storage/page/table_page.h"
 
 namespace bustub {
@@ -19,22 +24,342 @@ namespace bustub {
  * deserialize a log record from log buffer
  * @return: true means deserialize succeed, otherwise can't deserialize cause
  * incomplete log record
+ *
+ * The caller makes sure that the whole record, as long as its size field says, is in the buffer.
  */
-bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) { return false; }
+bool LogRecovery::DeserializeLogRecord(const char *data, LogRecord *log_record) {
+  const char *pos = data;
+  auto get = [&pos](auto *value) {
+    memcpy(value, pos, sizeof(*value));
+    pos += sizeof(*value);
+  };
+  auto get_tuple = [&pos](Tuple *tuple) {
+    tuple->DeserializeFrom(pos);
+    pos += sizeof(int32_t) + tuple->GetLength();
+  };
+  get(&log_record->size_);
+  if (log_record->size_ < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  get(&log_record->lsn_);
+  get(&log_record->txn_id_);
+  get(&log_record->prev_lsn_);
+  get(&log_record->log_record_type_);
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      get(&log_record->insert_rid_);
+      get_tuple(&log_record->insert_tuple_);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      get(&log_record->delete_rid_);
+      get_tuple(&log_record->delete_tuple_);
+      break;
+    case LogRecordType::UPDATE:
+      get(&log_record->update_rid_);
+      get_tuple(&log_record->old_tuple_);
+      get_tuple(&log_record->new_tuple_);
+      break;
+    case LogRecordType::NEWPAGE:
+      get(&log_record->prev_page_id_);
+      get(&log_record->page_id_);
+      break;
+    case LogRecordType::CHECKPOINT_END: {
+      // Bound the counts by the record's size before trusting them, the record may be garbage past the end of the log.
+      const int32_t entry_size = sizeof(int32_t) + sizeof(lsn_t);
+      for (auto *table : {&log_record->active_txns_, &log_record->dirty_pages_}) {
+        int32_t count;
+        get(&count);
+        if (count < 0 || count > (data + log_record->size_ - pos) / entry_size) {
+          return false;
+        }
+        table->resize(count);
+        for (auto &[id, lsn] : *table) {
+          get(&id);
+          get(&lsn);
+        }
+      }
+      break;
+    }
+    case LogRecordType::BEGIN:
+    case LogRecordType::COMMIT:
+    case LogRecordType::ABORT:
+    case LogRecordType::CHECKPOINT_BEGIN:
+      break;
+    default:
+      return false;
+  }
+  return pos == data + log_record->size_;
+}
 
 /*
  *redo phase on TABLE PAGE level(table/table_page.h)
- *read log file from the beginning to end (you must prefetch log records into
+ *read log file from the redo point of the last checkpoint to end (you must prefetch log records into
  *log buffer to reduce unnecessary I/O operations), remember to compare page's
- *LSN with log_record's sequence number, and also build active_txn_ table &
- *lsn_mapping_ table
+ *LSN with log_record's sequence number, and also build active_txn_ table
  */
-void LogRecovery::Redo() {}
+void LogRecovery::Redo() {
+  std::vector<std::unique_ptr<RedoPartition>> partitions;
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_redo_workers_; i++) {
+    partitions.emplace_back(std::make_unique<RedoPartition>());
+    workers.emplace_back(&LogRecovery::RunRedoWorker, this, partitions.back().get());
+  }
+
+  ReadCheckpoint();
+  offset_ = redo_lsn_;
+  bool end_of_log = false;
+  std::vector<std::vector<RedoTask>> batches(num_redo_workers_);
+  while (!end_of_log && disk_manager_->ReadLog(log_buffer_, LOG_RECOVERY_READ_SIZE, offset_)) {
+    size_t pos = 0;
+    while (true) {
+      // A record cut off by the end of the buffer is read again, from its start, with the next read.
+      int32_t size;
+      if (pos + sizeof(size) > static_cast<size_t>(LOG_RECOVERY_READ_SIZE)) {
+        break;
+      }
+      memcpy(&size, log_buffer_ + pos, sizeof(size));
+      if (size > 0 && pos + size > static_cast<size_t>(LOG_RECOVERY_READ_SIZE)) {
+        break;
+      }
+      LogRecord log_record;
+      // The read is zero-filled past the end of the log file, which does not deserialize.
+      if (size <= 0 || !DeserializeLogRecord(log_buffer_ + pos, &log_record)) {
+        end_of_log = true;
+        break;
+      }
+      pos += size;
+
+      switch (log_record.log_record_type_) {
+        case LogRecordType::COMMIT:
+        case LogRecordType::ABORT:
+          active_txn_.erase(log_record.txn_id_);
+          continue;
+        case LogRecordType::BEGIN:
+          active_txn_[log_record.txn_id_] = log_record.lsn_;
+          continue;
+        case LogRecordType::CHECKPOINT_BEGIN:
+        case LogRecordType::CHECKPOINT_END:
+          continue;
+        default:
+          active_txn_[log_record.txn_id_] = log_record.lsn_;
+          break;
+      }
+      page_id_t page_id;
+      switch (log_record.log_record_type_) {
+        case LogRecordType::INSERT:
+          page_id = log_record.insert_rid_.GetPageId();
+          break;
+        case LogRecordType::UPDATE:
+          page_id = log_record.update_rid_.GetPageId();
+          break;
+        case LogRecordType::NEWPAGE:
+          // Linking the new page into the table changed the previous page as well.
+          if (log_record.prev_page_id_ != INVALID_PAGE_ID) {
+            batches[log_record.prev_page_id_ % num_redo_workers_].push_back({log_record.prev_page_id_, log_record});
+          }
+          page_id = log_record.page_id_;
+          break;
+        default:
+          page_id = log_record.delete_rid_.GetPageId();
+          break;
+      }
+      batches[page_id % num_redo_workers_].push_back({page_id, std::move(log_record)});
+    }
+    offset_ += pos;
+    for (size_t i = 0; i < num_redo_workers_; i++) {
+      if (batches[i].empty()) {
+        continue;
+      }
+      {
+        std::scoped_lock latch(partitions[i]->latch_);
+        partitions[i]->batches_.push_back(std::move(batches[i]));
+      }
+      partitions[i]->cv_.notify_one();
+      batches[i].clear();
+    }
+  }
+
+  for (auto &partition : partitions) {
+    {
+      std::scoped_lock latch(partition->latch_);
+      partition->done_ = true;
+    }
+    partition->cv_.notify_one();
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (auto &partition : partitions) {
+    if (partition->error_ != nullptr) {
+      std::rethrow_exception(partition->error_);
+    }
+  }
+}
+
+void LogRecovery::ReadCheckpoint() {
+  active_txn_.clear();
+  redo_lsn_ = 0;
+  lsn_t checkpoint_lsn = disk_manager_->ReadMasterRecord();
+  if (checkpoint_lsn == INVALID_LSN) {
+    return;
+  }
+  LogRecord checkpoint;
+  if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, checkpoint_lsn) ||
+      !DeserializeLogRecord(log_buffer_, &checkpoint) ||
+      checkpoint.log_record_type_ != LogRecordType::CHECKPOINT_END) {
+    LOG_DEBUG("master record points at no checkpoint, redoing the whole log");
+    return;
+  }
+  // The tables were taken after the begin record, so redo reads at least from there. A transaction in the table that
+  // logs more after that point has its entry replaced as redo reads along.
+  redo_lsn_ = checkpoint.prev_lsn_;
+  for (const auto &[txn_id, last_lsn] : checkpoint.active_txns_) {
+    active_txn_[txn_id] = last_lsn;
+  }
+  for (const auto &[page_id, rec_lsn] : checkpoint.dirty_pages_) {
+    redo_lsn_ = std::min(redo_lsn_, rec_lsn);
+  }
+}
+
+void LogRecovery::RunRedoWorker(RedoPartition *partition) {
+  std::unique_lock latch(partition->latch_);
+  while (true) {
+    partition->cv_.wait(latch, [partition] { return partition->done_ || !partition->batches_.empty(); });
+    if (partition->batches_.empty()) {
+      return;
+    }
+    std::vector<RedoTask> batch = std::move(partition->batches_.front());
+    partition->batches_.pop_front();
+    latch.unlock();
+    // After a failure the rest of the partition is only drained.
+    if (partition->error_ == nullptr) {
+      try {
+        for (auto &task : batch) {
+          RedoRecord(task.page_id_, &task.log_record_);
+        }
+      } catch (...) {
+        partition->error_ = std::current_exception();
+      }
+    }
+    latch.lock();
+  }
+}
+
+void LogRecovery::RedoRecord(page_id_t page_id, LogRecord *log_record) {
+  auto *page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "the buffer pool needs a frame for every redo worker");
+  page->WLatch();
+  bool dirty = false;
+  bool replayed = true;
+  if (log_record->log_record_type_ == LogRecordType::NEWPAGE && page_id != log_record->page_id_) {
+    // The next page id is not covered by the page's lsn, but it is only ever set once.
+    if (page->GetNextPageId() == INVALID_PAGE_ID) {
+      page->SetNextPageId(log_record->page_id_);
+      dirty = true;
+    }
+  } else if (page->GetLSN() < log_record->lsn_) {
+    Tuple old_tuple;
+    switch (log_record->log_record_type_) {
+      case LogRecordType::INSERT:
+        // Later records refer to the tuple by its rid, so it has to go back exactly where it was.
+        replayed = page->InsertTupleAt(log_record->insert_tuple_, log_record->insert_rid_);
+        break;
+      case LogRecordType::MARKDELETE:
+        page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+        break;
+      case LogRecordType::APPLYDELETE:
+        page->ApplyDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::ROLLBACKDELETE:
+        page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+        break;
+      case LogRecordType::UPDATE:
+        page->UpdateTuple(log_record->new_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+        break;
+      case LogRecordType::NEWPAGE:
+        page->Init(page_id, PAGE_SIZE, log_record->prev_page_id_, nullptr, nullptr);
+        break;
+      default:
+        break;
+    }
+    if (replayed) {
+      page->SetLSN(log_record->lsn_);
+      dirty = true;
+    }
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, dirty);
+  if (!replayed) {
+    throw Exception("cannot redo " + log_record->ToString() + ": the page does not match the log");
+  }
+}
 
 /*
  *undo phase on TABLE PAGE level(table/table_page.h)
  *iterate through active txn map and undo each operation
  */
-void LogRecovery::Undo() {}
+void LogRecovery::Undo() {
+  for (auto &[txn_id, last_lsn] : active_txn_) {
+    for (lsn_t lsn = last_lsn; lsn != INVALID_LSN;) {
+      LogRecord log_record;
+      if (!disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, lsn) ||
+          !DeserializeLogRecord(log_buffer_, &log_record)) {
+        LOG_DEBUG("cannot read log record %lld of txn %d", static_cast<long long>(lsn), txn_id);
+        break;
+      }
+      UndoRecord(&log_record);
+      lsn = log_record.prev_lsn_;
+    }
+  }
+  active_txn_.clear();
+}
+
+void LogRecovery::UndoRecord(LogRecord *log_record) {
+  page_id_t page_id;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page_id = log_record->insert_rid_.GetPageId();
+      break;
+    case LogRecordType::UPDATE:
+      page_id = log_record->update_rid_.GetPageId();
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      page_id = log_record->delete_rid_.GetPageId();
+      break;
+    default:
+      // A new page stays in the table, empty.
+      return;
+  }
+  auto *page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  BUSTUB_ASSERT(page != nullptr, "the buffer pool needs a free frame for undo");
+  page->WLatch();
+  RID rid;
+  Tuple old_tuple;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      page->ApplyDelete(log_record->insert_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::MARKDELETE:
+      page->RollbackDelete(log_record->delete_rid_, nullptr, nullptr);
+      break;
+    case LogRecordType::APPLYDELETE:
+      page->InsertTuple(log_record->delete_tuple_, &rid, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::ROLLBACKDELETE:
+      page->MarkDelete(log_record->delete_rid_, nullptr, nullptr, nullptr);
+      break;
+    case LogRecordType::UPDATE:
+      page->UpdateTuple(log_record->old_tuple_, &old_tuple, log_record->update_rid_, nullptr, nullptr, nullptr);
+      break;
+    default:
+      break;
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, true);
+}
 
 }  // namespace bustub
@@ -10,209 +10,167 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include <sys/stat.h>
-#include <cassert>
-#include <cstring>
-#include <iostream>
+#include "storage/disk/disk_manager.h"
+
+#include <algorithm>
+#include <memory>
 #include <mutex>  // NOLINT
-#include <string>
-#include <thread>  // NOLINT
+#include <utility>
 
-#include "common/exception.h"
-#include "common/logger.h"
-#include "storage/disk/disk_manager.h"
+#include "common/macros.h"
 
 namespace bustub {
 
-static char *buffer_used;
-
-/**
- * Constructor: open/create a single database file & log file
- * @input db_file: database file name
- */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
-  std::string::size_type n = file_name_.rfind('.');
-  if (n == std::string::npos) {
-    LOG_DEBUG("wrong file format");
-    return;
-  }
-  log_name_ = file_name_.substr(0, n) + ".log";
-
-  log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app | std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-    if (!log_io_.is_open()) {
-      throw Exception("can't open dblog file");
-    }
+void DiskManager::WritePages(std::vector<std::pair<page_id_t, const char *>> pages) {
+  for (const auto &[page_id, page_data] : pages) {
+    WritePage(page_id, page_data);
   }
+}
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
-    }
+void DiskManager::ReadPages(std::vector<std::pair<page_id_t, char *>> pages) {
+  for (const auto &[page_id, page_data] : pages) {
+    ReadPage(page_id, page_data);
   }
-  buffer_used = nullptr;
 }
 
 /**
- * Close all file streams
+ * Write synchronously and call back before returning
  */
-void DiskManager::ShutDown() {
-  {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
-  }
-  log_io_.close();
+void DiskManager::WritePageAsync(page_id_t page_id, const char *page_data, std::function<void()> callback) {
+  WritePage(page_id, page_data);
+  callback();
+}
+
+std::future<void> DiskManager::WritePageAsync(page_id_t page_id, const char *page_data) {
+  auto promise = std::make_shared<std::promise<void>>();
+  auto future = promise->get_future();
+  WritePageAsync(page_id, page_data, [promise] { promise->set_value(); });
+  return future;
 }
 
 /**
- * Write the contents of the specified page into disk file
+ * Read synchronously and call back before returning
  */
-void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
-  num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
-    return;
-  }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+void DiskManager::ReadPageAsync(page_id_t page_id, char *page_data, std::function<void()> callback) {
+  ReadPage(page_id, page_data);
+  callback();
+}
+
+std::future<void> DiskManager::ReadPageAsync(page_id_t page_id, char *page_data) {
+  auto promise = std::make_shared<std::promise<void>>();
+  auto future = promise->get_future();
+  ReadPageAsync(page_id, page_data, [promise] { promise->set_value(); });
+  return future;
 }
 
 /**
- * Read the contents of the specified page into the given memory area
+ * Hand out the lowest free page that mods back to the instance.
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
-      LOG_DEBUG("I/O error while reading");
-      return;
+page_id_t DiskManager::AllocatePage(uint32_t instance_index, uint32_t num_instances) {
+  BUSTUB_ASSERT(instance_index < num_instances, "instance index out of range");
+  std::scoped_lock scoped_fsm_latch(fsm_latch_);
+  if (allocation_hints_.size() != num_instances) {
+    allocation_hints_.resize(num_instances);
+    for (uint32_t i = 0; i < num_instances; i++) {
+      allocation_hints_[i] = static_cast<page_id_t>(i);
+    }
+  }
+  page_id_t page_id = allocation_hints_[instance_index];
+  while (IsAllocatedLocked(page_id) || IsReservedLocked(page_id)) {
+    page_id += static_cast<page_id_t>(num_instances);
+  }
+  SetAllocatedLocked(page_id, true);
+  allocation_hints_[instance_index] = page_id + static_cast<page_id_t>(num_instances);
+  return page_id;
+}
+
+page_id_t DiskManager::AllocatePageInExtent(page_id_t *extent) {
+  std::scoped_lock scoped_fsm_latch(fsm_latch_);
+  if (*extent != INVALID_PAGE_ID) {
+    for (page_id_t page_id = *extent; page_id < *extent + EXTENT_SIZE; page_id++) {
+      if (!IsAllocatedLocked(page_id)) {
+        SetAllocatedLocked(page_id, true);
+        return page_id;
+      }
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    // The extent is full: it holds no free id for AllocatePage to get back, so it just stops being set aside.
+    reserved_extents_.erase(*extent);
+  }
+  // An extent is free when none of its bits is set, i.e. when its EXTENT_SIZE / 8 bytes of the map are all zero.
+  static_assert(EXTENT_SIZE % 8 == 0, "extents must cover whole bytes of the free page map");
+  const size_t extent_bytes = EXTENT_SIZE / 8;
+  page_id_t start = 0;
+  for (;; start += EXTENT_SIZE) {
+    size_t byte = static_cast<size_t>(start) / 8;
+    if (byte >= allocation_map_.size()) {
+      break;
+    }
+    if (reserved_extents_.count(start) == 0 &&
+        std::all_of(allocation_map_.begin() + byte, allocation_map_.begin() + byte + extent_bytes,
+                    [](uint8_t bits) { return bits == 0; })) {
+      break;
     }
   }
+  reserved_extents_.insert(start);
+  *extent = start;
+  SetAllocatedLocked(start, true);
+  return start;
 }
 
 /**
- * Write the contents of the log into disk file
- * Only return when sync is done, and only perform sequence write
+ * Clear the page's bit in the free page map. Deallocating a page that is not allocated is a no-op.
  */
-void DiskManager::WriteLog(char *log_data, int size) {
-  // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
-
-  if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_fsm_latch(fsm_latch_);
+  if (!IsAllocatedLocked(page_id)) {
     return;
   }
-
-  flush_log_ = true;
-
-  if (flush_log_f_ != nullptr) {
-    // used for checking non-blocking flushing
-    assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+  SetAllocatedLocked(page_id, false);
+  if (!allocation_hints_.empty()) {
+    auto &hint = allocation_hints_[page_id % allocation_hints_.size()];
+    hint = std::min(hint, page_id);
   }
+}
 
-  num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
-  }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
-  flush_log_ = false;
+bool DiskManager::IsAllocated(page_id_t page_id) {
+  std::scoped_lock scoped_fsm_latch(fsm_latch_);
+  return IsAllocatedLocked(page_id);
 }
 
 /**
- * Read the contents of the log into the given memory area
- * Always read from the beginning and perform sequence read
- * @return: false means already reach the end
+ * Private helper function to test a page's bit in the free page map. Caller must hold fsm_latch_.
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
-    // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
-    return false;
-  }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
-
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while reading log");
+bool DiskManager::IsAllocatedLocked(page_id_t page_id) const {
+  if (page_id < 0) {
     return false;
   }
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
-  if (read_count < size) {
-    log_io_.clear();
-    memset(log_data + read_count, 0, size - read_count);
-  }
-
-  return true;
+  size_t byte = static_cast<size_t>(page_id) / 8;
+  return byte < allocation_map_.size() && (allocation_map_[byte] & (1U << (page_id % 8))) != 0;
 }
 
 /**
- * Returns number of flushes made so far
- */
-int DiskManager::GetNumFlushes() const { return num_flushes_; }
-
-/**
- * Returns number of Writes made so far
- */
-int DiskManager::GetNumWrites() const { return num_writes_; }
-
-/**
- * Returns true if the log is currently being flushed
+ * Private helper function to test whether a page is in an extent set aside by AllocatePageInExtent. Caller must hold
+ * fsm_latch_.
  */
-bool DiskManager::GetFlushState() const { return flush_log_; }
+bool DiskManager::IsReservedLocked(page_id_t page_id) const {
+  return !reserved_extents_.empty() && reserved_extents_.count(page_id / EXTENT_SIZE * EXTENT_SIZE) != 0;
+}
 
 /**
- * Private helper function to get disk file size
+ * Private helper function to flip a page's bit in the free page map and hand the map page holding it to
+ * OnFreePageMapChange. Caller must hold fsm_latch_.
  */
-int DiskManager::GetFileSize(const std::string &file_name) {
-  struct stat stat_buf;
-  int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? static_cast<int>(stat_buf.st_size) : -1;
+void DiskManager::SetAllocatedLocked(page_id_t page_id, bool allocated) {
+  size_t byte = static_cast<size_t>(page_id) / 8;
+  if (byte >= allocation_map_.size()) {
+    allocation_map_.resize((byte / PAGE_SIZE + 1) * PAGE_SIZE, 0);
+  }
+  if (allocated) {
+    allocation_map_[byte] |= 1U << (page_id % 8);
+  } else {
+    allocation_map_[byte] &= ~(1U << (page_id % 8));
+  }
+  OnFreePageMapChange(byte / PAGE_SIZE);
 }
 
 }  // namespace bustub
@@ -0,0 +1,119 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// fault_injecting_disk_manager.cpp
+//
+// Identification: src/storage/disk/fault_injecting_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/fault_injecting_disk_manager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>  // NOLINT
+
+#include "common/logger.h"
+
+namespace bustub {
+
+std::chrono::microseconds InjectedLatency::Sample(std::mt19937_64 *rng) const {
+  switch (distribution_) {
+    case LatencyDistribution::NONE:
+      return std::chrono::microseconds(0);
+    case LatencyDistribution::FIXED:
+      return min_;
+    case LatencyDistribution::UNIFORM:
+      return std::chrono::microseconds(
+          std::uniform_int_distribution<int64_t>(min_.count(), std::max(min_, max_).count())(*rng));
+    case LatencyDistribution::PARETO: {
+      // Inverse transform sampling: for u uniform in (0, 1], min_ / u^(1 / shape_) is Pareto distributed.
+      double u = 1.0 - std::uniform_real_distribution<double>(0.0, 1.0)(*rng);
+      double latency = static_cast<double>(min_.count()) / std::pow(u, 1.0 / shape_);
+      return std::chrono::microseconds(static_cast<int64_t>(std::min(latency, static_cast<double>(max_.count()))));
+    }
+  }
+  return std::chrono::microseconds(0);
+}
+
+FaultInjectingDiskManager::FaultInjectingDiskManager(DiskManager *disk_manager, InjectedFaults faults)
+    : disk_manager_(disk_manager), faults_(faults), rng_(faults.seed_) {}
+
+bool FaultInjectingDiskManager::Inject(const InjectedLatency &latency, double error_rate) {
+  std::chrono::microseconds delay;
+  bool fail;
+  {
+    std::scoped_lock latch(rng_latch_);
+    delay = latency.Sample(&rng_);
+    fail = error_rate > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(rng_) < error_rate;
+  }
+  if (delay.count() > 0) {
+    std::this_thread::sleep_for(delay);
+  }
+  if (fail) {
+    num_injected_errors_++;
+  }
+  return fail;
+}
+
+void FaultInjectingDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  num_writes_ += 1;
+  num_write_calls_ += 1;
+  if (Inject(faults_.write_latency_, faults_.write_error_rate_)) {
+    LOG_DEBUG("injected I/O error while writing");
+    return;
+  }
+  disk_manager_->WritePage(page_id, page_data);
+}
+
+void FaultInjectingDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (Inject(faults_.read_latency_, faults_.read_error_rate_)) {
+    LOG_DEBUG("injected I/O error while reading");
+    return;
+  }
+  disk_manager_->ReadPage(page_id, page_data);
+}
+
+void FaultInjectingDiskManager::WritePages(std::vector<std::pair<page_id_t, const char *>> pages) {
+  num_writes_ += pages.size();
+  num_write_calls_ += 1;
+  if (Inject(faults_.write_latency_, faults_.write_error_rate_)) {
+    LOG_DEBUG("injected I/O error while writing");
+    return;
+  }
+  disk_manager_->WritePages(std::move(pages));
+}
+
+void FaultInjectingDiskManager::ReadPages(std::vector<std::pair<page_id_t, char *>> pages) {
+  if (Inject(faults_.read_latency_, faults_.read_error_rate_)) {
+    LOG_DEBUG("injected I/O error while reading");
+    return;
+  }
+  disk_manager_->ReadPages(std::move(pages));
+}
+
+void FaultInjectingDiskManager::WriteLog(char *log_data, int size) {
+  if (size > 0) {
+    num_flushes_ += 1;
+  }
+  Inject(faults_.write_latency_, 0);
+  disk_manager_->WriteLog(log_data, size);
+}
+
+bool FaultInjectingDiskManager::ReadLog(char *log_data, int size, int64_t offset) {
+  Inject(faults_.read_latency_, 0);
+  return disk_manager_->ReadLog(log_data, size, offset);
+}
+
+void FaultInjectingDiskManager::WriteLogAsync(const char *log_data, int size, std::function<void()> callback) {
+  if (size > 0) {
+    num_flushes_ += 1;
+  }
+  Inject(faults_.write_latency_, 0);
+  disk_manager_->WriteLogAsync(log_data, size, std::move(callback));
+}
+
+}  // namespace bustub
@@ -0,0 +1,1182 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// file_disk_manager.cpp
+//
+// Identification: src/storage/disk/file_disk_manager.cpp
+//
+// Copyright (c) 2015-2019, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "common/exception.h"
+#include "common/macros.h"
+#include "common/logger.h"
+#include "storage/disk/file_disk_manager.h"
+
+namespace bustub {
+
+static char *buffer_used;
+
+/** First word of every manifest file. */
+static constexpr uint32_t MANIFEST_MAGIC = 0x42544850;
+
+/** First word of the master record file. */
+static constexpr uint32_t MASTER_RECORD_MAGIC = 0x4254434b;
+
+/**
+ * pread until size bytes are read, end of file or an error.
+ * @return the number of bytes read, or -1 on error
+ */
+static ssize_t PreadFully(int fd, char *data, size_t size, size_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t rc = pread(fd, data + done, size - done, static_cast<off_t>(offset + done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return -1;
+    }
+    if (rc == 0) {
+      break;
+    }
+    done += rc;
+  }
+  return static_cast<ssize_t>(done);
+}
+
+/**
+ * pwrite until size bytes are written or an error.
+ * @return false on error
+ */
+static bool PwriteFully(int fd, const char *data, size_t size, size_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t rc = pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      return false;
+    }
+    done += rc;
+  }
+  return true;
+}
+
+/**
+ * preadv/pwritev until every iovec is transferred, end of file or an error. The iovecs are consumed in the process.
+ * @return the number of bytes transferred, or -1 on error
+ */
+static ssize_t TransferFully(int fd, bool is_write, struct iovec *iov, int iovcnt, size_t offset) {
+  size_t done = 0;
+  while (iovcnt > 0) {
+    auto position = static_cast<off_t>(offset + done);
+    ssize_t rc = is_write ? pwritev(fd, iov, iovcnt, position) : preadv(fd, iov, iovcnt, position);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
+      return -1;
+    }
+    if (rc == 0) {
+      break;
+    }
+    done += rc;
+    // Skip what was transferred: whole iovecs, then the front of a partial one.
+    auto left = static_cast<size_t>(rc);
+    while (iovcnt > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+  return static_cast<ssize_t>(done);
+}
+
+// Page offsets go up to INT32_MAX * PAGE_SIZE, far past 2 GB, so every offset is a size_t and every file position
+// an off_t of 64 bits.
+static_assert(sizeof(off_t) == 8, "the database file needs 64-bit file offsets");
+static_assert(sizeof(size_t) == 8, "the database file needs 64-bit page offsets");
+
+static_assert(PAGE_SIZE % DIRECT_IO_ALIGNMENT == 0, "O_DIRECT needs whole aligned blocks");
+
+/** @return true iff the buffer can be handed to O_DIRECT I/O as is */
+static bool IsDirectIOAligned(const char *data) {
+  return reinterpret_cast<uintptr_t>(data) % DIRECT_IO_ALIGNMENT == 0;
+}
+
+/** @return a DIRECT_IO_ALIGNMENT aligned page buffer */
+static std::shared_ptr<char> AllocateBounceBuffer() {
+  return std::shared_ptr<char>(static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, PAGE_SIZE)), std::free);
+}
+
+/** Bounce buffer of the synchronous calls, one per thread. */
+alignas(DIRECT_IO_ALIGNMENT) static thread_local char bounce_buffer[PAGE_SIZE];
+
+/**
+ * Constructor: open/create a single database file & log file
+ * @input db_file: database file name
+ */
+FileDiskManager::FileDiskManager(const std::string &db_file, DiskIOBackend backend, StorageLayout layout)
+    : layout_(std::move(layout)),
+      backend_(layout_.segment_pages_ > 0 && backend == DiskIOBackend::FSTREAM ? DiskIOBackend::PREAD : backend),
+      file_name_(db_file), flush_log_(false), flush_log_f_(nullptr) {
+  std::string::size_type n = file_name_.rfind('.');
+  if (n == std::string::npos) {
+    LOG_DEBUG("wrong file format");
+    return;
+  }
+  file_stem_ = file_name_.substr(0, n);
+
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+  bool fresh = !db_io_.is_open();
+  // directory or file does not exist
+  if (fresh) {
+    db_io_.clear();
+    // create a new file
+    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
+    db_io_.close();
+    // reopen with original mode
+    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+    if (!db_io_.is_open()) {
+      throw Exception("can't open db file");
+    }
+    // Manifests left behind by an earlier database of the same name describe pages that no longer exist.
+    for (uint32_t i = 0; remove(GetManifestName(i).c_str()) == 0; i++) {
+    }
+    remove(GetMasterRecordName().c_str());
+  }
+  OpenLog(fresh);
+  if (backend_ != DiskIOBackend::FSTREAM) {
+    // The stream was only needed to create the file.
+    db_io_.close();
+    if (backend_ == DiskIOBackend::DIRECT) {
+      db_fd_ = ::open(db_file.c_str(), O_RDWR | O_DIRECT);
+      direct_io_ = db_fd_ >= 0;
+      if (db_fd_ < 0 && errno == EINVAL) {
+        LOG_DEBUG("O_DIRECT not supported for %s, going through the page cache", db_file.c_str());
+      }
+    }
+    if (db_fd_ < 0) {
+      db_fd_ = ::open(db_file.c_str(), O_RDWR);
+    }
+    if (db_fd_ < 0) {
+      throw Exception("can't open db file");
+    }
+  }
+  db_file_size_ = std::max<int64_t>(GetFileSize(file_name_), 0);
+  if (layout_.segment_pages_ > 0) {
+    segment_fds_.push_back(db_fd_);
+    if (fresh) {
+      // Segments left behind by an earlier database of the same name hold pages that no longer exist.
+      for (size_t i = 1; remove(GetSegmentName(i).c_str()) == 0; i++) {
+      }
+    }
+    // Segments are created in order, so the existing ones are numbered without gaps.
+    struct stat stat_buf;
+    for (size_t i = 1; stat(GetSegmentName(i).c_str(), &stat_buf) == 0; i++) {
+      if (OpenSegment(i) < 0) {
+        throw Exception("can't open db segment file");
+      }
+      db_file_size_ = i * layout_.segment_pages_ * PAGE_SIZE + stat_buf.st_size;
+    }
+  }
+  OpenFreePageMap(fresh);
+  buffer_used = nullptr;
+}
+
+FileDiskManager::~FileDiskManager() { StopCompaction(); }
+
+/**
+ * Close all file streams
+ */
+void FileDiskManager::ShutDown() {
+  StopCompaction();
+  // Let every asynchronous request complete before the files go away.
+  io_engine_.reset();
+  {
+    std::scoped_lock scoped_fsm_latch(fsm_latch_);
+    fsm_io_.close();
+  }
+  {
+    std::scoped_lock scoped_db_io_latch(db_io_latch_);
+    db_io_.close();
+    if (db_fd_ >= 0) {
+      close(db_fd_);
+      db_fd_ = -1;
+    }
+    segment_latch_.WLock();
+    for (size_t i = 1; i < segment_fds_.size(); i++) {
+      close(segment_fds_[i]);
+    }
+    segment_fds_.clear();
+    segment_latch_.WUnlock();
+  }
+  std::scoped_lock scoped_log_latch(log_latch_);
+  for (const auto &[segment, fd] : log_segment_fds_) {
+    close(fd);
+  }
+  log_segment_fds_.clear();
+}
+
+/**
+ * Write the contents of the specified page into disk file
+ */
+void FileDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
+  num_writes_ += 1;
+  num_write_calls_ += 1;
+  if (backend_ != DiskIOBackend::FSTREAM) {
+    if (!WriteDbPage(page_data, page_id)) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    GrowFileSize(offset + PAGE_SIZE);
+    return;
+  }
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  // set write cursor to offset
+  db_io_.seekp(offset);
+  db_io_.write(page_data, PAGE_SIZE);
+  // check for I/O error
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while writing");
+    return;
+  }
+  // needs to flush to keep disk file in sync
+  db_io_.flush();
+  GrowFileSize(offset + PAGE_SIZE);
+}
+
+/**
+ * Read the contents of the specified page into the given memory area
+ */
+void FileDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
+  // check if read beyond file length
+  if (offset > db_file_size_) {
+    LOG_DEBUG("I/O error reading past end of file");
+    return;
+  }
+  if (backend_ != DiskIOBackend::FSTREAM) {
+    ssize_t read_count = ReadDbPage(page_data, page_id);
+    if (read_count < 0) {
+      LOG_DEBUG("I/O error while reading");
+      return;
+    }
+    if (read_count < PAGE_SIZE) {
+      LOG_DEBUG("Read less than a page");
+      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    }
+    return;
+  }
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  // set read cursor to offset
+  db_io_.seekp(offset);
+  db_io_.read(page_data, PAGE_SIZE);
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while reading");
+    return;
+  }
+  // if file ends before reading PAGE_SIZE
+  int read_count = db_io_.gcount();
+  if (read_count < PAGE_SIZE) {
+    LOG_DEBUG("Read less than a page");
+    db_io_.clear();
+    // std::cerr << "Read less than a page" << std::endl;
+    memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+  }
+}
+
+/**
+ * Cut the database file back to just past its last allocated page. Pages are only ever written while they are
+ * allocated, and both latches are held, so nothing can be writing into the range that goes away.
+ */
+size_t FileDiskManager::Compact() {
+  std::scoped_lock latches(fsm_latch_, db_io_latch_);
+  size_t file_size = db_file_size_;
+  if (file_size == 0 || (!db_io_.is_open() && db_fd_ < 0)) {
+    return 0;
+  }
+  size_t end = allocation_map_.size();
+  while (end > 0 && allocation_map_[end - 1] == 0) {
+    end--;
+  }
+  size_t num_pages = 0;
+  if (end > 0) {
+    uint8_t last = allocation_map_[end - 1];
+    num_pages = (end - 1) * 8;
+    while (last != 0) {
+      num_pages++;
+      last >>= 1;
+    }
+  }
+  size_t file_pages = (file_size + PAGE_SIZE - 1) / PAGE_SIZE;
+  if (file_pages <= num_pages) {
+    return 0;
+  }
+  auto new_size = static_cast<off_t>(num_pages * PAGE_SIZE);
+  int rc;
+  if (backend_ != DiskIOBackend::FSTREAM) {
+    rc = TruncatePages(num_pages) ? 0 : -1;
+  } else {
+    db_io_.flush();
+    rc = truncate(file_name_.c_str(), new_size);
+  }
+  if (rc != 0) {
+    LOG_DEBUG("I/O error while truncating");
+    return 0;
+  }
+  db_file_size_ = num_pages * PAGE_SIZE;
+  return file_pages - num_pages;
+}
+
+void FileDiskManager::StartCompaction(std::chrono::milliseconds interval) {
+  StopCompaction();
+  {
+    std::scoped_lock scoped_fsm_latch(fsm_latch_);
+    compaction_stop_ = false;
+  }
+  compaction_thread_ = std::thread([this, interval] {
+    std::unique_lock<std::mutex> lock(fsm_latch_);
+    while (!compaction_cv_.wait_for(lock, interval, [this] { return compaction_stop_; })) {
+      lock.unlock();
+      Compact();
+      lock.lock();
+    }
+  });
+}
+
+void FileDiskManager::WritePages(std::vector<std::pair<page_id_t, const char *>> pages) {
+  std::vector<std::pair<page_id_t, char *>> batch;
+  batch.reserve(pages.size());
+  for (const auto &[page_id, page_data] : pages) {
+    batch.emplace_back(page_id, const_cast<char *>(page_data));
+  }
+  TransferPages(true, &batch);
+}
+
+void FileDiskManager::ReadPages(std::vector<std::pair<page_id_t, char *>> pages) { TransferPages(false, &pages); }
+
+/**
+ * Hand the write to the I/O engine. The FSTREAM backend has no descriptor for the engine to use, so it writes
+ * synchronously and calls back before returning.
+ */
+void FileDiskManager::WritePageAsync(page_id_t page_id, const char *page_data, std::function<void()> callback) {
+  auto *engine = GetIOEngine();
+  if (engine == nullptr) {
+    WritePage(page_id, page_data);
+    callback();
+    return;
+  }
+  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
+  size_t file_offset;
+  int fd = Locate(page_id, &file_offset);
+  num_writes_ += 1;
+  std::shared_ptr<char> bounce;
+  if (direct_io_ && !IsDirectIOAligned(page_data)) {
+    bounce = AllocateBounceBuffer();
+    memcpy(bounce.get(), page_data, PAGE_SIZE);
+    page_data = bounce.get();
+  }
+  engine->Submit({true, fd, const_cast<char *>(page_data), PAGE_SIZE, file_offset,
+                  [this, page_id, page_data, offset, bounce, callback = std::move(callback)](ssize_t result) {
+                    if (result == -EINVAL && direct_io_) {
+                      DisableDirectIO();
+                      result = WriteDbPage(page_data, page_id) ? PAGE_SIZE : -1;
+                    }
+                    if (result != PAGE_SIZE) {
+                      LOG_DEBUG("I/O error while writing");
+                    } else {
+                      GrowFileSize(offset + PAGE_SIZE);
+                    }
+                    callback();
+                  }});
+}
+
+/**
+ * Hand the read to the I/O engine, or read synchronously on the FSTREAM backend
+ */
+void FileDiskManager::ReadPageAsync(page_id_t page_id, char *page_data, std::function<void()> callback) {
+  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
+  auto *engine = GetIOEngine();
+  if (engine == nullptr || offset > db_file_size_) {
+    ReadPage(page_id, page_data);
+    callback();
+    return;
+  }
+  std::shared_ptr<char> bounce;
+  if (direct_io_ && !IsDirectIOAligned(page_data)) {
+    bounce = AllocateBounceBuffer();
+  }
+  char *target = bounce ? bounce.get() : page_data;
+  size_t file_offset;
+  int fd = Locate(page_id, &file_offset);
+  engine->Submit({false, fd, target, PAGE_SIZE, file_offset,
+                  [this, page_id, page_data, target, bounce, callback = std::move(callback)](ssize_t result) {
+                    if (result == -EINVAL && direct_io_) {
+                      DisableDirectIO();
+                      result = ReadDbPage(target, page_id);
+                    }
+                    if (bounce && result > 0) {
+                      memcpy(page_data, target, result);
+                    }
+                    if (result < 0) {
+                      LOG_DEBUG("I/O error while reading");
+                    } else if (result < PAGE_SIZE) {
+                      LOG_DEBUG("Read less than a page");
+                      memset(page_data + result, 0, PAGE_SIZE - result);
+                    }
+                    callback();
+                  }});
+}
+
+IOEngine *FileDiskManager::GetIOEngine() {
+  if (backend_ == DiskIOBackend::FSTREAM) {
+    return nullptr;
+  }
+  std::call_once(io_engine_once_, [this] { io_engine_ = IOEngine::Create(); });
+  return io_engine_.get();
+}
+
+/**
+ * Flush the data of the db file to stable storage. The fstream backend has no descriptor of its own to sync, so it
+ * flushes the stream and syncs the file through a descriptor opened for the purpose.
+ */
+void FileDiskManager::Sync() {
+  if (backend_ != DiskIOBackend::FSTREAM) {
+    if (db_fd_ >= 0 && fdatasync(db_fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing");
+    }
+    segment_latch_.RLock();
+    for (size_t i = 1; i < segment_fds_.size(); i++) {
+      if (fdatasync(segment_fds_[i]) != 0) {
+        LOG_DEBUG("I/O error while syncing");
+      }
+    }
+    segment_latch_.RUnlock();
+    return;
+  }
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  db_io_.flush();
+  int fd = ::open(file_name_.c_str(), O_RDONLY);
+  if (fd < 0 || fdatasync(fd) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+/**
+ * Write the contents of the log into disk file
+ * Only return when sync is done, and only perform sequence write
+ */
+void FileDiskManager::WriteLog(char *log_data, int size) {
+  // enforce swap log buffer
+  assert(log_data != buffer_used);
+  buffer_used = log_data;
+
+  if (size == 0) {  // no effect on num_flushes_ if log buffer is empty
+    return;
+  }
+
+  flush_log_ = true;
+
+  if (flush_log_f_ != nullptr) {
+    // used for checking non-blocking flushing
+    assert(flush_log_f_->wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+  }
+
+  num_flushes_ += 1;
+  // sequence write, split where the log moves on to the next segment
+  size_t offset = log_size_.fetch_add(size);
+  for (size_t done = 0; done < static_cast<size_t>(size);) {
+    size_t segment_offset;
+    int fd = OpenLogSegment(offset + done, &segment_offset);
+    size_t piece = std::min(size - done, layout_.log_segment_size_ - segment_offset);
+    if (fd < 0 || !PwriteFully(fd, log_data + done, piece, segment_offset)) {
+      LOG_DEBUG("I/O error while writing log");
+      return;
+    }
+    // Callers rely on the log being durable once this returns, e.g. to acknowledge commits.
+    if (fdatasync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing log");
+    }
+    done += piece;
+  }
+  flush_log_ = false;
+}
+
+/**
+ * Reserve the next size bytes of the log file, write them through the I/O engine and sync them
+ */
+void FileDiskManager::WriteLogAsync(const char *log_data, int size, std::function<void()> callback) {
+  if (size == 0) {
+    callback();
+    return;
+  }
+  num_flushes_ += 1;
+  size_t offset = log_size_.fetch_add(size);
+  // One write per segment the data spans; the callback runs once the last of them completes and the segments are
+  // synced, so that the log is as durable then as after WriteLog.
+  std::vector<IORequest> requests;
+  auto fds = std::make_shared<std::vector<int>>();
+  for (size_t done = 0; done < static_cast<size_t>(size);) {
+    size_t segment_offset;
+    int fd = OpenLogSegment(offset + done, &segment_offset);
+    size_t piece = std::min(size - done, layout_.log_segment_size_ - segment_offset);
+    requests.push_back({true, fd, const_cast<char *>(log_data + done), piece, segment_offset, nullptr});
+    fds->push_back(fd);
+    done += piece;
+  }
+  auto sync = [fds] {
+    for (int fd : *fds) {
+      if (fd >= 0 && fdatasync(fd) != 0) {
+        LOG_DEBUG("I/O error while syncing log");
+      }
+    }
+  };
+  auto *engine = GetIOEngine();
+  if (engine == nullptr) {
+    for (const auto &request : requests) {
+      if (request.fd_ < 0 || !PwriteFully(request.fd_, request.data_, request.size_, request.offset_)) {
+        LOG_DEBUG("I/O error while writing log");
+      }
+    }
+    sync();
+    callback();
+    return;
+  }
+  auto pending = std::make_shared<std::atomic<size_t>>(requests.size());
+  auto shared_callback = std::make_shared<std::function<void()>>(std::move(callback));
+  for (auto &request : requests) {
+    request.callback_ = [size = request.size_, pending, sync, shared_callback](ssize_t result) {
+      if (result != static_cast<ssize_t>(size)) {
+        LOG_DEBUG("I/O error while writing log");
+      }
+      if (--*pending == 0) {
+        sync();
+        (*shared_callback)();
+      }
+    };
+    engine->Submit(std::move(request));
+  }
+}
+
+/**
+ * Read the contents of the log into the given memory area
+ * Always read from the beginning and perform sequence read
+ * @return: false means already reach the end
+ */
+bool FileDiskManager::ReadLog(char *log_data, int size, int64_t offset) {
+  if (offset < 0 || static_cast<size_t>(offset) >= log_size_) {
+    return false;
+  }
+  for (size_t done = 0; done < static_cast<size_t>(size);) {
+    size_t segment_offset;
+    int fd = OpenLogSegment(offset + done, &segment_offset, false);
+    size_t piece = std::min(size - done, layout_.log_segment_size_ - segment_offset);
+    if (fd < 0 && done == 0) {
+      LOG_DEBUG("log segment %s has been retired", GetLogSegmentName(offset).c_str());
+      return false;
+    }
+    ssize_t read_count = fd < 0 ? 0 : PreadFully(fd, log_data + done, piece, segment_offset);
+    if (read_count < 0) {
+      LOG_DEBUG("I/O error while reading log");
+      return false;
+    }
+    if (static_cast<size_t>(read_count) < piece) {
+      // if log file ends before reading "size"
+      memset(log_data + done + read_count, 0, size - done - read_count);
+      break;
+    }
+    done += piece;
+  }
+  return true;
+}
+
+/**
+ * Retire whole segments below lsn, oldest first. A segment that cannot be moved to the archive directory stays, and
+ * so does every segment after it, until the next call.
+ */
+size_t FileDiskManager::TruncateLog(lsn_t lsn) {
+  if (file_stem_.empty() || lsn <= 0) {
+    return 0;
+  }
+  const std::string &archive = layout_.log_archive_directory_;
+  if (!archive.empty() && mkdir(archive.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG_DEBUG("can't create log archive directory %s", archive.c_str());
+    return 0;
+  }
+  std::scoped_lock scoped_log_latch(log_latch_);
+  size_t retired = 0;
+  // Nothing writes below lsn any more, so the segments go away without waiting for anybody.
+  for (auto end = static_cast<size_t>(lsn) / layout_.log_segment_size_; log_first_segment_ < end;
+       log_first_segment_++) {
+    auto it = log_segment_fds_.find(log_first_segment_);
+    if (it != log_segment_fds_.end()) {
+      close(it->second);
+      log_segment_fds_.erase(it);
+    }
+    std::string name = GetLogSegmentName(log_first_segment_ * layout_.log_segment_size_);
+    if (archive.empty()) {
+      if (remove(name.c_str()) != 0 && errno != ENOENT) {
+        LOG_DEBUG("can't remove log segment %s", name.c_str());
+        break;
+      }
+    } else {
+      std::string::size_type slash = name.rfind('/');
+      std::string base = slash == std::string::npos ? name : name.substr(slash + 1);
+      if (rename(name.c_str(), (archive + "/" + base).c_str()) != 0 && errno != ENOENT) {
+        LOG_DEBUG("can't move log segment %s to %s", name.c_str(), archive.c_str());
+        break;
+      }
+    }
+    retired++;
+  }
+  return retired;
+}
+
+/**
+ * Write the manifest to a temporary file and rename it into place, so that a crash never leaves a torn manifest
+ * behind. Layout: magic number, page count, page ids.
+ */
+void FileDiskManager::WriteManifest(uint32_t instance_index, const std::vector<page_id_t> &page_ids) {
+  if (file_stem_.empty()) {
+    return;
+  }
+  std::string manifest_name = GetManifestName(instance_index);
+  std::string temp_name = manifest_name + ".tmp";
+  std::ofstream manifest(temp_name, std::ios::binary | std::ios::trunc);
+  auto count = static_cast<uint32_t>(page_ids.size());
+  manifest.write(reinterpret_cast<const char *>(&MANIFEST_MAGIC), sizeof(MANIFEST_MAGIC));
+  manifest.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  manifest.write(reinterpret_cast<const char *>(page_ids.data()), count * sizeof(page_id_t));
+  manifest.close();
+  if (manifest.fail()) {
+    LOG_DEBUG("I/O error while writing manifest");
+    remove(temp_name.c_str());
+    return;
+  }
+  rename(temp_name.c_str(), manifest_name.c_str());
+}
+
+/**
+ * Read a manifest back; a missing or malformed manifest reads as empty
+ */
+std::vector<page_id_t> FileDiskManager::ReadManifest(uint32_t instance_index) {
+  std::vector<page_id_t> page_ids;
+  if (file_stem_.empty()) {
+    return page_ids;
+  }
+  std::string manifest_name = GetManifestName(instance_index);
+  std::ifstream manifest(manifest_name, std::ios::binary);
+  uint32_t magic = 0;
+  uint32_t count = 0;
+  manifest.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  manifest.read(reinterpret_cast<char *>(&count), sizeof(count));
+  auto file_size = static_cast<size_t>(GetFileSize(manifest_name));
+  if (!manifest || magic != MANIFEST_MAGIC || count * sizeof(page_id_t) + sizeof(magic) + sizeof(count) != file_size) {
+    return page_ids;
+  }
+  page_ids.resize(count);
+  manifest.read(reinterpret_cast<char *>(page_ids.data()), count * sizeof(page_id_t));
+  if (!manifest) {
+    page_ids.clear();
+  }
+  return page_ids;
+}
+
+/**
+ * Like a manifest, the master record is written to a temporary file and renamed into place, but it is synced first:
+ * recovery must never find a master record that points past the durable log. Layout: magic number, LSN.
+ */
+void FileDiskManager::WriteMasterRecord(lsn_t lsn) {
+  if (file_stem_.empty()) {
+    DiskManager::WriteMasterRecord(lsn);
+    return;
+  }
+  std::string master_name = GetMasterRecordName();
+  std::string temp_name = master_name + ".tmp";
+  int fd = ::open(temp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG_DEBUG("can't open master record file");
+    return;
+  }
+  char data[sizeof(MASTER_RECORD_MAGIC) + sizeof(lsn)];
+  memcpy(data, &MASTER_RECORD_MAGIC, sizeof(MASTER_RECORD_MAGIC));
+  memcpy(data + sizeof(MASTER_RECORD_MAGIC), &lsn, sizeof(lsn));
+  bool written = write(fd, data, sizeof(data)) == static_cast<ssize_t>(sizeof(data)) && fsync(fd) == 0;
+  close(fd);
+  if (!written) {
+    LOG_DEBUG("I/O error while writing master record");
+    remove(temp_name.c_str());
+    return;
+  }
+  rename(temp_name.c_str(), master_name.c_str());
+}
+
+/**
+ * Read the master record back; a missing or malformed one reads as INVALID_LSN
+ */
+lsn_t FileDiskManager::ReadMasterRecord() {
+  if (file_stem_.empty()) {
+    return DiskManager::ReadMasterRecord();
+  }
+  std::ifstream master(GetMasterRecordName(), std::ios::binary);
+  uint32_t magic = 0;
+  lsn_t lsn = INVALID_LSN;
+  master.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  master.read(reinterpret_cast<char *>(&lsn), sizeof(lsn));
+  if (!master || magic != MASTER_RECORD_MAGIC) {
+    return INVALID_LSN;
+  }
+  return lsn;
+}
+
+/**
+ * Returns true if the log is currently being flushed
+ */
+bool FileDiskManager::GetFlushState() const { return flush_log_; }
+
+/**
+ * Private helper function to get the manifest file name of a buffer pool instance
+ */
+std::string FileDiskManager::GetManifestName(uint32_t instance_index) const {
+  return file_stem_ + "." + std::to_string(instance_index) + ".manifest";
+}
+
+/**
+ * The segment of an LSN is a division away, and its name is the LSN it starts at, so no index of the segments is kept
+ */
+std::string FileDiskManager::GetLogSegmentName(lsn_t lsn) const {
+  size_t segment = static_cast<size_t>(lsn) / layout_.log_segment_size_;
+  char start[17];
+  snprintf(start, sizeof(start), "%016zx", segment * layout_.log_segment_size_);
+  return file_stem_ + ".log." + start;
+}
+
+/**
+ * Private helper function to get the master record file name
+ */
+std::string FileDiskManager::GetMasterRecordName() const { return file_stem_ + ".master"; }
+
+/**
+ * Private helper function to open the free page map next to the database file. A database that predates its map
+ * has every page up to the end of its file treated as allocated.
+ */
+void FileDiskManager::OpenFreePageMap(bool fresh) {
+  if (file_stem_.empty()) {
+    return;
+  }
+  fsm_name_ = file_stem_ + ".fsm";
+  if (fresh) {
+    remove(fsm_name_.c_str());
+  }
+  fsm_io_.open(fsm_name_, std::ios::binary | std::ios::in | std::ios::out);
+  if (!fsm_io_.is_open()) {
+    fsm_io_.clear();
+    fsm_io_.open(fsm_name_, std::ios::binary | std::ios::trunc | std::ios::out);
+    fsm_io_.close();
+    fsm_io_.open(fsm_name_, std::ios::binary | std::ios::in | std::ios::out);
+    if (!fsm_io_.is_open()) {
+      throw Exception("can't open free page map file");
+    }
+  }
+  int64_t map_size = GetFileSize(fsm_name_);
+  if (map_size > 0) {
+    allocation_map_.resize((static_cast<size_t>(map_size) + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE);
+    fsm_io_.seekg(0);
+    fsm_io_.read(reinterpret_cast<char *>(allocation_map_.data()), map_size);
+    fsm_io_.clear();
+    return;
+  }
+  auto num_pages = static_cast<size_t>((db_file_size_ + PAGE_SIZE - 1) / PAGE_SIZE);
+  if (num_pages == 0) {
+    return;
+  }
+  // Build the map in memory and write it out once; a file of many gigabytes has a map of many pages.
+  allocation_map_.assign((num_pages / 8 / PAGE_SIZE + 1) * PAGE_SIZE, 0);
+  std::fill(allocation_map_.begin(), allocation_map_.begin() + num_pages / 8, 0xFF);
+  for (size_t page_id = num_pages / 8 * 8; page_id < num_pages; page_id++) {
+    allocation_map_[page_id / 8] |= 1U << (page_id % 8);
+  }
+  fsm_io_.seekp(0);
+  fsm_io_.write(reinterpret_cast<const char *>(allocation_map_.data()), allocation_map_.size());
+  fsm_io_.flush();
+}
+
+/**
+ * Write the map page holding the changed bit back to the free page map file. Caller must hold fsm_latch_.
+ */
+void FileDiskManager::OnFreePageMapChange(size_t map_page) {
+  if (!fsm_io_.is_open()) {
+    return;
+  }
+  fsm_io_.seekp(map_page * PAGE_SIZE);
+  fsm_io_.write(reinterpret_cast<const char *>(allocation_map_.data() + map_page * PAGE_SIZE), PAGE_SIZE);
+  if (fsm_io_.bad()) {
+    LOG_DEBUG("I/O error while writing free page map");
+    return;
+  }
+  fsm_io_.flush();
+}
+
+/**
+ * Private helper function to stop and join the compaction thread, if there is one
+ */
+void FileDiskManager::StopCompaction() {
+  {
+    std::scoped_lock scoped_fsm_latch(fsm_latch_);
+    compaction_stop_ = true;
+  }
+  compaction_cv_.notify_all();
+  if (compaction_thread_.joinable()) {
+    compaction_thread_.join();
+  }
+}
+
+/**
+ * Private helper function to pread a page of the db file, through the bounce buffer if O_DIRECT needs it
+ * @return the number of bytes read, or -1 on error
+ */
+ssize_t FileDiskManager::ReadDbPage(char *page_data, page_id_t page_id) {
+  size_t offset;
+  int fd = Locate(page_id, &offset);
+  if (direct_io_) {
+    bool aligned = IsDirectIOAligned(page_data);
+    ssize_t read_count = PreadFully(fd, aligned ? page_data : bounce_buffer, PAGE_SIZE, offset);
+    if (read_count >= 0 || errno != EINVAL) {
+      if (!aligned && read_count > 0) {
+        memcpy(page_data, bounce_buffer, read_count);
+      }
+      return read_count;
+    }
+    DisableDirectIO();
+  }
+  return PreadFully(fd, page_data, PAGE_SIZE, offset);
+}
+
+/**
+ * Private helper function to pwrite a page of the db file, through the bounce buffer if O_DIRECT needs it
+ */
+bool FileDiskManager::WriteDbPage(const char *page_data, page_id_t page_id) {
+  size_t offset;
+  int fd = Locate(page_id, &offset);
+  if (direct_io_) {
+    const char *data = page_data;
+    if (!IsDirectIOAligned(page_data)) {
+      memcpy(bounce_buffer, page_data, PAGE_SIZE);
+      data = bounce_buffer;
+    }
+    if (PwriteFully(fd, data, PAGE_SIZE, offset)) {
+      return true;
+    }
+    if (errno != EINVAL) {
+      return false;
+    }
+    DisableDirectIO();
+  }
+  return PwriteFully(fd, page_data, PAGE_SIZE, offset);
+}
+
+/**
+ * Private helper function behind ReadPages and WritePages: sort the batch, and hand every run of consecutive page ids
+ * of at most IOV_MAX pages within one segment to one preadv or pwritev. The FSTREAM backend, and O_DIRECT runs with a
+ * buffer that is not aligned, go a page at a time.
+ */
+void FileDiskManager::TransferPages(bool is_write, std::vector<std::pair<page_id_t, char *>> *pages) {
+  // Stable, so that of two writes of one page the later one still lands last.
+  std::stable_sort(pages->begin(), pages->end(),
+                   [](const auto &left, const auto &right) { return left.first < right.first; });
+  if (is_write) {
+    // Only the last write of a page matters; dropping the others keeps the runs unbroken.
+    auto last = std::unique(pages->rbegin(), pages->rend(),
+                            [](const auto &left, const auto &right) { return left.first == right.first; });
+    pages->erase(pages->begin(), last.base());
+  }
+  std::vector<struct iovec> iov;
+  for (size_t begin = 0; begin < pages->size();) {
+    size_t end = begin + 1;
+    bool aligned = IsDirectIOAligned((*pages)[begin].second);
+    while (end < pages->size() && end - begin < IOV_MAX && (*pages)[end].first == (*pages)[end - 1].first + 1 &&
+           (layout_.segment_pages_ == 0 || (*pages)[end].first % layout_.segment_pages_ != 0)) {
+      aligned = aligned && IsDirectIOAligned((*pages)[end].second);
+      end++;
+    }
+    auto first_page_id = (*pages)[begin].first;
+    size_t offset = static_cast<size_t>(first_page_id) * PAGE_SIZE;
+    size_t size = (end - begin) * PAGE_SIZE;
+
+    if (!is_write && offset >= db_file_size_) {
+      // Nothing to read, and no segment to open for it.
+      for (size_t i = begin; i < end; i++) {
+        memset((*pages)[i].second, 0, PAGE_SIZE);
+      }
+      begin = end;
+      continue;
+    }
+    if (backend_ == DiskIOBackend::FSTREAM || (direct_io_ && !aligned)) {
+      for (size_t i = begin; i < end; i++) {
+        if (is_write) {
+          WritePage((*pages)[i].first, (*pages)[i].second);
+        } else {
+          memset((*pages)[i].second, 0, PAGE_SIZE);
+          ReadPage((*pages)[i].first, (*pages)[i].second);
+        }
+      }
+      begin = end;
+      continue;
+    }
+
+    ssize_t done;
+    do {
+      iov.clear();
+      for (size_t i = begin; i < end; i++) {
+        iov.push_back({(*pages)[i].second, PAGE_SIZE});
+      }
+      size_t file_offset;
+      int fd = Locate(first_page_id, &file_offset);
+      done = TransferFully(fd, is_write, iov.data(), static_cast<int>(iov.size()), file_offset);
+    } while (done < 0 && errno == EINVAL && direct_io_ && (DisableDirectIO(), true));
+    if (is_write) {
+      num_writes_ += end - begin;
+      num_write_calls_ += 1;
+      if (done != static_cast<ssize_t>(size)) {
+        LOG_DEBUG("I/O error while writing");
+      } else {
+        GrowFileSize(offset + size);
+      }
+    } else if (done < 0) {
+      LOG_DEBUG("I/O error while reading");
+    } else if (static_cast<size_t>(done) < size) {
+      // The run reaches past the end of the file.
+      for (size_t i = begin; i < end; i++) {
+        size_t start = (i - begin) * PAGE_SIZE;
+        if (static_cast<size_t>(done) < start + PAGE_SIZE) {
+          size_t valid = static_cast<size_t>(done) > start ? done - start : 0;
+          memset((*pages)[i].second + valid, 0, PAGE_SIZE - valid);
+        }
+      }
+    }
+    begin = end;
+  }
+}
+
+/**
+ * Private helper function to go through the page cache after the filesystem rejected an O_DIRECT request
+ */
+void FileDiskManager::DisableDirectIO() {
+  if (!direct_io_.exchange(false)) {
+    return;
+  }
+  LOG_DEBUG("O_DIRECT rejected for %s, going through the page cache", file_name_.c_str());
+  auto clear = [](int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_DIRECT) != 0) {
+      LOG_DEBUG("failed to clear O_DIRECT");
+    }
+  };
+  clear(db_fd_);
+  segment_latch_.RLock();
+  for (size_t i = 1; i < segment_fds_.size(); i++) {
+    clear(segment_fds_[i]);
+  }
+  segment_latch_.RUnlock();
+}
+
+/**
+ * Private helper function to find where a page lives
+ * @param[out] offset offset of the page in its file
+ * @return the descriptor of the file holding the page, or -1 if its segment cannot be opened
+ */
+int FileDiskManager::Locate(page_id_t page_id, size_t *offset) {
+  if (layout_.segment_pages_ == 0) {
+    *offset = static_cast<size_t>(page_id) * PAGE_SIZE;
+    return db_fd_;
+  }
+  size_t segment = static_cast<size_t>(page_id) / layout_.segment_pages_;
+  *offset = static_cast<size_t>(page_id) % layout_.segment_pages_ * PAGE_SIZE;
+  if (segment == 0) {
+    return db_fd_;
+  }
+  segment_latch_.RLock();
+  int fd = segment < segment_fds_.size() ? segment_fds_[segment] : -1;
+  segment_latch_.RUnlock();
+  return fd >= 0 ? fd : OpenSegment(segment);
+}
+
+/**
+ * Private helper function to get the file name of a segment after the first
+ */
+std::string FileDiskManager::GetSegmentName(size_t segment) const {
+  std::string name = file_name_ + "." + std::to_string(segment);
+  if (layout_.directories_.empty()) {
+    return name;
+  }
+  std::string::size_type slash = name.rfind('/');
+  std::string base = slash == std::string::npos ? name : name.substr(slash + 1);
+  return layout_.directories_[(segment - 1) % layout_.directories_.size()] + "/" + base;
+}
+
+/**
+ * Private helper function to open a segment, creating it and every segment before it that does not exist yet
+ * @return the descriptor of the segment, or -1 on failure
+ */
+int FileDiskManager::OpenSegment(size_t segment) {
+  segment_latch_.WLock();
+  while (segment_fds_.size() <= segment) {
+    std::string name = GetSegmentName(segment_fds_.size());
+    int fd = -1;
+    if (direct_io_) {
+      fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    }
+    if (fd < 0) {
+      fd = ::open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    }
+    if (fd < 0) {
+      LOG_DEBUG("can't open db segment file %s", name.c_str());
+      break;
+    }
+    segment_fds_.push_back(fd);
+  }
+  int fd = segment < segment_fds_.size() ? segment_fds_[segment] : -1;
+  segment_latch_.WUnlock();
+  return fd;
+}
+
+/**
+ * Private helper function to find the log segment holding a byte of the log, opening it on first use
+ * @param offset position in the log
+ * @param[out] segment_offset position of the byte in the segment
+ * @param create whether to create the segment if it does not exist
+ * @return the descriptor of the segment, or -1 on failure
+ */
+int FileDiskManager::OpenLogSegment(size_t offset, size_t *segment_offset, bool create) {
+  size_t segment = offset / layout_.log_segment_size_;
+  *segment_offset = offset % layout_.log_segment_size_;
+  std::scoped_lock scoped_log_latch(log_latch_);
+  auto it = log_segment_fds_.find(segment);
+  if (it != log_segment_fds_.end()) {
+    return it->second;
+  }
+  if (file_stem_.empty() || segment < log_first_segment_) {
+    return -1;
+  }
+  std::string name = GetLogSegmentName(segment * layout_.log_segment_size_);
+  int fd = ::open(name.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+  if (fd < 0) {
+    if (create) {
+      LOG_DEBUG("can't open log segment file %s", name.c_str());
+    }
+    return -1;
+  }
+  log_segment_fds_[segment] = fd;
+  return fd;
+}
+
+/**
+ * Private helper function to find the log segments next to the database file. The log continues where the last
+ * segment ends, which is also where a LogManager created on this disk manager hands out its first LSN; on a fresh
+ * database, segments left behind by an earlier database of the same name are removed.
+ */
+void FileDiskManager::OpenLog(bool fresh) {
+  std::string::size_type slash = file_stem_.rfind('/');
+  std::string directory = slash == std::string::npos ? "." : file_stem_.substr(0, slash + 1);
+  std::string prefix = (slash == std::string::npos ? file_stem_ : file_stem_.substr(slash + 1)) + ".log.";
+  DIR *dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    throw Exception("can't open dblog directory");
+  }
+  std::vector<size_t> starts;
+  while (struct dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name.size() == prefix.size() + 16 && name.compare(0, prefix.size(), prefix) == 0 &&
+        name.find_first_not_of("0123456789abcdef", prefix.size()) == std::string::npos) {
+      starts.push_back(std::stoull(name.substr(prefix.size()), nullptr, 16));
+    }
+  }
+  closedir(dir);
+  if (fresh) {
+    for (size_t start : starts) {
+      remove(GetLogSegmentName(start).c_str());
+    }
+    return;
+  }
+  if (starts.empty()) {
+    return;
+  }
+  auto [first, last] = std::minmax_element(starts.begin(), starts.end());
+  log_first_segment_ = *first / layout_.log_segment_size_;
+  log_size_ = *last + std::max<int64_t>(GetFileSize(GetLogSegmentName(*last)), 0);
+}
+
+/**
+ * Private helper function to cut the db file, or each of its segments, back to the first num_pages pages
+ */
+bool FileDiskManager::TruncatePages(size_t num_pages) {
+  if (layout_.segment_pages_ == 0) {
+    return ftruncate(db_fd_, static_cast<off_t>(num_pages * PAGE_SIZE)) == 0;
+  }
+  bool ok = true;
+  segment_latch_.RLock();
+  for (size_t i = 0; i < segment_fds_.size(); i++) {
+    size_t first_page = i * layout_.segment_pages_;
+    size_t keep = num_pages > first_page ? std::min(num_pages - first_page, layout_.segment_pages_) : 0;
+    struct stat stat_buf;
+    // Segments are only ever shortened; growing one would fill it with zeroes that were never written.
+    if (fstat(segment_fds_[i], &stat_buf) == 0 && static_cast<size_t>(stat_buf.st_size) > keep * PAGE_SIZE &&
+        ftruncate(segment_fds_[i], static_cast<off_t>(keep * PAGE_SIZE)) != 0) {
+      ok = false;
+    }
+  }
+  segment_latch_.RUnlock();
+  return ok;
+}
+
+/**
+ * Private helper function to raise the in-memory file size after a write that may have extended the file
+ */
+void FileDiskManager::GrowFileSize(size_t size) {
+  size_t current = db_file_size_.load();
+  while (current < size && !db_file_size_.compare_exchange_weak(current, size)) {
+  }
+}
+
+/**
+ * Private helper function to get disk file size
+ */
+int64_t FileDiskManager::GetFileSize(const std::string &file_name) {
+  struct stat stat_buf;
+  int rc = stat(file_name.c_str(), &stat_buf);
+  return rc == 0 ? static_cast<int64_t>(stat_buf.st_size) : -1;
+}
+
+}  // namespace bustub
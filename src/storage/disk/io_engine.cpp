@@ -0,0 +1,302 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// io_engine.cpp
+//
+// Identification: src/storage/disk/io_engine.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/io_engine.h"
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "common/config.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+/** user_data of the poll on the wakeup eventfd; every request has the (non-null) address of its InFlight instead. */
+static constexpr uint64_t WAKEUP_USER_DATA = 0;
+
+std::unique_ptr<IOEngine> IOEngine::Create() {
+  if (enable_io_uring) {
+    auto engine = IoUringIOEngine::Create(ASYNC_IO_QUEUE_DEPTH);
+    if (engine != nullptr) {
+      return engine;
+    }
+    LOG_DEBUG("io_uring unavailable, falling back to a thread pool");
+  }
+  return std::make_unique<ThreadPoolIOEngine>(ASYNC_IO_THREADS);
+}
+
+/*****************************************************************************
+ * THREAD POOL
+ *****************************************************************************/
+
+ThreadPoolIOEngine::ThreadPoolIOEngine(size_t num_threads) {
+  for (size_t i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&ThreadPoolIOEngine::Run, this);
+  }
+}
+
+ThreadPoolIOEngine::~ThreadPoolIOEngine() {
+  {
+    std::scoped_lock latch(latch_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPoolIOEngine::Submit(IORequest request) {
+  {
+    std::scoped_lock latch(latch_);
+    queue_.push_back(std::move(request));
+  }
+  cv_.notify_one();
+}
+
+void ThreadPoolIOEngine::Run() {
+  std::unique_lock latch(latch_);
+  while (true) {
+    cv_.wait(latch, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    IORequest request = std::move(queue_.front());
+    queue_.pop_front();
+    latch.unlock();
+
+    size_t done = 0;
+    ssize_t result = 0;
+    while (done < request.size_) {
+      auto offset = static_cast<off_t>(request.offset_ + done);
+      ssize_t rc = request.is_write_ ? pwrite(request.fd_, request.data_ + done, request.size_ - done, offset)
+                                     : pread(request.fd_, request.data_ + done, request.size_ - done, offset);
+      num_submit_calls_++;
+      if (rc < 0 && errno == EINTR) {
+        continue;
+      }
+      if (rc < 0) {
+        result = -errno;
+        break;
+      }
+      if (rc == 0) {
+        break;
+      }
+      done += rc;
+    }
+    request.callback_(result < 0 ? result : static_cast<ssize_t>(done));
+    latch.lock();
+  }
+}
+
+/*****************************************************************************
+ * IO_URING
+ *****************************************************************************/
+
+struct IoUringIOEngine::InFlight {
+  IORequest request_;
+  struct iovec iov_;
+};
+
+std::unique_ptr<IoUringIOEngine> IoUringIOEngine::Create(unsigned queue_depth) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  auto ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+  if (ring_fd < 0) {
+    return nullptr;
+  }
+  std::unique_ptr<IoUringIOEngine> engine(new IoUringIOEngine());
+  engine->ring_fd_ = ring_fd;
+  engine->event_fd_ = eventfd(0, EFD_CLOEXEC);
+  if (engine->event_fd_ < 0 || !engine->MapRings(params)) {
+    return nullptr;
+  }
+  engine->thread_ = std::thread(&IoUringIOEngine::Run, engine.get());
+  return engine;
+}
+
+IoUringIOEngine::~IoUringIOEngine() {
+  {
+    std::scoped_lock latch(latch_);
+    stop_ = true;
+  }
+  if (thread_.joinable()) {
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof(one)) < 0) {
+      LOG_DEBUG("failed to wake up the io_uring thread");
+    }
+    thread_.join();
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+  }
+  close(ring_fd_);
+}
+
+bool IoUringIOEngine::MapRings(const io_uring_params &params) {
+  sq_entries_ = params.sq_entries;
+  cq_entries_ = params.cq_entries;
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  void *sq_ring =
+      mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return false;
+  }
+  sq_ring_ = sq_ring;
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    void *cq_ring =
+        mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return false;
+    }
+    cq_ring_ = cq_ring;
+  }
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = sqes;
+
+  auto *sq = static_cast<char *>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  auto *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+  return true;
+}
+
+void IoUringIOEngine::Submit(IORequest request) {
+  {
+    std::scoped_lock latch(latch_);
+    queue_.push_back(std::move(request));
+  }
+  uint64_t one = 1;
+  if (write(event_fd_, &one, sizeof(one)) < 0) {
+    LOG_DEBUG("failed to wake up the io_uring thread");
+  }
+}
+
+void IoUringIOEngine::PushSqe(uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t offset,
+                              uint64_t user_data, uint32_t poll_events) {
+  unsigned tail = *sq_tail_;
+  unsigned index = tail & *sq_mask_;
+  auto *sqe = static_cast<struct io_uring_sqe *>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = addr;
+  sqe->len = len;
+  sqe->off = offset;
+  sqe->user_data = user_data;
+  sqe->poll32_events = poll_events;
+  sq_array_[index] = index;
+  // The kernel may read the SQE as soon as it sees the new tail.
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  to_submit_++;
+}
+
+void IoUringIOEngine::Run() {
+  size_t in_flight = 0;
+  bool wakeup_armed = false;
+  while (true) {
+    if (!wakeup_armed) {
+      PushSqe(IORING_OP_POLL_ADD, event_fd_, 0, 0, 0, WAKEUP_USER_DATA, POLLIN);
+      wakeup_armed = true;
+    }
+    {
+      std::scoped_lock latch(latch_);
+      if (stop_ && queue_.empty() && in_flight == 0) {
+        return;
+      }
+      // Take everything queued since the last round, as far as the rings have room. One completion queue entry is
+      // left for the wakeup poll.
+      while (!queue_.empty() && in_flight + 1 < cq_entries_ &&
+             *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) < sq_entries_) {
+        auto *op = new InFlight{std::move(queue_.front()), {}};
+        queue_.pop_front();
+        op->iov_.iov_base = op->request_.data_;
+        op->iov_.iov_len = op->request_.size_;
+        PushSqe(op->request_.is_write_ ? IORING_OP_WRITEV : IORING_OP_READV, op->request_.fd_,
+                reinterpret_cast<uint64_t>(&op->iov_), 1, op->request_.offset_, reinterpret_cast<uint64_t>(op));
+        in_flight++;
+      }
+    }
+
+    // Submit the new SQEs and wait for at least one completion, be it a request or the wakeup poll.
+    auto rc = syscall(__NR_io_uring_enter, ring_fd_, to_submit_, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    num_submit_calls_++;
+    if (rc < 0) {
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        LOG_ERROR("io_uring_enter failed: %s", strerror(errno));
+      }
+    } else {
+      to_submit_ -= static_cast<unsigned>(rc);
+    }
+
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      auto *cqe = static_cast<struct io_uring_cqe *>(cqes_) + (head & *cq_mask_);
+      if (cqe->user_data == WAKEUP_USER_DATA) {
+        uint64_t count;
+        if (read(event_fd_, &count, sizeof(count)) < 0) {
+          LOG_DEBUG("failed to reset the io_uring wakeup eventfd");
+        }
+        wakeup_armed = false;
+        continue;
+      }
+      auto *op = reinterpret_cast<InFlight *>(cqe->user_data);
+      ssize_t result = cqe->res;
+      in_flight--;
+      if (result == -EAGAIN || result == -EINTR) {
+        std::scoped_lock latch(latch_);
+        queue_.push_front(std::move(op->request_));
+      } else {
+        op->request_.callback_(result);
+      }
+      delete op;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+}
+
+}  // namespace bustub
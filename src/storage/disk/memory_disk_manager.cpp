@@ -0,0 +1,94 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// memory_disk_manager.cpp
+//
+// Identification: src/storage/disk/memory_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/memory_disk_manager.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace bustub {
+
+void MemoryDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  std::scoped_lock latch(latch_);
+  auto index = static_cast<size_t>(page_id);
+  if (index >= pages_.size()) {
+    pages_.resize(index + 1);
+  }
+  if (pages_[index] == nullptr) {
+    pages_[index] = std::make_unique<PageData>();
+  }
+  memcpy(pages_[index]->data(), page_data, PAGE_SIZE);
+  num_writes_ += 1;
+  num_write_calls_ += 1;
+}
+
+void MemoryDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  std::scoped_lock latch(latch_);
+  auto index = static_cast<size_t>(page_id);
+  if (index >= pages_.size() || pages_[index] == nullptr) {
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  memcpy(page_data, pages_[index]->data(), PAGE_SIZE);
+}
+
+void MemoryDiskManager::WriteLog(char *log_data, int size) {
+  if (size == 0) {
+    return;
+  }
+  std::scoped_lock latch(latch_);
+  log_.insert(log_.end(), log_data, log_data + size);
+  num_flushes_ += 1;
+}
+
+bool MemoryDiskManager::ReadLog(char *log_data, int size, int64_t offset) {
+  std::scoped_lock latch(latch_);
+  if (offset < static_cast<int64_t>(log_begin_) || static_cast<size_t>(offset) >= log_begin_ + log_.size()) {
+    return false;
+  }
+  size_t begin = offset - log_begin_;
+  size_t read_count = std::min(static_cast<size_t>(size), log_.size() - begin);
+  memcpy(log_data, log_.data() + begin, read_count);
+  memset(log_data + read_count, 0, size - read_count);
+  return true;
+}
+
+void MemoryDiskManager::WriteLogAsync(const char *log_data, int size, std::function<void()> callback) {
+  if (size != 0) {
+    std::scoped_lock latch(latch_);
+    log_.insert(log_.end(), log_data, log_data + size);
+    num_flushes_ += 1;
+  }
+  callback();
+}
+
+size_t MemoryDiskManager::TruncateLog(lsn_t lsn) {
+  std::scoped_lock latch(latch_);
+  if (lsn <= 0) {
+    return 0;
+  }
+  size_t begin = std::min(static_cast<size_t>(lsn), log_begin_ + log_.size()) / LOG_SEGMENT_SIZE * LOG_SEGMENT_SIZE;
+  if (begin <= log_begin_) {
+    return 0;
+  }
+  size_t retired = (begin - log_begin_) / LOG_SEGMENT_SIZE;
+  log_.erase(log_.begin(), log_.begin() + (begin - log_begin_));
+  log_begin_ = begin;
+  return retired;
+}
+
+size_t MemoryDiskManager::GetLogSize() {
+  std::scoped_lock latch(latch_);
+  return log_begin_ + log_.size();
+}
+
+}  // namespace bustub
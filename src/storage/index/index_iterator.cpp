@@ -2,29 +2,82 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <utility>
 
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
 
-/*
- * NOTE: you can change the destructor/constructor method here
- * set your own input parameters
- */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::IndexIterator() = default;
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::~IndexIterator() = default;
+INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *buffer_pool_manager, page_id_t leaf_page_id, int index)
+    : buffer_pool_manager_(buffer_pool_manager),
+      index_(index),
+      prefetcher_(buffer_pool_manager, AccessHint::SEQUENTIAL_SCAN, &IndexIterator::NextLeafPageId) {
+  MoveTo(leaf_page_id);
+  SkipExhaustedLeaves();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
+    : buffer_pool_manager_(other.buffer_pool_manager_),
+      leaf_(other.leaf_),
+      index_(other.index_),
+      prefetcher_(std::move(other.prefetcher_)) {
+  other.leaf_ = nullptr;
+  other.index_ = 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() { MoveTo(INVALID_PAGE_ID); }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::IsEnd() { return leaf_ == nullptr; }
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &INDEXITERATOR_TYPE::operator*() {
+  assert(!IsEnd());
+  return leaf_->GetItem(index_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  assert(!IsEnd());
+  index_++;
+  SkipExhaustedLeaves();
+  return *this;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-bool INDEXITERATOR_TYPE::IsEnd() { throw std::runtime_error("unimplemented"); }
+void INDEXITERATOR_TYPE::SkipExhaustedLeaves() {
+  while (leaf_ != nullptr && index_ >= leaf_->GetSize()) {
+    MoveTo(leaf_->GetNextPageId());
+    index_ = 0;
+  }
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &INDEXITERATOR_TYPE::operator*() { throw std::runtime_error("unimplemented"); }
+void INDEXITERATOR_TYPE::MoveTo(page_id_t page_id) {
+  LeafPage *next = nullptr;
+  if (page_id != INVALID_PAGE_ID) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id, AccessHint::SEQUENTIAL_SCAN);
+    assert(page != nullptr);
+    next = reinterpret_cast<LeafPage *>(page->GetData());
+    // Read the leaves after this one while the entries of this one are being consumed.
+    prefetcher_.MoveTo(page_id, next->GetNextPageId());
+  }
+  if (leaf_ != nullptr) {
+    buffer_pool_manager_->UnpinPage(leaf_->GetPageId(), false);
+  }
+  leaf_ = next;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() { throw std::runtime_error("unimplemented"); }
+page_id_t INDEXITERATOR_TYPE::NextLeafPageId(Page *page) {
+  return reinterpret_cast<LeafPage *>(page->GetData())->GetNextPageId();
+}
 
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
@@ -11,11 +11,19 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <mutex>  // NOLINT
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
+#include "storage/disk/fault_injecting_disk_manager.h"
+#include "storage/disk/file_disk_manager.h"
+#include "storage/disk/memory_disk_manager.h"
 
 namespace bustub {
 
@@ -29,7 +37,7 @@ TEST(BufferPoolManagerInstanceTest, BinaryDataTest) {
   std::default_random_engine rng(r());
   std::uniform_int_distribution<char> uniform_dist(0);
 
-  auto *disk_manager = new DiskManager(db_name);
+  auto *disk_manager = new FileDiskManager(db_name);
   auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
 
   page_id_t page_id_temp;
@@ -90,7 +98,7 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 10;
 
-  auto *disk_manager = new DiskManager(db_name);
+  auto *disk_manager = new FileDiskManager(db_name);
   auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
 
   page_id_t page_id_temp;
@@ -141,4 +149,985 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ScanResistanceTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_hot_pages = 10;
+  const size_t num_table_pages = 100;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // A table that is much larger than the buffer pool, loaded with a bulk write.
+  std::vector<page_id_t> table_pages;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < num_table_pages; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp, AccessHint::BULK_WRITE);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "table %zu", i);
+    table_pages.push_back(page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Hot pages are persisted, then marked in memory only: the mark survives exactly as long as the page stays resident.
+  std::vector<page_id_t> hot_pages;
+  for (size_t i = 0; i < num_hot_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    hot_pages.push_back(page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+    EXPECT_EQ(true, bpm->FlushPage(page_id_temp));
+  }
+  auto mark_hot_pages = [&] {
+    for (auto hot_page_id : hot_pages) {
+      auto *page = bpm->FetchPage(hot_page_id);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "resident");
+      EXPECT_EQ(true, bpm->UnpinPage(hot_page_id, false));
+    }
+  };
+  auto count_resident_hot_pages = [&] {
+    size_t resident = 0;
+    for (auto hot_page_id : hot_pages) {
+      auto *page = bpm->FetchPage(hot_page_id);
+      EXPECT_NE(nullptr, page);
+      resident += strcmp(page->GetData(), "resident") == 0 ? 1 : 0;
+      EXPECT_EQ(true, bpm->UnpinPage(hot_page_id, false));
+    }
+    return resident;
+  };
+  auto scan_table = [&](AccessHint hint) {
+    for (size_t i = 0; i < num_table_pages; ++i) {
+      auto *page = bpm->FetchPage(table_pages[i], hint);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(0, strcmp(page->GetData(), ("table " + std::to_string(i)).c_str()));
+      EXPECT_EQ(true, bpm->UnpinPage(table_pages[i], false));
+    }
+  };
+
+  // Scenario: a sequential scan of the whole table recycles its own frames and leaves the hot pages alone.
+  mark_hot_pages();
+  scan_table(AccessHint::SEQUENTIAL_SCAN);
+  EXPECT_EQ(num_hot_pages, count_resident_hot_pages());
+
+  // Scenario: the same scan without the hint flushes the hot pages out of the pool.
+  mark_hot_pages();
+  scan_table(AccessHint::NORMAL);
+  EXPECT_EQ(0, count_resident_hot_pages());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+TEST(BufferPoolManagerInstanceTest, FrameLayoutTest) {
+  const std::string db_name = "test.db";
+  // Large enough for the frame arena to ask for huge pages.
+  const size_t buffer_pool_size = 1024;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Frame data is page aligned and contiguous; the book-keeping of neighbouring frames never shares a cache line.
+  static_assert(alignof(Page) == 64);
+  for (frame_id_t i = 0; i < static_cast<frame_id_t>(buffer_pool_size); ++i) {
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(bpm->GetFrame(i)->GetData()) % PAGE_SIZE);
+    EXPECT_EQ(bpm->GetFrame(0)->GetData() + i * PAGE_SIZE, bpm->GetFrame(i)->GetData());
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(bpm->GetFrame(i)) % 64);
+  }
+
+  // Every frame is usable and starts out zeroed.
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, page->GetData()[PAGE_SIZE - 1]);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+  }
+  for (frame_id_t i = 0; i < static_cast<frame_id_t>(buffer_pool_size); ++i) {
+    Page *page = bpm->GetFrame(i);
+    EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page->GetPageId())).c_str()));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+TEST(BufferPoolManagerInstanceTest, DirtyUnpinIsAbsorbedTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  // Keep the page cleaner out of the way: only eviction and explicit flushes write.
+  bpm->SetCleanerDirtyTarget(1.0);
+
+  page_id_t page_id;
+  auto *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  for (int i = 0; i < 10; ++i) {
+    snprintf(page->GetData(), PAGE_SIZE, "update %d", i);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_TRUE(page->IsDirty());
+  }
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+
+  // Ten updates cost no writes so far; the first one dirtied the page and the other nine were absorbed.
+  EXPECT_EQ(0, disk_manager->GetNumWrites());
+  EXPECT_EQ(9, bpm->GetAbsorbedWriteCount());
+  EXPECT_EQ(1, bpm->GetDirtyPageCount());
+
+  EXPECT_EQ(true, bpm->FlushPage(page_id));
+  EXPECT_EQ(1, disk_manager->GetNumWrites());
+  EXPECT_EQ(0, bpm->GetDirtyPageCount());
+  char data[PAGE_SIZE];
+  disk_manager->ReadPage(page_id, data);
+  EXPECT_EQ(0, strcmp(data, "update 9"));
+
+  // A dirty page is written back once when it is evicted.
+  page = bpm->FetchPage(page_id);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), PAGE_SIZE, "evicted");
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  }
+  EXPECT_EQ(1, bpm->GetEvictionWriteCount());
+  disk_manager->ReadPage(page_id, data);
+  EXPECT_EQ(0, strcmp(data, "evicted"));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+/** Wait up to a second for the condition to hold. */
+template <typename Condition>
+static bool WaitFor(Condition &&condition) {
+  for (int i = 0; i < 1000 && !condition(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return condition();
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PageCleanerTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 20;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, log_manager);
+  bpm->SetCleanerDirtyTarget(1.0);
+  bpm->SetCleanerBatchSize(4);
+
+  // Scenario: dirty the whole pool, then lower the target to a quarter of it. The cleaner writes pages back until only
+  // a quarter is dirty, without anyone unpinning or evicting anything.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+  EXPECT_EQ(buffer_pool_size, bpm->GetDirtyPageCount());
+  bpm->SetCleanerDirtyTarget(0.25);
+  ASSERT_TRUE(WaitFor([&] {
+    return bpm->GetDirtyPageCount() <= buffer_pool_size / 4 &&
+           bpm->GetDirtyPageCount() + bpm->GetCleanerWriteCount() == buffer_pool_size;
+  }));
+  EXPECT_EQ(bpm->GetCleanerWriteCount(), disk_manager->GetNumWrites());
+  EXPECT_EQ(0, bpm->GetEvictionWriteCount());
+
+  // Pages are cleaned in page id order, and what reached the disk is what was in memory.
+  char data[PAGE_SIZE];
+  for (size_t i = 0; i < bpm->GetCleanerWriteCount(); ++i) {
+    auto *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_FALSE(page->IsDirty());
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+    disk_manager->ReadPage(page_ids[i], data);
+    EXPECT_EQ(0, strcmp(data, ("page " + std::to_string(page_ids[i])).c_str()));
+  }
+
+  // Scenario: with logging on, a page whose last change is not in the persistent log yet stays dirty.
+  bpm->SetCleanerDirtyTarget(1.0);
+  bpm->FlushAllPages();
+  enable_logging = true;
+  auto *page = bpm->FetchPage(page_ids[0]);
+  ASSERT_NE(nullptr, page);
+  page->SetLSN(5);
+  EXPECT_EQ(true, bpm->UnpinPage(page_ids[0], true));
+  bpm->SetCleanerDirtyTarget(0);
+  std::this_thread::sleep_for(page_cleaner_interval * 5);
+  EXPECT_EQ(1, bpm->GetDirtyPageCount());
+  log_manager->SetPersistentLSN(5);
+  EXPECT_TRUE(WaitFor([&] { return bpm->GetDirtyPageCount() == 0; }));
+  enable_logging = false;
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, CleanerPinDoesNotFailEvictionTest) {
+  const size_t buffer_pool_size = 2;
+
+  auto *disk_manager = new MemoryDiskManager();
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->SetCleanerDirtyTarget(1.0);
+
+  // Scenario: one frame stays pinned, and the page in the other frame is dirty and unpinned, but still write latched.
+  page_id_t pinned_page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&pinned_page_id));
+  page_id_t page_id;
+  auto *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  page->WLatch();
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+
+  // The page cleaner pins the page and waits for its read latch, which is released a little later.
+  bpm->SetCleanerDirtyTarget(0);
+  ASSERT_TRUE(WaitFor([&] { return page->GetPinCount() == 1; }));
+  std::thread unlatcher([page] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    page->WUnlatch();
+  });
+
+  // The replacer offers the frame while the cleaner holds it. A new page waits for the write-back instead of failing.
+  page_id_t page_id_temp;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  unlatcher.join();
+  EXPECT_TRUE(WaitFor([&] { return bpm->GetCleanerWriteCount() == 1; }));
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  EXPECT_EQ(true, bpm->UnpinPage(pinned_page_id, false));
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, EvictionFlushesLogTest) {
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new MemoryDiskManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, log_manager);
+  // Keep the page cleaner out of the way: it never writes a page whose log is not durable.
+  bpm->SetCleanerDirtyTarget(1.0);
+  enable_logging = true;
+
+  // Scenario: a page whose last change is only in the log buffer is evicted. The log must reach the disk first.
+  page_id_t page_id;
+  auto *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  LogRecord log_record(0, INVALID_LSN, LogRecordType::BEGIN);
+  lsn_t lsn = log_manager->AppendLogRecord(&log_record);
+  page->SetLSN(lsn);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  EXPECT_LT(log_manager->GetPersistentLSN(), lsn);
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  }
+  EXPECT_EQ(1, bpm->GetEvictionWriteCount());
+  EXPECT_GE(log_manager->GetPersistentLSN(), lsn);
+
+  // Scenario: the same holds for an explicit flush.
+  page = bpm->FetchPage(page_id);
+  ASSERT_NE(nullptr, page);
+  lsn = log_manager->AppendLogRecord(&log_record);
+  page->SetLSN(lsn);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  EXPECT_LT(log_manager->GetPersistentLSN(), lsn);
+  EXPECT_EQ(true, bpm->FlushPage(page_id));
+  EXPECT_GE(log_manager->GetPersistentLSN(), lsn);
+  enable_logging = false;
+
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_pages = 2 * buffer_pool_size;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  std::vector<page_id_t> page_ids;
+  {
+    BufferPoolManagerInstance bpm(buffer_pool_size, disk_manager);
+    page_id_t page_id_temp;
+    for (size_t i = 0; i < num_pages; ++i) {
+      auto *page = bpm.NewPage(&page_id_temp);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+      page_ids.push_back(page_id_temp);
+      EXPECT_EQ(true, bpm.UnpinPage(page_id_temp, true));
+    }
+    bpm.FlushAllPages();
+  }
+
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  auto fetch_pages = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto *page = bpm->FetchPage(page_ids[i]);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(1, page->GetPinCount());
+      EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page_ids[i])).c_str()));
+      EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+    }
+  };
+
+  // Scenario: prefetched pages are read in the background into unpinned frames and fetching them is a hit.
+  bpm->PrefetchPages(std::vector<page_id_t>(page_ids.begin(), page_ids.begin() + 8));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  fetch_pages(0, 8);
+  EXPECT_EQ(8, bpm->GetPrefetchHitCount());
+  EXPECT_EQ(0, bpm->GetPrefetchMissCount());
+
+  // Scenario: fetching a page again, or fetching a page that was never prefetched, is not a prefetch hit.
+  fetch_pages(0, buffer_pool_size);
+  EXPECT_EQ(8, bpm->GetPrefetchHitCount());
+
+  // Scenario: prefetched pages are evicted like any unpinned page; nobody fetched this one, so it was wasted.
+  bpm->PrefetchPages({page_ids[num_pages - 1]});
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  fetch_pages(0, num_pages - 1);
+  EXPECT_EQ(8, bpm->GetPrefetchHitCount());
+  EXPECT_EQ(1, bpm->GetPrefetchWasteCount());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, WarmRestartTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_pages = 3 * buffer_pool_size;
+
+  enable_warm_restart = true;
+
+  std::vector<page_id_t> page_ids;
+  {
+    auto *disk_manager = new FileDiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+    page_id_t page_id_temp;
+    for (size_t i = 0; i < num_pages; ++i) {
+      auto *page = bpm->NewPage(&page_id_temp);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+      page_ids.push_back(page_id_temp);
+      EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+    }
+    bpm->FlushAllPages();
+    // The hot set is the first pool's worth of pages, the most recently used last.
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_ids[i]));
+      EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+      std::this_thread::sleep_for(std::chrono::microseconds(10));
+    }
+    disk_manager->ShutDown();
+    delete bpm;
+    delete disk_manager;
+  }
+
+  auto restart = [&](size_t pool_size) {
+    auto *disk_manager = new FileDiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // Fetch the most recently used pages that fit, in the order they were used, and count how many were resident.
+    for (size_t i = buffer_pool_size - pool_size; i < buffer_pool_size; ++i) {
+      auto *page = bpm->FetchPage(page_ids[i]);
+      EXPECT_NE(nullptr, page);
+      if (page != nullptr) {
+        EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page_ids[i])).c_str()));
+        EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+      }
+    }
+    size_t hits = bpm->GetPrefetchHitCount();
+    disk_manager->ShutDown();
+    delete bpm;
+    delete disk_manager;
+    return hits;
+  };
+
+  // Scenario: a new pool on the same database reads the hot set back in before it is asked for.
+  EXPECT_EQ(buffer_pool_size, restart(buffer_pool_size));
+
+  // Scenario: a smaller pool reads back the most recently used pages that fit.
+  EXPECT_EQ(buffer_pool_size / 2, restart(buffer_pool_size / 2));
+
+  // Scenario: with warm restart off the pool starts cold.
+  enable_warm_restart = false;
+  EXPECT_EQ(0, restart(buffer_pool_size));
+
+  remove("test.db");
+  remove("test.0.manifest");
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_pages = 2 * buffer_pool_size;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+  // Scenario: growing the pool hands out the new frames while every old one is still pinned.
+  bpm->Resize(num_pages);
+  EXPECT_EQ(num_pages, bpm->GetPoolSize());
+  for (size_t i = buffer_pool_size; i < num_pages; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+  // Scenario: shrinking the pool waits for pinned pages in the retired frames to be unpinned.
+  const size_t small_pool_size = 4;
+  std::atomic<bool> resized = false;
+  std::thread resizer([&] {
+    bpm->Resize(small_pool_size);
+    resized = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(resized);
+  for (auto page_id : page_ids) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  resizer.join();
+  EXPECT_EQ(small_pool_size, bpm->GetPoolSize());
+
+  // Scenario: the shrunk pool holds no more than its new size, and the evicted pages were written back.
+  std::vector<Page *> pinned;
+  for (size_t i = 0; i < small_pool_size; ++i) {
+    pinned.push_back(bpm->FetchPage(page_ids[i]));
+    ASSERT_NE(nullptr, pinned.back());
+  }
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_ids[small_pool_size]));
+  for (size_t i = 0; i < small_pool_size; ++i) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+  }
+  for (auto page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page_id)).c_str()));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t num_pages = 64;
+  const size_t num_threads = 4;
+
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::LRU_K, ReplacerType::CLOCK}) {
+    auto *disk_manager = new FileDiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(num_pages, disk_manager, nullptr, replacer_type);
+    std::vector<page_id_t> page_ids;
+    page_id_t page_id_temp;
+    for (size_t i = 0; i < num_pages; ++i) {
+      auto *page = bpm->NewPage(&page_id_temp);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+      page_ids.push_back(page_id_temp);
+      EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+    }
+
+    // Readers keep fetching random pages while the pool grows and shrinks underneath them. Each reader pins one page
+    // at a time, so a pool of twice as many frames always has an unpinned one.
+    std::atomic<bool> done = false;
+    std::atomic<size_t> failures = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&, t] {
+        std::mt19937 rng(t);
+        std::uniform_int_distribution<size_t> pick(0, num_pages - 1);
+        while (!done) {
+          page_id_t page_id = page_ids[pick(rng)];
+          auto *page = bpm->FetchPage(page_id);
+          if (page == nullptr || strcmp(page->GetData(), ("page " + std::to_string(page_id)).c_str()) != 0) {
+            failures++;
+          }
+          if (page != nullptr) {
+            bpm->UnpinPage(page_id, rng() % 4 == 0);
+          }
+        }
+      });
+    }
+    for (size_t pool_size : std::vector<size_t>{16, 128, 2 * num_threads, 2048, 32, 2 * num_threads, 64}) {
+      bpm->Resize(pool_size);
+      EXPECT_EQ(pool_size, bpm->GetPoolSize());
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    done = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(0, failures);
+
+    disk_manager->ShutDown();
+    remove("test.db");
+
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ResizeDuringCleanerTest) {
+  const size_t num_pages = 64;
+  const size_t num_threads = 4;
+
+  auto *disk_manager = new MemoryDiskManager();
+  auto *bpm = new BufferPoolManagerInstance(num_pages, disk_manager);
+  bpm->SetCleanerBatchSize(4);
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < num_pages; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Writers keep dirtying pages for the page cleaner and peekers keep taking transient pins, while shrinks retire the
+  // frames their pins were just released from.
+  bpm->SetCleanerDirtyTarget(0);
+  std::atomic<bool> done = false;
+  std::atomic<size_t> failures = 0;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 rng(t);
+      std::uniform_int_distribution<size_t> pick(0, num_pages - 1);
+      while (!done) {
+        page_id_t page_id = page_ids[pick(rng)];
+        std::string expected = "page " + std::to_string(page_id);
+        if (t % 2 == 0) {
+          auto *page = bpm->FetchPage(page_id);
+          if (page == nullptr || strcmp(page->GetData(), expected.c_str()) != 0) {
+            failures++;
+          }
+          if (page != nullptr) {
+            bpm->UnpinPage(page_id, true);
+          }
+        } else {
+          bpm->ReadResidentPage(page_id, [&](Page *page) {
+            if (strcmp(page->GetData(), expected.c_str()) != 0) {
+              failures++;
+            }
+          });
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 200; i++) {
+    for (size_t pool_size : {2 * num_threads, num_pages, 3 * num_threads, 4 * num_pages}) {
+      bpm->Resize(pool_size);
+      EXPECT_EQ(pool_size, bpm->GetPoolSize());
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  done = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, failures);
+  EXPECT_GT(bpm->GetCleanerWriteCount(), 0);
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, StatsTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  // Leave every write-back to eviction.
+  bpm->SetCleanerDirtyTarget(1);
+
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    page_ids.push_back(page_id_temp);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  for (auto page_id : page_ids) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  for (auto page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  // Every new page evicts one of the dirty pages above.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  EXPECT_EQ(true, bpm->UnpinPage(page_ids[0], false));
+
+  auto stats = bpm->GetStats();
+  EXPECT_EQ(buffer_pool_size, stats.fetch_hits_);
+  EXPECT_EQ(1, stats.fetch_misses_);
+  EXPECT_DOUBLE_EQ(0.8, stats.HitRatio());
+  EXPECT_EQ(buffer_pool_size + 1, stats.evictions_);
+  EXPECT_EQ(buffer_pool_size, stats.eviction_writes_);
+  EXPECT_EQ(0, stats.cleaner_writes_);
+  EXPECT_EQ(1, stats.new_page_failures_);
+  EXPECT_EQ(buffer_pool_size, stats.pinned_frames_high_water_);
+  EXPECT_EQ(1, stats.miss_latency_.Count());
+  EXPECT_GT(stats.miss_latency_.Percentile(0.5), 0);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, InjectedLatencyTest) {
+  const size_t buffer_pool_size = 4;
+
+  // Pages live in memory, and every read takes at least 2 ms.
+  MemoryDiskManager memory;
+  InjectedFaults faults;
+  faults.read_latency_ = {LatencyDistribution::FIXED, std::chrono::microseconds(2000), std::chrono::microseconds(0)};
+  FaultInjectingDiskManager disk_manager(&memory, faults);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, &disk_manager);
+
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+  // The first pages were evicted to memory and come back through the slow reads.
+  char expected[PAGE_SIZE];
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    auto *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+    EXPECT_STREQ(expected, page->GetData());
+    EXPECT_EQ(true, bpm->UnpinPage(page_ids[i], false));
+  }
+  auto stats = bpm->GetStats();
+  EXPECT_EQ(buffer_pool_size, stats.miss_latency_.Count());
+  EXPECT_LE(2000000, stats.miss_latency_.Percentile(0.5));
+
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchReadsOutsideLatchTest) {
+  const size_t buffer_pool_size = 16;
+  const size_t num_prefetched = 8;
+
+  // Pages live in memory, and every read takes 20 ms on the thread that issues it.
+  MemoryDiskManager memory;
+  InjectedFaults faults;
+  faults.read_latency_ = {LatencyDistribution::FIXED, std::chrono::microseconds(20000), std::chrono::microseconds(0)};
+  FaultInjectingDiskManager disk_manager(&memory, faults);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, &disk_manager);
+  bpm->SetCleanerDirtyTarget(1.0);
+
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    auto *page = bpm->NewPage(&page_id_temp);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+    page_ids.push_back(page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+
+  // Scenario: while a prefetch batch is reading evicted pages in, misses, new pages and deletes do not wait for it.
+  bpm->PrefetchPages(std::vector<page_id_t>(page_ids.begin(), page_ids.begin() + num_prefetched));
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  auto start = std::chrono::steady_clock::now();
+  auto *page = bpm->NewPage(&page_id_temp);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  EXPECT_TRUE(bpm->DeletePage(page_ids[num_prefetched - 2]));
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  // Well under the time the batch's reads take together.
+  EXPECT_LT(elapsed.count(), 20 * static_cast<int64_t>(num_prefetched) / 2);
+
+  // Scenario: fetching a page that is still being prefetched waits for that read instead of reading it again.
+  page = bpm->FetchPage(page_ids[num_prefetched - 1]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_STREQ(("page " + std::to_string(page_ids[num_prefetched - 1])).c_str(), page->GetData());
+  EXPECT_EQ(true, bpm->UnpinPage(page_ids[num_prefetched - 1], false));
+  EXPECT_EQ(1, bpm->GetPrefetchHitCount());
+
+  // Scenario: the page deleted while it was read is not published.
+  EXPECT_FALSE(bpm->ReadResidentPage(page_ids[num_prefetched - 2], [](Page *page) {}));
+
+  delete bpm;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DeletedPageReuseTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  for (page_id_t page_id = 0; page_id < 4; page_id++) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    EXPECT_EQ(page_id, page_id_temp);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(1));
+  EXPECT_EQ(false, bpm->DeletePage(1));
+  EXPECT_EQ(true, bpm->UnpinPage(1, false));
+  EXPECT_EQ(true, bpm->DeletePage(1));
+  EXPECT_EQ(true, bpm->FlushPage(2));
+  EXPECT_EQ(true, bpm->DeletePage(2));
+
+  // Deleted pages are handed out again instead of growing the database, and come back zeroed.
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(1, page_id_temp);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  auto *page = bpm->NewPage(&page_id_temp);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(2, page_id_temp);
+  EXPECT_EQ(0, page->GetData()[0]);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(4, page_id_temp);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+
+  // A deleted page that a prefetch read back in is still handed out again; the stale frame is dropped.
+  EXPECT_EQ(true, bpm->FlushPage(3));
+  EXPECT_EQ(true, bpm->DeletePage(3));
+  bpm->PrefetchPages({3});
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  page = bpm->NewPage(&page_id_temp);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(3, page_id_temp);
+  EXPECT_EQ(0, page->GetData()[0]);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+  delete bpm;
+
+  // Allocation survives a new buffer pool on the same database.
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_EQ(5, page_id_temp);
+  EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentFetchUnpinTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 16;
+  const size_t num_pages = 48;
+  const size_t num_threads = 4;
+  const size_t num_accesses = 5000;
+
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::LRU_K, ReplacerType::CLOCK}) {
+    auto *disk_manager = new FileDiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, replacer_type);
+
+    std::vector<page_id_t> page_ids;
+    page_id_t page_id_temp;
+    for (size_t i = 0; i < num_pages; ++i) {
+      auto *page = bpm->NewPage(&page_id_temp);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id_temp);
+      page_ids.push_back(page_id_temp);
+      EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, true));
+    }
+
+    // Every thread mixes hits and misses, point accesses and scans, so eviction keeps racing the latch-free hit path.
+    std::vector<std::thread> threads;
+    for (size_t tid = 0; tid < num_threads; ++tid) {
+      threads.emplace_back([&, tid] {
+        std::mt19937 rng(tid);
+        std::uniform_int_distribution<size_t> pick(0, tid % 2 == 0 ? buffer_pool_size / 2 : num_pages - 1);
+        for (size_t i = 0; i < num_accesses; ++i) {
+          page_id_t page_id = page_ids[pick(rng)];
+          auto hint = i % 7 == 0 ? AccessHint::SEQUENTIAL_SCAN : AccessHint::NORMAL;
+          auto *page = bpm->FetchPage(page_id, hint);
+          if (page == nullptr) {
+            continue;
+          }
+          EXPECT_EQ(page_id, page->GetPageId());
+          EXPECT_EQ(0, strcmp(page->GetData(), ("page " + std::to_string(page_id)).c_str()));
+          EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    // Nothing is left pinned and every frame can still be reused.
+    for (auto page_id : page_ids) {
+      auto *page = bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(1, page->GetPinCount());
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+    }
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    }
+    EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+
+    disk_manager->ShutDown();
+    remove("test.db");
+
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+/**
+ * Runs num_threads threads that each fetch and unpin random resident pages for the given duration.
+ * @param global_latch if not nullptr, every call is serialized on it, like the buffer pool used to do internally
+ * @return the number of FetchPage/UnpinPage pairs completed per second
+ */
+static double MeasureHitThroughput(BufferPoolManager *bpm, const std::vector<page_id_t> &page_ids, size_t num_threads,
+                                   std::mutex *global_latch) {
+  const auto duration = std::chrono::milliseconds(200);
+  std::atomic<size_t> total_ops = 0;
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid] {
+      std::mt19937 rng(tid);
+      std::uniform_int_distribution<size_t> pick(0, page_ids.size() - 1);
+      size_t ops = 0;
+      auto deadline = std::chrono::steady_clock::now() + duration;
+      while (std::chrono::steady_clock::now() < deadline) {
+        for (int i = 0; i < 64; ++i) {
+          page_id_t page_id = page_ids[pick(rng)];
+          if (global_latch != nullptr) {
+            std::scoped_lock latch(*global_latch);
+            bpm->FetchPage(page_id);
+          } else {
+            bpm->FetchPage(page_id);
+          }
+          if (global_latch != nullptr) {
+            std::scoped_lock latch(*global_latch);
+            bpm->UnpinPage(page_id, false);
+          } else {
+            bpm->UnpinPage(page_id, false);
+          }
+        }
+        ops += 64;
+      }
+      total_ops += ops;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return static_cast<double>(total_ops) / std::chrono::duration<double>(duration).count();
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ReadMostlyThroughputTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 256;
+
+  // The default replacer first, then CLOCK.
+  for (auto replacer_type : {ReplacerType::LRU, ReplacerType::CLOCK}) {
+    auto *disk_manager = new FileDiskManager(db_name);
+    auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, replacer_type);
+    std::vector<page_id_t> page_ids;
+    page_id_t page_id_temp;
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+      page_ids.push_back(page_id_temp);
+      EXPECT_EQ(true, bpm->UnpinPage(page_id_temp, false));
+    }
+
+    // Every access hits. The global latch emulates the old design, where every call took the instance latch.
+    std::mutex global_latch;
+    for (size_t num_threads : {1, 2, 4, 8}) {
+      double serialized = MeasureHitThroughput(bpm, page_ids, num_threads, &global_latch);
+      double sharded = MeasureHitThroughput(bpm, page_ids, num_threads, nullptr);
+      printf("%s, %zu threads: %.0f hits/s with a global latch, %.0f hits/s with a sharded page table\n",
+             replacer_type == ReplacerType::LRU ? "LRU" : "CLOCK", num_threads, serialized, sharded);
+    }
+    for (auto page_id : page_ids) {
+      auto *page = bpm->FetchPage(page_id);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(1, page->GetPinCount());
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+    }
+    // Every frame is evictable again.
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    }
+
+    disk_manager->ShutDown();
+    remove("test.db");
+
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
 }  // namespace bustub
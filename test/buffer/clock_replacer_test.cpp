@@ -10,16 +10,20 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <random>
+#include <set>
 #include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -59,4 +63,112 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(ClockReplacerTest, GClockTest) {
+  ClockReplacer clock_replacer(3, 3);
+
+  // Frame 0 goes through three pin/unpin cycles, frames 1 and 2 through one. Unpinning an evictable frame again does
+  // not count as another use.
+  for (int i = 0; i < 3; i++) {
+    clock_replacer.Pin(0);
+    clock_replacer.Unpin(0);
+    clock_replacer.Unpin(0);
+  }
+  clock_replacer.Unpin(1);
+  clock_replacer.Unpin(2);
+  EXPECT_EQ(3, clock_replacer.Size());
+
+  // The frames with the lower usage count drain first.
+  int value;
+  clock_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  clock_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+  EXPECT_FALSE(clock_replacer.Victim(&value));
+}
+
+// NOLINTNEXTLINE
+TEST(ClockReplacerTest, ConcurrentPinUnpinTest) {
+  const size_t num_threads = 8;
+  const size_t frames_per_thread = 64;
+  const size_t num_rounds = 10000;
+  ClockReplacer clock_replacer(num_threads * frames_per_thread);
+
+  // Every thread churns its own frames and finishes with all of them unpinned.
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&clock_replacer, tid, frames_per_thread, num_rounds] {
+      std::mt19937 rng(tid);
+      for (size_t round = 0; round < num_rounds; round++) {
+        auto frame_id = static_cast<frame_id_t>(tid * frames_per_thread + rng() % frames_per_thread);
+        clock_replacer.Pin(frame_id);
+        clock_replacer.Unpin(frame_id);
+      }
+      for (size_t i = 0; i < frames_per_thread; i++) {
+        clock_replacer.Unpin(static_cast<frame_id_t>(tid * frames_per_thread + i));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * frames_per_thread, clock_replacer.Size());
+
+  // Every frame is victimized exactly once.
+  std::set<frame_id_t> victims;
+  frame_id_t value;
+  while (clock_replacer.Victim(&value)) {
+    EXPECT_TRUE(victims.insert(value).second);
+  }
+  EXPECT_EQ(num_threads * frames_per_thread, victims.size());
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+/**
+ * Runs num_threads threads that pin and unpin random frames for a fixed number of rounds, with one thread in eight
+ * also asking for victims, and returns the achieved throughput in operations per microsecond.
+ */
+static double MeasurePinUnpinThroughput(Replacer *replacer, size_t num_frames, size_t num_threads) {
+  const size_t num_rounds = 200000;
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([replacer, num_frames, tid, num_rounds] {
+      std::mt19937 rng(tid);
+      for (size_t round = 0; round < num_rounds; round++) {
+        auto frame_id = static_cast<frame_id_t>(rng() % num_frames);
+        replacer->Pin(frame_id);
+        replacer->Unpin(frame_id);
+        if (tid % 8 == 0 && round % 64 == 0) {
+          frame_id_t victim;
+          if (replacer->Victim(&victim)) {
+            replacer->Unpin(victim);
+          }
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  return static_cast<double>(num_threads * num_rounds * 2) / static_cast<double>(std::max<int64_t>(elapsed.count(), 1));
+}
+
+// NOLINTNEXTLINE
+TEST(ClockReplacerTest, PinUnpinThroughputTest) {
+  const size_t num_frames = 1024;
+  for (size_t num_threads : {1, 2, 4, 8}) {
+    ClockReplacer clock_replacer(num_frames);
+    LRUKReplacer lru_k_replacer(num_frames);
+    double clock_throughput = MeasurePinUnpinThroughput(&clock_replacer, num_frames, num_threads);
+    double lru_k_throughput = MeasurePinUnpinThroughput(&lru_k_replacer, num_frames, num_threads);
+    printf("%zu threads: CLOCK %.2f Mops/s, LRU-K %.2f Mops/s\n", num_threads, clock_throughput, lru_k_throughput);
+    // Every frame was last unpinned, so every frame must still be evictable.
+    EXPECT_EQ(num_frames, clock_replacer.Size());
+    EXPECT_EQ(num_frames, lru_k_replacer.Size());
+  }
+}
+
 }  // namespace bustub
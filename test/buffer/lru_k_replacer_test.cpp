@@ -0,0 +1,259 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: unpin six elements, i.e. add them to the replacer.
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Unpin(5);
+  lru_k_replacer.Unpin(6);
+  lru_k_replacer.Unpin(1);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: get three victims. Every frame has been accessed once, so they leave in the order they arrived.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+
+  // Scenario: pin elements in the replacer.
+  // Note that 3 has already been victimized, so pinning 3 only records an access.
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Pin(4);
+  EXPECT_EQ(2, lru_k_replacer.Size());
+
+  // Scenario: unpin 4. It has now been accessed twice, so it is evicted after every frame accessed only once.
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, HotFramesSurviveScanTest) {
+  LRUKReplacer lru_k_replacer(8, 2);
+
+  // Frames 0 and 1 are hot: they have been accessed twice.
+  for (frame_id_t frame_id : {0, 1}) {
+    lru_k_replacer.Pin(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+    lru_k_replacer.Pin(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+  }
+  // Frames 2..7 are touched once by a scan, after the hot frames were last used.
+  for (frame_id_t frame_id = 2; frame_id < 8; frame_id++) {
+    lru_k_replacer.Pin(frame_id);
+    lru_k_replacer.Unpin(frame_id);
+  }
+  EXPECT_EQ(8, lru_k_replacer.Size());
+
+  // Every scanned frame goes before either hot frame, even though the hot frames are older.
+  frame_id_t value;
+  for (frame_id_t frame_id = 2; frame_id < 8; frame_id++) {
+    ASSERT_TRUE(lru_k_replacer.Victim(&value));
+    EXPECT_EQ(frame_id, value);
+  }
+  // Among hot frames, the one whose k-th most recent access is oldest goes first: a single extra access of
+  // frame 0 would leave its second most recent access older than frame 1's, so it is accessed twice.
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Unpin(0);
+  lru_k_replacer.Pin(1);
+  lru_k_replacer.Unpin(1);
+  lru_k_replacer.Pin(0);
+  lru_k_replacer.Unpin(0);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(0, value);
+
+  // Removing a frame forgets its history: it comes back as a cold frame.
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Remove(3);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.Pin(4);
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Pin(4);
+  lru_k_replacer.Unpin(4);
+  ASSERT_TRUE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(3, value);
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, RandomOperationsTest) {
+  const size_t num_frames = 32;
+  const size_t k = 3;
+  LRUKReplacer lru_k_replacer(num_frames, k);
+
+  // A model that keeps every access and picks victims by scanning all frames.
+  std::vector<std::vector<uint64_t>> history(num_frames);
+  std::vector<bool> evictable(num_frames, false);
+  uint64_t now = 0;
+  auto model_victim = [&]() {
+    frame_id_t victim = INVALID_PAGE_ID;
+    std::pair<bool, uint64_t> best;
+    for (size_t i = 0; i < num_frames; i++) {
+      if (!evictable[i]) {
+        continue;
+      }
+      const auto &accesses = history[i];
+      std::pair<bool, uint64_t> key{accesses.size() >= k, accesses[accesses.size() - std::min(k, accesses.size())]};
+      if (victim == INVALID_PAGE_ID || key < best) {
+        victim = static_cast<frame_id_t>(i);
+        best = key;
+      }
+    }
+    return victim;
+  };
+
+  std::mt19937 rng(0);
+  for (int i = 0; i < 100000; i++) {
+    auto frame_id = static_cast<frame_id_t>(rng() % num_frames);
+    switch (rng() % 8) {
+      case 0:
+      case 1:
+      case 2:
+        lru_k_replacer.Pin(frame_id);
+        evictable[frame_id] = false;
+        history[frame_id].push_back(now++);
+        break;
+      case 3:
+      case 4:
+      case 5:
+        lru_k_replacer.Unpin(frame_id);
+        if (history[frame_id].empty()) {
+          history[frame_id].push_back(now++);
+        }
+        evictable[frame_id] = true;
+        break;
+      case 6: {
+        frame_id_t expected = model_victim();
+        frame_id_t value;
+        ASSERT_EQ(expected != INVALID_PAGE_ID, lru_k_replacer.Victim(&value));
+        if (expected != INVALID_PAGE_ID) {
+          ASSERT_EQ(expected, value);
+          evictable[value] = false;
+          history[value].clear();
+        }
+        break;
+      }
+      default:
+        lru_k_replacer.Remove(frame_id);
+        evictable[frame_id] = false;
+        history[frame_id].clear();
+        break;
+    }
+    ASSERT_EQ(std::count(evictable.begin(), evictable.end(), true), lru_k_replacer.Size());
+  }
+}
+
+/**
+ * Replays a page access trace against a replacer managing pool_size frames.
+ * @return the fraction of accesses that found their page already resident
+ */
+static double ReplayTrace(Replacer *replacer, size_t pool_size, const std::vector<page_id_t> &trace) {
+  std::unordered_map<page_id_t, frame_id_t> page_table;
+  std::vector<page_id_t> frame_to_page(pool_size, INVALID_PAGE_ID);
+  frame_id_t next_free_frame = 0;
+  size_t hits = 0;
+  for (auto page_id : trace) {
+    frame_id_t frame_id;
+    auto iter = page_table.find(page_id);
+    if (iter != page_table.end()) {
+      hits++;
+      frame_id = iter->second;
+    } else {
+      if (static_cast<size_t>(next_free_frame) < pool_size) {
+        frame_id = next_free_frame++;
+      } else {
+        EXPECT_TRUE(replacer->Victim(&frame_id));
+        page_table.erase(frame_to_page[frame_id]);
+      }
+      page_table[page_id] = frame_id;
+      frame_to_page[frame_id] = page_id;
+    }
+    replacer->Pin(frame_id);
+    replacer->Unpin(frame_id);
+  }
+  return static_cast<double>(hits) / static_cast<double>(trace.size());
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, ZipfHitRatioTest) {
+  const size_t pool_size = 64;
+  const page_id_t num_hot_pages = 1024;
+  const size_t num_accesses = 200000;
+  const size_t scan_interval = 5000;
+  const page_id_t scan_length = 256;
+  const double skew = 0.99;
+
+  // Zipf(skew) over the hot pages, sampled through its cumulative distribution.
+  std::vector<double> cdf(num_hot_pages);
+  double sum = 0;
+  for (page_id_t i = 0; i < num_hot_pages; i++) {
+    sum += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+    cdf[i] = sum;
+  }
+  std::mt19937 rng(15445);
+  std::uniform_real_distribution<double> uniform(0, sum);
+
+  // Point lookups follow the Zipf distribution; every scan_interval accesses a sequential scan reads scan_length
+  // pages that are never touched again.
+  std::vector<page_id_t> trace;
+  trace.reserve(num_accesses + num_accesses / scan_interval * scan_length);
+  page_id_t next_scan_page = num_hot_pages;
+  for (size_t i = 0; i < num_accesses; i++) {
+    if (i > 0 && i % scan_interval == 0) {
+      for (page_id_t j = 0; j < scan_length; j++) {
+        trace.push_back(next_scan_page++);
+      }
+    }
+    auto rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+    trace.push_back(static_cast<page_id_t>(std::min<ptrdiff_t>(rank, num_hot_pages - 1)));
+  }
+
+  LRUReplacer lru_replacer(pool_size);
+  LRUKReplacer lru_k_replacer(pool_size, 2);
+  double lru_hit_ratio = ReplayTrace(&lru_replacer, pool_size, trace);
+  double lru_k_hit_ratio = ReplayTrace(&lru_k_replacer, pool_size, trace);
+  printf("zipf(%.2f) trace of %zu accesses, %zu frames: LRU hit ratio %.4f, LRU-2 hit ratio %.4f\n", skew,
+         trace.size(), pool_size, lru_hit_ratio, lru_k_hit_ratio);
+
+  EXPECT_GT(lru_k_hit_ratio, lru_hit_ratio);
+}
+
+}  // namespace bustub
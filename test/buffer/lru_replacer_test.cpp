@@ -59,4 +59,37 @@ TEST(LRUReplacerTest, SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(LRUReplacerTest, PinLeavesStaleEntriesTest) {
+  LRUReplacer lru_replacer(4);
+  for (frame_id_t frame_id = 0; frame_id < 4; frame_id++) {
+    lru_replacer.Unpin(frame_id);
+  }
+
+  // Pinned frames stay in the list but are no longer counted, and victims skip them.
+  lru_replacer.Pin(0);
+  lru_replacer.Pin(2);
+  EXPECT_EQ(2, lru_replacer.Size());
+  int value;
+  ASSERT_TRUE(lru_replacer.Victim(&value));
+  EXPECT_EQ(1, value);
+
+  // Unpinning a frame with a stale entry makes it the most recently used.
+  lru_replacer.Unpin(0);
+  ASSERT_TRUE(lru_replacer.Victim(&value));
+  EXPECT_EQ(3, value);
+  ASSERT_TRUE(lru_replacer.Victim(&value));
+  EXPECT_EQ(0, value);
+  EXPECT_FALSE(lru_replacer.Victim(&value));
+
+  // Removed frames are gone until they are unpinned again, and the replacer grows with the buffer pool.
+  lru_replacer.Resize(6);
+  lru_replacer.Unpin(5);
+  lru_replacer.Unpin(2);
+  lru_replacer.Remove(5);
+  EXPECT_EQ(1, lru_replacer.Size());
+  ASSERT_TRUE(lru_replacer.Victim(&value));
+  EXPECT_EQ(2, value);
+  EXPECT_EQ(0, lru_replacer.Size());
+}
+
 }  // namespace bustub
@@ -11,17 +11,25 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <deque>
+#include <mutex>  // NOLINT
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
+#include "storage/disk/file_disk_manager.h"
 
 namespace bustub {
 
 // NOLINTNEXTLINE
 // Check whether pages containing terminal characters can be recovered
-TEST(ParallelBufferPoolManagerTest, DISABLED_BinaryDataTest) {
+TEST(ParallelBufferPoolManagerTest, BinaryDataTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 10;
   const size_t num_instances = 5;
@@ -30,7 +38,7 @@ TEST(ParallelBufferPoolManagerTest, DISABLED_BinaryDataTest) {
   std::default_random_engine rng(r());
   std::uniform_int_distribution<char> uniform_dist(0);
 
-  auto *disk_manager = new DiskManager(db_name);
+  auto *disk_manager = new FileDiskManager(db_name);
   auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
 
   page_id_t page_id_temp;
@@ -88,12 +96,12 @@ TEST(ParallelBufferPoolManagerTest, DISABLED_BinaryDataTest) {
 }
 
 // NOLINTNEXTLINE
-TEST(ParallelBufferPoolManagerTest, DISABLED_SampleTest) {
+TEST(ParallelBufferPoolManagerTest, SampleTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 10;
   const size_t num_instances = 5;
 
-  auto *disk_manager = new DiskManager(db_name);
+  auto *disk_manager = new FileDiskManager(db_name);
   auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
 
   page_id_t page_id_temp;
@@ -151,4 +159,141 @@ TEST(ParallelBufferPoolManagerTest, DISABLED_SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, StatsTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const size_t num_instances = 3;
+
+  auto *disk_manager = new FileDiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  // Fill every instance, then fetch every page once more: the counters of all instances add up.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id_temp;
+  for (size_t i = 0; i < buffer_pool_size * num_instances; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+    page_ids.push_back(page_id_temp);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  for (auto page_id : page_ids) {
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  auto stats = bpm->GetStats();
+  EXPECT_EQ(buffer_pool_size * num_instances, stats.fetch_hits_);
+  EXPECT_EQ(0, stats.fetch_misses_);
+  EXPECT_EQ(0, stats.evictions_);
+  // The failed NewPage tried every instance.
+  EXPECT_EQ(num_instances, stats.new_page_failures_);
+  EXPECT_EQ(buffer_pool_size * num_instances, stats.pinned_frames_high_water_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+/**
+ * Create pages from several threads at once, each keeping its most recent pages pinned.
+ * @param[out] failures number of NewPage calls that returned nullptr
+ * @return the 99th percentile latency of NewPage, in microseconds
+ */
+static double MeasureNewPageLatency(BufferPoolManager *bpm, size_t num_threads, size_t num_new_pages, size_t window,
+                                    size_t *failures) {
+  std::atomic<size_t> total_failures = 0;
+  std::mutex latencies_latch;
+  std::vector<double> latencies;
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&] {
+      std::vector<double> thread_latencies;
+      std::deque<page_id_t> pinned;
+      page_id_t page_id;
+      for (size_t i = 0; i < num_new_pages; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        auto *page = bpm->NewPage(&page_id);
+        thread_latencies.push_back(
+            std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        if (page == nullptr) {
+          total_failures++;
+        } else {
+          snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+          pinned.push_back(page_id);
+        }
+        while (pinned.size() > window || (i + 1 == num_new_pages && !pinned.empty())) {
+          bpm->UnpinPage(pinned.front(), true);
+          pinned.pop_front();
+        }
+      }
+      std::scoped_lock latch(latencies_latch);
+      latencies.insert(latencies.end(), thread_latencies.begin(), thread_latencies.end());
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  *failures = total_failures;
+  std::sort(latencies.begin(), latencies.end());
+  return latencies[latencies.size() * 99 / 100];
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, SkewedPinningTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 32;
+  const size_t num_instances = 4;
+  const size_t num_threads = 4;
+  const size_t num_new_pages = 500;
+  const size_t window = 4;
+
+  // Per policy, round-robin first: NewPage calls that returned nullptr, and NewPage calls of an instance that failed.
+  size_t failures[2];
+  size_t failed_attempts[2];
+  for (bool load_aware : {false, true}) {
+    auto *disk_manager = new FileDiskManager(db_name);
+    auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+    bpm->SetLoadAwareAllocation(load_aware);
+
+    // Long-running readers pin every frame of every instance except the last, whose frames are all free.
+    std::vector<page_id_t> page_ids;
+    page_id_t page_id_temp;
+    for (size_t i = 0; i < buffer_pool_size * num_instances; ++i) {
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id_temp));
+      page_ids.push_back(page_id_temp);
+    }
+    for (auto page_id : page_ids) {
+      if (page_id % num_instances == num_instances - 1) {
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+        EXPECT_EQ(true, bpm->DeletePage(page_id));
+      }
+    }
+    size_t failed_before = bpm->GetStats().new_page_failures_;
+
+    // Round-robin starts most calls at a busy instance and only gets a page once it has tried its way around to the
+    // free one; load-aware allocation goes to the free instance first.
+    double p99 = MeasureNewPageLatency(bpm, num_threads, num_new_pages, window, &failures[load_aware]);
+    failed_attempts[load_aware] = bpm->GetStats().new_page_failures_ - failed_before;
+    printf("%s allocation under skewed pinning: %zu of %zu NewPage calls failed, %zu failed on a busy instance first, "
+           "p99 latency %.1f us\n",
+           load_aware ? "load-aware" : "round-robin", failures[load_aware], num_threads * num_new_pages,
+           failed_attempts[load_aware], p99);
+
+    disk_manager->ShutDown();
+    remove("test.db");
+
+    delete bpm;
+    delete disk_manager;
+  }
+
+  // Both policies fall back to every instance, so neither returns nullptr while the free instance has room.
+  EXPECT_EQ(0, failures[0]);
+  EXPECT_EQ(0, failures[1]);
+  EXPECT_GE(failed_attempts[0], num_threads * num_new_pages);
+  EXPECT_LT(failed_attempts[1], failed_attempts[0]);
+}
+
 }  // namespace bustub
@@ -0,0 +1,70 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// latency_histogram_test.cpp
+//
+// Identification: test/common/latency_histogram_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "common/latency_histogram.h"
+#include "common/striped_counter.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(LatencyHistogramTest, BucketTest) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.GetSnapshot().Percentile(0.99));
+
+  // 0 and 1ns share the first bucket; every other duration lands in the bucket of its highest bit.
+  histogram.Record(std::chrono::nanoseconds(0));
+  histogram.Record(std::chrono::nanoseconds(1));
+  histogram.Record(std::chrono::nanoseconds(1000));
+  histogram.Record(std::chrono::nanoseconds(1023));
+  histogram.Record(std::chrono::hours(1000));
+  auto snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(5, snapshot.Count());
+  EXPECT_EQ(2, snapshot.buckets_[0]);
+  EXPECT_EQ(2, snapshot.buckets_[9]);
+  EXPECT_EQ(1, snapshot.buckets_[LatencyHistogram::NUM_BUCKETS - 1]);
+
+  // Percentiles report the upper bound of the bucket they fall in.
+  EXPECT_EQ(1, snapshot.Percentile(0.2));
+  EXPECT_EQ(1023, snapshot.Percentile(0.6));
+  EXPECT_EQ(1023, snapshot.Percentile(0.8));
+
+  snapshot += snapshot;
+  EXPECT_EQ(10, snapshot.Count());
+  EXPECT_EQ(4, snapshot.buckets_[9]);
+}
+
+// NOLINTNEXTLINE
+TEST(LatencyHistogramTest, StripedCounterTest) {
+  const size_t num_threads = 8;
+  const size_t num_adds = 10000;
+  StripedCounter counter;
+  std::vector<std::thread> threads;
+  for (size_t tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&counter] {
+      for (size_t i = 0; i < num_adds; ++i) {
+        counter.Add();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  counter.Add(5);
+  EXPECT_EQ(num_threads * num_adds + 5, counter.Load());
+}
+
+}  // namespace bustub
@@ -16,7 +16,7 @@
 #include "buffer/buffer_pool_manager_instance.h"
 #include "common/logger.h"
 #include "gtest/gtest.h"
-#include "storage/disk/disk_manager.h"
+#include "storage/disk/file_disk_manager.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
 
@@ -24,7 +24,7 @@ namespace bustub {
 
 // NOLINTNEXTLINE
 TEST(HashTablePageTest, DISABLED_DirectoryPageSampleTest) {
-  DiskManager *disk_manager = new DiskManager("test.db");
+  DiskManager *disk_manager = new FileDiskManager("test.db");
   auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
 
   // get a directory page from the BufferPoolManager
@@ -58,7 +58,7 @@ TEST(HashTablePageTest, DISABLED_DirectoryPageSampleTest) {
 
 // NOLINTNEXTLINE
 TEST(HashTablePageTest, DISABLED_BucketPageSampleTest) {
-  DiskManager *disk_manager = new DiskManager("test.db");
+  DiskManager *disk_manager = new FileDiskManager("test.db");
   auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
 
   // get a bucket page from the BufferPoolManager
@@ -18,6 +18,7 @@
 #include "container/hash/extendible_hash_table.h"
 #include "gtest/gtest.h"
 #include "murmur3/MurmurHash3.h"
+#include "storage/disk/file_disk_manager.h"
 
 namespace bustub {
 
@@ -25,7 +26,7 @@ namespace bustub {
 
 // NOLINTNEXTLINE
 TEST(HashTableTest, DISABLED_SampleTest) {
-  auto *disk_manager = new DiskManager("test.db");
+  auto *disk_manager = new FileDiskManager("test.db");
   auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
   ExtendibleHashTable<int, int, IntComparator> ht("blah", bpm, IntComparator(), HashFunction<int>());
 
@@ -30,6 +30,7 @@
 #include "execution/expressions/constant_value_expression.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "gtest/gtest.h"
+#include "storage/disk/file_disk_manager.h"
 
 namespace bustub {
 
@@ -46,7 +47,7 @@ class ExecutorTest : public ::testing::Test {
 
     // Initialize the database subsystems
     lock_manager_ = std::make_unique<LockManager>();
-    disk_manager_ = std::make_unique<DiskManager>("executor_test.db");
+    disk_manager_ = std::make_unique<FileDiskManager>("executor_test.db");
     bpm_ = std::make_unique<BufferPoolManagerInstance>(32, disk_manager_.get());
     txn_mgr_ = std::make_unique<TransactionManager>(lock_manager_.get(), log_manager_.get());
     catalog_ = std::make_unique<Catalog>(bpm_.get(), lock_manager_.get(), log_manager_.get());
@@ -10,28 +10,56 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "common/bustub_instance.h"
+#include "buffer/buffer_pool_manager_instance.h"
 #include "common/config.h"
+#include "common/exception.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
+#include "recovery/checkpoint_manager.h"
 #include "recovery/log_recovery.h"
+#include "storage/disk/fault_injecting_disk_manager.h"
+#include "storage/disk/file_disk_manager.h"
+#include "storage/disk/memory_disk_manager.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
 
+/** @return the field of a serialized log record at the given offset; fields are not aligned in the log */
+template <typename T>
+T ReadLogField(const char *record, size_t offset) {
+  T value;
+  memcpy(&value, record + offset, sizeof(T));
+  return value;
+}
+
 class RecoveryTest : public ::testing::Test {
  protected:
   // This function is called before every test.
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.master");
   }
 
   // This function is called after every test.
@@ -39,11 +67,12 @@ class RecoveryTest : public ::testing::Test {
     LOG_INFO("Tearing down the system..");
     remove("test.db");
     remove("test.log");
+    remove("test.master");
   };
 };
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_RedoTest) {
+TEST_F(RecoveryTest, RedoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -132,7 +161,7 @@ TEST_F(RecoveryTest, DISABLED_RedoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_UndoTest) {
+TEST_F(RecoveryTest, UndoTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   ASSERT_FALSE(enable_logging);
@@ -211,7 +240,7 @@ TEST_F(RecoveryTest, DISABLED_UndoTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
+TEST_F(RecoveryTest, CheckpointTest) {
   BustubInstance *bustub_instance = new BustubInstance("test.db");
 
   EXPECT_FALSE(enable_logging);
@@ -252,13 +281,13 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   bustub_instance->checkpoint_manager_->EndCheckpoint();
 
   // Hacky
-  Page *pages = dynamic_cast<BufferPoolManagerInstance *>(bustub_instance->buffer_pool_manager_)->GetPages();
+  auto *bpm = dynamic_cast<BufferPoolManagerInstance *>(bustub_instance->buffer_pool_manager_);
   size_t pool_size = bustub_instance->buffer_pool_manager_->GetPoolSize();
 
   // make sure that all pages in the buffer pool are marked as non-dirty
   bool all_pages_clean = true;
   for (size_t i = 0; i < pool_size; i++) {
-    Page *page = &pages[i];
+    Page *page = bpm->GetFrame(i);
     page_id_t page_id = page->GetPageId();
 
     if (page_id != INVALID_PAGE_ID && page->IsDirty()) {
@@ -273,7 +302,7 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   bool all_pages_match = true;
   auto *disk_data = new char[PAGE_SIZE];
   for (size_t i = 0; i < pool_size; i++) {
-    Page *page = &pages[i];
+    Page *page = bpm->GetFrame(i);
     page_id_t page_id = page->GetPageId();
 
     if (page_id != INVALID_PAGE_ID) {
@@ -296,7 +325,7 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   // verify log was flushed and each page's LSN <= persistent lsn
   bool all_pages_lte = true;
   for (size_t i = 0; i < pool_size; i++) {
-    Page *page = &pages[i];
+    Page *page = bpm->GetFrame(i);
     page_id_t page_id = page->GetPageId();
 
     if (page_id != INVALID_PAGE_ID && page->GetLSN() > persistent_lsn) {
@@ -314,4 +343,771 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   LOG_INFO("Shutdown System");
   delete bustub_instance;
 }
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, GroupCommitTest) {
+  const int num_threads = 8;
+  const int txns_per_thread = 25;
+
+  // Every write of the log takes 2 ms, which is plenty of time for the other committers to queue up behind it.
+  MemoryDiskManager memory;
+  InjectedFaults faults;
+  faults.write_latency_ = {LatencyDistribution::FIXED, std::chrono::microseconds(2000), std::chrono::microseconds(0)};
+  FaultInjectingDiskManager disk_manager(&memory, faults);
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager transaction_manager(&lock_manager, &log_manager);
+  log_manager.RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < txns_per_thread; j++) {
+        Transaction *txn = transaction_manager.Begin();
+        transaction_manager.Commit(txn);
+        // A commit returns only once its record is durable.
+        EXPECT_LE(txn->GetPrevLSN(), log_manager.GetPersistentLSN());
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager.StopFlushThread();
+  EXPECT_FALSE(enable_logging);
+
+  // Concurrent commits share writes of the log.
+  const int num_commits = num_threads * txns_per_thread;
+  LOG_INFO("%d commits in %d log writes", num_commits, disk_manager.GetNumFlushes());
+  EXPECT_LT(disk_manager.GetNumFlushes(), num_commits / 2);
+
+  // The log holds a BEGIN and a COMMIT record per transaction, each at the offset that is its lsn.
+  const int header_size = 28;
+  EXPECT_EQ(2 * num_commits * header_size, log_manager.GetNextLSN());
+  EXPECT_EQ(2 * num_commits * header_size - 1, log_manager.GetPersistentLSN());
+  std::vector<char> log(2 * num_commits * header_size);
+  ASSERT_TRUE(disk_manager.ReadLog(log.data(), static_cast<int>(log.size()), 0));
+  int num_commit_records = 0;
+  for (int i = 0; i < 2 * num_commits; i++) {
+    const char *header = log.data() + i * header_size;
+    EXPECT_EQ(header_size, ReadLogField<int32_t>(header, 0));
+    EXPECT_EQ(i * header_size, ReadLogField<lsn_t>(header, 4));
+    if (ReadLogField<LogRecordType>(header, 24) == LogRecordType::COMMIT) {
+      num_commit_records++;
+    }
+  }
+  EXPECT_EQ(num_commits, num_commit_records);
+
+  // Without a flush thread, a full log buffer and a waiting committer write the log themselves. The log buffer is a
+  // ring of two LOG_BUFFER_SIZE buffers.
+  MemoryDiskManager memory1;
+  LogManager log_manager1(&memory1);
+  lsn_t lsn = INVALID_LSN;
+  const int records_in_ring = 2 * LOG_BUFFER_SIZE / header_size;
+  for (int i = 0; i < records_in_ring + 1; i++) {
+    LogRecord log_record(0, lsn, LogRecordType::BEGIN);
+    lsn = log_manager1.AppendLogRecord(&log_record);
+  }
+  EXPECT_EQ(records_in_ring * header_size - 1, log_manager1.GetPersistentLSN());
+  log_manager1.Flush(lsn);
+  EXPECT_LE(lsn, log_manager1.GetPersistentLSN());
+  EXPECT_EQ(log_manager1.GetNextLSN() - 1, log_manager1.GetPersistentLSN());
+}
+
+/** Completes asynchronous log writes late, on a thread of its own, the way an I/O engine does. */
+class DeferredLogDiskManager : public MemoryDiskManager {
+ public:
+  ~DeferredLogDiskManager() override {
+    for (auto &thread : completions_) {
+      thread.join();
+    }
+  }
+
+  void WriteLog(char *log_data, int size) override {
+    num_sync_writes_++;
+    MemoryDiskManager::WriteLog(log_data, size);
+  }
+
+  void WriteLogAsync(const char *log_data, int size, std::function<void()> callback) override {
+    MemoryDiskManager::WriteLogAsync(log_data, size, [] {});
+    auto placed = static_cast<lsn_t>(GetLogSize());
+    std::scoped_lock latch(completions_latch_);
+    completions_.emplace_back([this, placed, callback = std::move(callback)] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      durable_size_ = std::max(durable_size_.load(), placed);
+      callback();
+    });
+  }
+
+  std::atomic<int> num_sync_writes_{0};
+  /** Size of the log that has been reported durable. */
+  std::atomic<lsn_t> durable_size_{0};
+
+ private:
+  std::mutex completions_latch_;
+  std::vector<std::thread> completions_;
+};
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, AsyncLogFlushTest) {
+  const int num_threads = 4;
+  const int txns_per_thread = 20;
+
+  DeferredLogDiskManager disk_manager;
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager transaction_manager(&lock_manager, &log_manager);
+  log_manager.RunFlushThread();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < txns_per_thread; j++) {
+        Transaction *txn = transaction_manager.Begin();
+        transaction_manager.Commit(txn);
+        // The log is written asynchronously, and a commit still waits for the write to complete.
+        EXPECT_LT(txn->GetPrevLSN(), disk_manager.durable_size_);
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  log_manager.StopFlushThread();
+
+  EXPECT_EQ(0, disk_manager.num_sync_writes_);
+  EXPECT_EQ(log_manager.GetNextLSN(), disk_manager.durable_size_);
+  EXPECT_EQ(log_manager.GetNextLSN() - 1, log_manager.GetPersistentLSN());
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LogAppendThroughputTest) {
+  const int records_per_thread = 20000;
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+    // The log lives in memory, so that appending is all that is measured.
+    MemoryDiskManager disk_manager;
+    LogManager log_manager(&disk_manager);
+    log_manager.RunFlushThread();
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&, i] {
+        lsn_t prev_lsn = INVALID_LSN;
+        for (int j = 0; j < records_per_thread; j++) {
+          LogRecord log_record(i, prev_lsn, LogRecordType::INSERT, RID(i, j), tuple);
+          lsn_t lsn = log_manager.AppendLogRecord(&log_record);
+          EXPECT_GT(lsn, prev_lsn);
+          prev_lsn = lsn;
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    log_manager.StopFlushThread();
+    const int num_records = num_threads * records_per_thread;
+    printf("log append, %2d threads: %.2f M records/s\n", num_threads, num_records / elapsed / 1e6);
+
+    // Every record made it to the log whole, at the offset that is its lsn.
+    EXPECT_EQ(log_manager.GetNextLSN(), log_manager.GetPersistentLSN() + 1);
+    std::vector<char> log(log_manager.GetNextLSN());
+    ASSERT_TRUE(disk_manager.ReadLog(log.data(), static_cast<int>(log.size()), 0));
+    std::vector<int> records_per_txn(num_threads, 0);
+    size_t offset = 0;
+    int count = 0;
+    while (offset < log.size()) {
+      const char *header = log.data() + offset;
+      ASSERT_EQ(static_cast<lsn_t>(offset), ReadLogField<lsn_t>(header, 4));
+      ASSERT_EQ(LogRecordType::INSERT, ReadLogField<LogRecordType>(header, 24));
+      auto rid = ReadLogField<RID>(header, 28);
+      auto txn_id = ReadLogField<txn_id_t>(header, 12);
+      ASSERT_EQ(txn_id, rid.GetPageId());
+      EXPECT_EQ(records_per_txn[txn_id]++, static_cast<int>(rid.GetSlotNum()));
+      offset += ReadLogField<int32_t>(header, 0);
+      count++;
+    }
+    EXPECT_EQ(offset, log.size());
+    EXPECT_EQ(num_records, count);
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, ParallelRedoTest) {
+  const int num_tables = 8;
+  const int tuples_per_table = 2500;
+  const size_t pool_size = 1000;
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  // Fill the tables with committed transactions and leave one transaction unfinished, without writing back a single
+  // page: everything has to come back from the log.
+  MemoryDiskManager disk_manager;
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager transaction_manager(&lock_manager, &log_manager);
+  std::vector<page_id_t> first_page_ids;
+  std::vector<RID> rids;
+  {
+    BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+    bpm.SetCleanerDirtyTarget(1.0);
+    log_manager.RunFlushThread();
+    std::vector<std::unique_ptr<TableHeap>> tables;
+    Transaction *txn = transaction_manager.Begin();
+    for (int i = 0; i < num_tables; i++) {
+      tables.emplace_back(std::make_unique<TableHeap>(&bpm, &lock_manager, &log_manager, txn));
+      first_page_ids.push_back(tables.back()->GetFirstPageId());
+    }
+    transaction_manager.Commit(txn);
+    delete txn;
+    for (int i = 0; i < num_tables; i++) {
+      txn = transaction_manager.Begin();
+      for (int j = 0; j < tuples_per_table; j++) {
+        RID rid;
+        ASSERT_TRUE(tables[i]->InsertTuple(ConstructTuple(&schema), &rid, txn));
+        rids.push_back(rid);
+      }
+      transaction_manager.Commit(txn);
+      delete txn;
+    }
+    txn = transaction_manager.Begin();
+    for (int j = 0; j < 100; j++) {
+      RID rid;
+      ASSERT_TRUE(tables[0]->InsertTuple(ConstructTuple(&schema), &rid, txn));
+      ASSERT_TRUE(tables[1]->MarkDelete(rids[tuples_per_table + j], txn));
+    }
+    delete txn;
+    log_manager.StopFlushThread();
+  }
+
+  Transaction txn(0);
+  for (size_t num_workers : {1, 2, 4, 8}) {
+    BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+    LogRecovery log_recovery(&disk_manager, &bpm, num_workers);
+    auto start = std::chrono::steady_clock::now();
+    log_recovery.Redo();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("redo, %zu workers: %.1f MB of log in %.1f ms, %.1f MB/s\n", num_workers,
+           log_recovery.GetRedoLogSize() / 1e6, elapsed * 1e3, log_recovery.GetRedoLogSize() / 1e6 / elapsed);
+    EXPECT_EQ(log_manager.GetNextLSN(), log_recovery.GetRedoLogSize());
+    log_recovery.Undo();
+
+    // Exactly the committed tuples are back.
+    for (int i = 0; i < num_tables; i++) {
+      TableHeap table(&bpm, &lock_manager, &log_manager, first_page_ids[i]);
+      std::set<std::pair<page_id_t, uint32_t>> expected;
+      std::set<std::pair<page_id_t, uint32_t>> recovered;
+      for (int j = 0; j < tuples_per_table; j++) {
+        expected.emplace(rids[i * tuples_per_table + j].GetPageId(), rids[i * tuples_per_table + j].GetSlotNum());
+      }
+      for (auto itr = table.Begin(&txn); itr != table.End(); ++itr) {
+        recovered.emplace(itr->GetRid().GetPageId(), itr->GetRid().GetSlotNum());
+      }
+      EXPECT_EQ(expected, recovered);
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, RedoInsertSlotTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  // A page whose first slot is emptied and then taken again: every insert is replayed at the slot it was logged at.
+  MemoryDiskManager disk_manager;
+  LogManager log_manager(&disk_manager);
+  page_id_t page_id = disk_manager.AllocatePage();
+  lsn_t lsn = INVALID_LSN;
+  auto append = [&](LogRecord record) { lsn = log_manager.AppendLogRecord(&record); };
+  append(LogRecord(0, lsn, LogRecordType::BEGIN));
+  append(LogRecord(0, lsn, LogRecordType::NEWPAGE, INVALID_PAGE_ID, page_id));
+  append(LogRecord(0, lsn, LogRecordType::INSERT, RID(page_id, 0), tuple));
+  append(LogRecord(0, lsn, LogRecordType::INSERT, RID(page_id, 1), tuple));
+  append(LogRecord(0, lsn, LogRecordType::APPLYDELETE, RID(page_id, 0), tuple));
+  append(LogRecord(0, lsn, LogRecordType::INSERT, RID(page_id, 0), tuple));
+  append(LogRecord(0, lsn, LogRecordType::COMMIT));
+  log_manager.Flush(lsn);
+  {
+    BufferPoolManagerInstance bpm(10, &disk_manager, &log_manager);
+    LogRecovery log_recovery(&disk_manager, &bpm, 1);
+    log_recovery.Redo();
+    auto *page = static_cast<TablePage *>(bpm.FetchPage(page_id));
+    Tuple recovered;
+    Transaction txn(0);
+    EXPECT_TRUE(page->GetTuple(RID(page_id, 0), &recovered, &txn, nullptr));
+    EXPECT_TRUE(page->GetTuple(RID(page_id, 1), &recovered, &txn, nullptr));
+    EXPECT_FALSE(page->GetTuple(RID(page_id, 2), &recovered, &txn, nullptr));
+    bpm.UnpinPage(page_id, false);
+  }
+
+  // An insert logged at a slot that is taken cannot have happened: redo fails instead of putting the tuple elsewhere.
+  append(LogRecord(1, INVALID_LSN, LogRecordType::BEGIN));
+  append(LogRecord(1, lsn, LogRecordType::INSERT, RID(page_id, 1), tuple));
+  log_manager.Flush(lsn);
+  BufferPoolManagerInstance bpm(10, &disk_manager, &log_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm, 1);
+  EXPECT_THROW(log_recovery.Redo(), Exception);
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, FuzzyCheckpointTest) {
+  const int num_threads = 4;
+  const int txns_per_thread = 20;
+  const int tuples_per_txn = 50;
+  const size_t pool_size = 500;
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  MemoryDiskManager disk_manager;
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager transaction_manager(&lock_manager, &log_manager);
+  page_id_t first_page_id;
+  std::set<std::pair<page_id_t, uint32_t>> committed;
+  lsn_t checkpoint_lsn;
+  Transaction *loser;
+  {
+    BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+    bpm.SetCleanerDirtyTarget(1.0);
+    CheckpointManager checkpoint_manager(&transaction_manager, &log_manager, &bpm, &disk_manager);
+    log_manager.RunFlushThread();
+    Transaction *txn = transaction_manager.Begin();
+    TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+    first_page_id = table.GetFirstPageId();
+    transaction_manager.Commit(txn);
+    delete txn;
+    auto insert_committed = [&](int num_tuples) {
+      Transaction *txn = transaction_manager.Begin();
+      std::vector<RID> rids;
+      for (int i = 0; i < num_tuples; i++) {
+        RID rid;
+        ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, txn));
+        rids.push_back(rid);
+      }
+      transaction_manager.Commit(txn);
+      delete txn;
+      for (const auto &rid : rids) {
+        committed.emplace(rid.GetPageId(), rid.GetSlotNum());
+      }
+    };
+
+    // A transaction that stays open across every checkpoint, which a blocking checkpoint would wait for forever. It
+    // never finishes, so recovery has to undo it although its changes are older than the checkpoint it starts from.
+    loser = transaction_manager.Begin();
+    for (int i = 0; i < 100; i++) {
+      RID rid;
+      ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, loser));
+    }
+
+    // Checkpoints taken while transactions keep running.
+    std::mutex committed_latch;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([&] {
+        for (int j = 0; j < txns_per_thread; j++) {
+          std::set<std::pair<page_id_t, uint32_t>> mine;
+          Transaction *txn = transaction_manager.Begin();
+          for (int k = 0; k < tuples_per_txn; k++) {
+            RID rid;
+            ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, txn));
+            mine.emplace(rid.GetPageId(), rid.GetSlotNum());
+          }
+          transaction_manager.Commit(txn);
+          delete txn;
+          std::scoped_lock latch(committed_latch);
+          committed.insert(mine.begin(), mine.end());
+        }
+      });
+    }
+    for (int i = 0; i < 3; i++) {
+      checkpoint_manager.BeginCheckpoint();
+      checkpoint_manager.EndCheckpoint();
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    // Once transactions are quiet, a checkpoint writes back every page.
+    checkpoint_manager.BeginCheckpoint();
+    checkpoint_manager.EndCheckpoint();
+    EXPECT_EQ(0, bpm.GetDirtyPageTable().size());
+    insert_committed(100);
+    checkpoint_lsn = log_manager.GetNextLSN();
+    checkpoint_manager.BeginCheckpoint();
+    EXPECT_FALSE(bpm.GetDirtyPageTable().empty());
+    insert_committed(100);
+    log_manager.StopFlushThread();
+    // Crash: the buffer pool goes away without writing back what the checkpoint has not written yet.
+  }
+
+  BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm);
+  log_recovery.Redo();
+  // Redo started at the oldest recLSN of the last checkpoint: before the checkpoint, where the pages it found dirty
+  // were last written, but not at the beginning of the log.
+  EXPECT_GT(log_recovery.GetRedoLSN(), 0);
+  EXPECT_LT(log_recovery.GetRedoLSN(), checkpoint_lsn);
+  EXPECT_EQ(log_manager.GetNextLSN(), log_recovery.GetRedoLSN() + log_recovery.GetRedoLogSize());
+  log_recovery.Undo();
+
+  // Exactly the committed tuples are back.
+  Transaction txn(0);
+  TableHeap table(&bpm, &lock_manager, &log_manager, first_page_id);
+  std::set<std::pair<page_id_t, uint32_t>> recovered;
+  for (auto itr = table.Begin(&txn); itr != table.End(); ++itr) {
+    recovered.emplace(itr->GetRid().GetPageId(), itr->GetRid().GetSlotNum());
+  }
+  EXPECT_EQ(committed, recovered);
+  delete loser;
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, StealTest) {
+  const size_t pool_size = 8;
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  // No flush thread: the log only becomes durable on commit, at a checkpoint, and when a page is written back, so the
+  // crash loses whatever is left of it.
+  MemoryDiskManager disk_manager;
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager transaction_manager(&lock_manager, &log_manager);
+  page_id_t first_page_id;
+  std::set<std::pair<page_id_t, uint32_t>> committed;
+  std::vector<RID> loser_rids;
+  enable_logging = true;
+  {
+    BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+    CheckpointManager checkpoint_manager(&transaction_manager, &log_manager, &bpm, &disk_manager);
+    Transaction *txn = transaction_manager.Begin();
+    TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+    first_page_id = table.GetFirstPageId();
+    for (int i = 0; i < 500; i++) {
+      RID rid;
+      ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, txn));
+      committed.emplace(rid.GetPageId(), rid.GetSlotNum());
+    }
+    transaction_manager.Commit(txn);
+    delete txn;
+
+    // A transaction that outgrows the buffer pool: its dirty pages are evicted, and written back by a checkpoint taken
+    // halfway, while it is still running.
+    Transaction *loser = transaction_manager.Begin();
+    for (int i = 0; i < 2000; i++) {
+      RID rid;
+      ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, loser));
+      loser_rids.push_back(rid);
+      if (i == 1000) {
+        checkpoint_manager.BeginCheckpoint();
+        checkpoint_manager.EndCheckpoint();
+      }
+    }
+    delete loser;
+    // Crash: neither the pages left in the buffer pool nor the tail of the log are written.
+  }
+  enable_logging = false;
+
+  // The loser's changes did reach the disk, but never ahead of their log records.
+  size_t stolen = 0;
+  {
+    BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+    Transaction txn(0);
+    for (const auto &rid : loser_rids) {
+      auto *page = static_cast<TablePage *>(bpm.FetchPage(rid.GetPageId()));
+      ASSERT_NE(nullptr, page);
+      EXPECT_LT(page->GetLSN(), static_cast<lsn_t>(disk_manager.GetLogSize()));
+      Tuple tuple;
+      if (page->GetTuple(rid, &tuple, &txn, nullptr)) {
+        stolen++;
+      }
+      bpm.UnpinPage(rid.GetPageId(), false);
+    }
+  }
+  EXPECT_GT(stolen, 0);
+
+  BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm, 1);
+  log_recovery.Redo();
+  log_recovery.Undo();
+
+  // Exactly the committed tuples are back.
+  Transaction txn(0);
+  TableHeap table(&bpm, &lock_manager, &log_manager, first_page_id);
+  std::set<std::pair<page_id_t, uint32_t>> recovered;
+  for (auto itr = table.Begin(&txn); itr != table.End(); ++itr) {
+    recovered.emplace(itr->GetRid().GetPageId(), itr->GetRid().GetSlotNum());
+  }
+  EXPECT_EQ(committed, recovered);
+}
+
+/** A MemoryDiskManager that counts the page writes not yet made durable by a Sync when the log is truncated. */
+class SyncCheckingDiskManager : public MemoryDiskManager {
+ public:
+  void WritePage(page_id_t page_id, const char *page_data) override {
+    unsynced_writes_++;
+    MemoryDiskManager::WritePage(page_id, page_data);
+  }
+
+  void Sync() override { unsynced_writes_ = 0; }
+
+  size_t TruncateLog(lsn_t lsn) override {
+    num_truncations_++;
+    unsynced_at_truncation_ += unsynced_writes_;
+    return MemoryDiskManager::TruncateLog(lsn);
+  }
+
+  std::atomic<int> unsynced_writes_{0};
+  std::atomic<int> num_truncations_{0};
+  std::atomic<int> unsynced_at_truncation_{0};
+};
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, CheckpointSyncTest) {
+  const size_t pool_size = 8;
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  SyncCheckingDiskManager disk_manager;
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager transaction_manager(&lock_manager, &log_manager);
+  BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+  // No page cleaner, whose writes could land between a checkpoint's sync and its truncation.
+  bpm.SetCleanerDirtyTarget(1.0);
+  CheckpointManager checkpoint_manager(&transaction_manager, &log_manager, &bpm, &disk_manager);
+  log_manager.RunFlushThread();
+  Transaction *txn = transaction_manager.Begin();
+  TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+  transaction_manager.Commit(txn);
+  delete txn;
+
+  // Pages written back by evictions and by the checkpoints themselves: a checkpoint may only drop the log that would
+  // redo them once they are durable.
+  for (int i = 0; i < 3; i++) {
+    txn = transaction_manager.Begin();
+    for (int j = 0; j < 2000; j++) {
+      RID rid;
+      ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, txn));
+    }
+    transaction_manager.Commit(txn);
+    delete txn;
+    EXPECT_GT(disk_manager.unsynced_writes_, 0);
+    checkpoint_manager.BeginCheckpoint();
+    checkpoint_manager.EndCheckpoint();
+  }
+  log_manager.StopFlushThread();
+  EXPECT_EQ(3, disk_manager.num_truncations_);
+  EXPECT_EQ(0, disk_manager.unsynced_at_truncation_);
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, RestartTest) {
+  const size_t pool_size = 20;
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  LockManager lock_manager;
+  page_id_t first_page_id;
+  std::set<std::pair<page_id_t, uint32_t>> committed;
+  lsn_t log_end;
+  auto insert = [&](TableHeap *table, TransactionManager *transaction_manager, int num_tuples, bool commit) {
+    Transaction *txn = transaction_manager->Begin();
+    for (int i = 0; i < num_tuples; i++) {
+      RID rid;
+      ASSERT_TRUE(table->InsertTuple(ConstructTuple(&schema), &rid, txn));
+      if (commit) {
+        committed.emplace(rid.GetPageId(), rid.GetSlotNum());
+      }
+    }
+    if (commit) {
+      transaction_manager->Commit(txn);
+    }
+    delete txn;
+  };
+
+  // First run: committed transactions, then a crash.
+  {
+    FileDiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    {
+      TransactionManager transaction_manager(&lock_manager, &log_manager);
+      BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+      log_manager.RunFlushThread();
+      Transaction *txn = transaction_manager.Begin();
+      TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+      first_page_id = table.GetFirstPageId();
+      transaction_manager.Commit(txn);
+      delete txn;
+      insert(&table, &transaction_manager, 500, true);
+      log_manager.StopFlushThread();
+    }
+    log_end = log_manager.GetNextLSN();
+    disk_manager.ShutDown();
+  }
+
+  // Second run: recover, then write more, some of it by a transaction the crash leaves unfinished. The log continues
+  // where the first run left it, so every LSN is still the offset of its record.
+  {
+    FileDiskManager disk_manager("test.db");
+    LogManager log_manager(&disk_manager);
+    EXPECT_EQ(log_end, log_manager.GetNextLSN());
+    EXPECT_EQ(log_end - 1, log_manager.GetPersistentLSN());
+    {
+      TransactionManager transaction_manager(&lock_manager, &log_manager);
+      BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+      LogRecovery log_recovery(&disk_manager, &bpm);
+      log_recovery.Redo();
+      log_recovery.Undo();
+      log_manager.RunFlushThread();
+      TableHeap table(&bpm, &lock_manager, &log_manager, first_page_id);
+      insert(&table, &transaction_manager, 500, true);
+      insert(&table, &transaction_manager, 100, false);
+      log_manager.StopFlushThread();
+    }
+    EXPECT_LT(log_end, log_manager.GetNextLSN());
+    log_end = log_manager.GetNextLSN();
+    disk_manager.ShutDown();
+  }
+
+  // Third run: recovery reads both runs' records back at their LSNs, and brings back what both runs committed.
+  FileDiskManager disk_manager("test.db");
+  LogManager log_manager(&disk_manager);
+  EXPECT_EQ(log_end, log_manager.GetNextLSN());
+  BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm);
+  log_recovery.Redo();
+  EXPECT_EQ(log_end, log_recovery.GetRedoLogSize());
+  log_recovery.Undo();
+  Transaction txn(0);
+  TableHeap table(&bpm, &lock_manager, &log_manager, first_page_id);
+  std::set<std::pair<page_id_t, uint32_t>> recovered;
+  for (auto itr = table.Begin(&txn); itr != table.End(); ++itr) {
+    recovered.emplace(itr->GetRid().GetPageId(), itr->GetRid().GetSlotNum());
+  }
+  EXPECT_EQ(committed, recovered);
+  disk_manager.ShutDown();
+  remove(disk_manager.GetLogSegmentName(0).c_str());
+}
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, LogTruncationTest) {
+  const size_t pool_size = 100;
+  const size_t segment_size = 4 * PAGE_SIZE;
+  const std::string archive = "test_log_archive";
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  StorageLayout layout;
+  layout.log_segment_size_ = segment_size;
+  layout.log_archive_directory_ = archive;
+  FileDiskManager disk_manager("test.db", DiskIOBackend::PREAD, layout);
+  LogManager log_manager(&disk_manager);
+  LockManager lock_manager;
+  TransactionManager transaction_manager(&lock_manager, &log_manager);
+  page_id_t first_page_id;
+  std::set<std::pair<page_id_t, uint32_t>> committed;
+  lsn_t loser_lsn;
+  Transaction *loser;
+  struct stat stat_buf;
+  {
+    BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+    CheckpointManager checkpoint_manager(&transaction_manager, &log_manager, &bpm, &disk_manager);
+    log_manager.RunFlushThread();
+    Transaction *txn = transaction_manager.Begin();
+    TableHeap table(&bpm, &lock_manager, &log_manager, txn);
+    first_page_id = table.GetFirstPageId();
+    transaction_manager.Commit(txn);
+    delete txn;
+    auto insert_committed = [&](int num_tuples) {
+      Transaction *txn = transaction_manager.Begin();
+      for (int i = 0; i < num_tuples; i++) {
+        RID rid;
+        ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, txn));
+        committed.emplace(rid.GetPageId(), rid.GetSlotNum());
+      }
+      transaction_manager.Commit(txn);
+      delete txn;
+    };
+    auto checkpoint = [&] {
+      checkpoint_manager.BeginCheckpoint();
+      checkpoint_manager.EndCheckpoint();
+    };
+
+    // Once the pages are written back, checkpoints retire the segments behind them into the archive.
+    for (int i = 0; i < 5; i++) {
+      insert_committed(200);
+      checkpoint();
+    }
+    checkpoint();
+    EXPECT_NE(0, stat(disk_manager.GetLogSegmentName(0).c_str(), &stat_buf));
+    EXPECT_EQ(0, stat((archive + "/" + disk_manager.GetLogSegmentName(0)).c_str(), &stat_buf));
+
+    // The log of a transaction that is still active stays, however far the checkpoints move on.
+    loser = transaction_manager.Begin();
+    loser_lsn = loser->GetBeginLSN();
+    for (int i = 0; i < 50; i++) {
+      RID rid;
+      ASSERT_TRUE(table.InsertTuple(ConstructTuple(&schema), &rid, loser));
+    }
+    for (int i = 0; i < 5; i++) {
+      insert_committed(200);
+      checkpoint();
+    }
+    checkpoint();
+    EXPECT_GT(log_manager.GetNextLSN(), loser_lsn + static_cast<lsn_t>(2 * segment_size));
+    EXPECT_EQ(0, stat(disk_manager.GetLogSegmentName(loser_lsn).c_str(), &stat_buf));
+    EXPECT_NE(0, stat(disk_manager.GetLogSegmentName(loser_lsn - segment_size).c_str(), &stat_buf));
+    insert_committed(100);
+    log_manager.StopFlushThread();
+    // Crash: the loser never finishes.
+  }
+
+  // Recovery gets by with what is left of the log: redo from the last checkpoint, undo back to the loser's begin.
+  BufferPoolManagerInstance bpm(pool_size, &disk_manager, &log_manager);
+  LogRecovery log_recovery(&disk_manager, &bpm);
+  log_recovery.Redo();
+  EXPECT_GT(log_recovery.GetRedoLSN(), loser_lsn);
+  log_recovery.Undo();
+  Transaction txn(0);
+  TableHeap table(&bpm, &lock_manager, &log_manager, first_page_id);
+  std::set<std::pair<page_id_t, uint32_t>> recovered;
+  for (auto itr = table.Begin(&txn); itr != table.End(); ++itr) {
+    recovered.emplace(itr->GetRid().GetPageId(), itr->GetRid().GetSlotNum());
+  }
+  EXPECT_EQ(committed, recovered);
+
+  disk_manager.ShutDown();
+  for (size_t start = 0; start < static_cast<size_t>(log_manager.GetNextLSN()); start += segment_size) {
+    remove(disk_manager.GetLogSegmentName(start).c_str());
+    remove((archive + "/" + disk_manager.GetLogSegmentName(start)).c_str());
+  }
+  rmdir(archive.c_str());
+  delete loser;
+}
 }  // namespace bustub
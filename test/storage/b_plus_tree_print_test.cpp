@@ -16,6 +16,7 @@
 #include "buffer/buffer_pool_manager_instance.h"
 #include "common/logger.h"
 #include "gtest/gtest.h"
+#include "storage/disk/file_disk_manager.h"
 #include "storage/index/b_plus_tree.h"
 #include "test_util.h"  // NOLINT
 
@@ -57,7 +58,7 @@ TEST(BptTreeTest, DISABLED_UnitTest) {
   auto key_schema = ParseCreateStatement(create_stmt);
   GenericComparator<8> comparator(key_schema.get());
 
-  DiskManager *disk_manager = new DiskManager("test.db");
+  DiskManager *disk_manager = new FileDiskManager("test.db");
   BufferPoolManager *bpm = new BufferPoolManagerInstance(100, disk_manager);
   // create and fetch header_page
   page_id_t page_id;
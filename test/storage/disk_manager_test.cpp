@@ -10,11 +10,26 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <future>  // NOLINT
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
-#include "storage/disk/disk_manager.h"
+#include "storage/disk/file_disk_manager.h"
+#include "storage/disk/fault_injecting_disk_manager.h"
+#include "storage/disk/memory_disk_manager.h"
 
 namespace bustub {
 
@@ -24,35 +39,126 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
   };
 };
 
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ReadWritePageTest) {
-  char buf[PAGE_SIZE] = {0};
-  char data[PAGE_SIZE] = {0};
-  std::string db_file("test.db");
-  auto dm = DiskManager(db_file);
-  std::strncpy(data, "A test string.", sizeof(data));
+  for (auto backend : {DiskIOBackend::FSTREAM, DiskIOBackend::PREAD}) {
+    remove("test.db");
+    char buf[PAGE_SIZE] = {0};
+    char data[PAGE_SIZE] = {0};
+    std::string db_file("test.db");
+    auto dm = FileDiskManager(db_file, backend);
+    std::strncpy(data, "A test string.", sizeof(data));
 
-  dm.ReadPage(0, buf);  // tolerate empty read
+    dm.ReadPage(0, buf);  // tolerate empty read
 
-  dm.WritePage(0, data);
-  dm.ReadPage(0, buf);
-  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+    dm.WritePage(0, data);
+    dm.ReadPage(0, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
 
-  std::memset(buf, 0, sizeof(buf));
-  dm.WritePage(5, data);
-  dm.ReadPage(5, buf);
-  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+    std::memset(buf, 0, sizeof(buf));
+    dm.WritePage(5, data);
+    dm.ReadPage(5, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+    // The pages in between read back as zeroes.
+    std::memset(buf, 1, sizeof(buf));
+    dm.ReadPage(3, buf);
+    EXPECT_EQ(0, buf[0]);
+    EXPECT_EQ(0, buf[PAGE_SIZE - 1]);
+
+    dm.Sync();
+    dm.ShutDown();
+  }
+}
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ConcurrentReadWritePageTest) {
+  const int num_threads = 4;
+  const page_id_t pages_per_thread = 64;
+  std::string db_file("test.db");
+  auto dm = FileDiskManager(db_file);
+
+  // Every thread writes its own pages and reads them straight back while the others do the same.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.emplace_back([&dm, tid] {
+      char data[PAGE_SIZE];
+      char buf[PAGE_SIZE];
+      for (page_id_t i = 0; i < pages_per_thread; i++) {
+        page_id_t page_id = i * num_threads + tid;
+        std::memset(data, page_id, sizeof(data));
+        dm.WritePage(page_id, data);
+        dm.ReadPage(page_id, buf);
+        EXPECT_EQ(0, std::memcmp(buf, data, sizeof(buf)));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  dm.Sync();
+  EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumWrites());
   dm.ShutDown();
+
+  // The other backend sees the same file.
+  auto fstream_dm = FileDiskManager(db_file, DiskIOBackend::FSTREAM);
+  char buf[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread; page_id++) {
+    fstream_dm.ReadPage(page_id, buf);
+    EXPECT_EQ(static_cast<char>(page_id), buf[PAGE_SIZE / 2]);
+  }
+  fstream_dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ConcurrentRandomReadBenchmarkTest) {
+  const int num_threads = 4;
+  const page_id_t num_pages = 1024;
+  const int reads_per_thread = 20000;
+  std::string db_file("test.db");
+  {
+    char data[PAGE_SIZE] = {0};
+    auto dm = FileDiskManager(db_file);
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      dm.WritePage(page_id, data);
+    }
+    dm.ShutDown();
+  }
+
+  for (auto backend : {DiskIOBackend::FSTREAM, DiskIOBackend::PREAD}) {
+    auto dm = FileDiskManager(db_file, backend);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&dm, tid] {
+        std::mt19937 rng(tid);
+        std::uniform_int_distribution<page_id_t> page_dist(0, num_pages - 1);
+        char buf[PAGE_SIZE];
+        for (int i = 0; i < reads_per_thread; i++) {
+          dm.ReadPage(page_dist(rng), buf);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%s backend: %d threads, %.0f random page reads/s\n",
+           backend == DiskIOBackend::FSTREAM ? "fstream" : "pread", num_threads,
+           num_threads * reads_per_thread / elapsed.count());
+    dm.ShutDown();
+  }
 }
 
 // NOLINTNEXTLINE
@@ -60,7 +166,7 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   char buf[16] = {0};
   char data[16] = {0};
   std::string db_file("test.db");
-  auto dm = DiskManager(db_file);
+  auto dm = FileDiskManager(db_file);
   std::strncpy(data, "A test string.", sizeof(data));
 
   dm.ReadLog(buf, sizeof(buf), 0);  // tolerate empty read
@@ -73,6 +179,693 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
 }
 
 // NOLINTNEXTLINE
-TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
+TEST_F(DiskManagerTest, ManifestTest) {
+  std::string db_file("test.db");
+  std::vector<page_id_t> page_ids{7, 3, 11, 0};
+  {
+    auto dm = FileDiskManager(db_file);
+    EXPECT_TRUE(dm.ReadManifest(0).empty());
+    dm.WriteManifest(0, page_ids);
+    dm.WriteManifest(1, {4});
+    EXPECT_EQ(page_ids, dm.ReadManifest(0));
+    dm.ShutDown();
+  }
+
+  // Manifests outlive the disk manager, in the order they were written.
+  {
+    auto dm = FileDiskManager(db_file);
+    EXPECT_EQ(page_ids, dm.ReadManifest(0));
+    EXPECT_EQ(std::vector<page_id_t>{4}, dm.ReadManifest(1));
+    dm.ShutDown();
+  }
+
+  // A database created from scratch does not inherit the manifests of the one it replaces.
+  remove("test.db");
+  {
+    auto dm = FileDiskManager(db_file);
+    EXPECT_TRUE(dm.ReadManifest(0).empty());
+    EXPECT_TRUE(dm.ReadManifest(1).empty());
+    dm.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageMapTest) {
+  std::string db_file("test.db");
+  {
+    auto dm = FileDiskManager(db_file);
+    for (page_id_t page_id = 0; page_id < 10; page_id++) {
+      EXPECT_EQ(page_id, dm.AllocatePage());
+    }
+    // Freed pages are reused lowest first, before the database grows.
+    dm.DeallocatePage(7);
+    dm.DeallocatePage(3);
+    dm.DeallocatePage(3);
+    EXPECT_FALSE(dm.IsAllocated(3));
+    EXPECT_EQ(3, dm.AllocatePage());
+    EXPECT_EQ(7, dm.AllocatePage());
+    EXPECT_EQ(10, dm.AllocatePage());
+
+    // With several buffer pool instances, every instance only gets the ids that mod back to it.
+    dm.DeallocatePage(4);
+    dm.DeallocatePage(5);
+    EXPECT_EQ(5, dm.AllocatePage(1, 2));
+    EXPECT_EQ(11, dm.AllocatePage(1, 2));
+    EXPECT_EQ(4, dm.AllocatePage(0, 2));
+    EXPECT_EQ(12, dm.AllocatePage(0, 2));
+    dm.DeallocatePage(2);
+    dm.ShutDown();
+  }
+
+  // The map outlives the disk manager.
+  {
+    auto dm = FileDiskManager(db_file);
+    EXPECT_TRUE(dm.IsAllocated(12));
+    EXPECT_FALSE(dm.IsAllocated(2));
+    EXPECT_EQ(2, dm.AllocatePage());
+    EXPECT_EQ(13, dm.AllocatePage());
+    dm.ShutDown();
+  }
+
+  // A database without a map treats every page in its file as allocated.
+  remove("test.fsm");
+  {
+    char data[PAGE_SIZE] = {0};
+    auto dm = FileDiskManager(db_file);
+    dm.WritePage(4, data);
+    dm.ShutDown();
+  }
+  remove("test.fsm");
+  {
+    auto dm = FileDiskManager(db_file);
+    EXPECT_TRUE(dm.IsAllocated(0));
+    EXPECT_TRUE(dm.IsAllocated(4));
+    EXPECT_EQ(5, dm.AllocatePage());
+    dm.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ExtentAllocationTest) {
+  auto dm = FileDiskManager("test.db");
+  EXPECT_EQ(0, dm.AllocatePage());
+
+  // The first extent without any allocated page is set aside, and hands out its ids in order.
+  page_id_t extent_a = INVALID_PAGE_ID;
+  page_id_t extent_b = INVALID_PAGE_ID;
+  EXPECT_EQ(EXTENT_SIZE, dm.AllocatePageInExtent(&extent_a));
+  EXPECT_EQ(EXTENT_SIZE, extent_a);
+  EXPECT_EQ(2 * EXTENT_SIZE, dm.AllocatePageInExtent(&extent_b));
+  EXPECT_EQ(EXTENT_SIZE + 1, dm.AllocatePageInExtent(&extent_a));
+  EXPECT_EQ(2 * EXTENT_SIZE + 1, dm.AllocatePageInExtent(&extent_b));
+
+  // AllocatePage fills the unreserved ids and skips both extents.
+  for (page_id_t page_id = 1; page_id < EXTENT_SIZE; page_id++) {
+    EXPECT_EQ(page_id, dm.AllocatePage());
+  }
+  EXPECT_EQ(3 * EXTENT_SIZE, dm.AllocatePage());
+
+  // A freed page of an extent is handed out again by that extent only.
+  dm.DeallocatePage(EXTENT_SIZE);
+  EXPECT_EQ(3 * EXTENT_SIZE + 1, dm.AllocatePage());
+  EXPECT_EQ(EXTENT_SIZE, dm.AllocatePageInExtent(&extent_a));
+
+  // A full extent is replaced by the lowest one without any allocated page.
+  for (page_id_t page_id = EXTENT_SIZE + 2; page_id < 2 * EXTENT_SIZE; page_id++) {
+    EXPECT_EQ(page_id, dm.AllocatePageInExtent(&extent_a));
+  }
+  EXPECT_EQ(4 * EXTENT_SIZE, dm.AllocatePageInExtent(&extent_a));
+  EXPECT_EQ(4 * EXTENT_SIZE, extent_a);
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, CompactionTest) {
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = FileDiskManager(db_file);
+  for (page_id_t page_id = 0; page_id < 8; page_id++) {
+    EXPECT_EQ(page_id, dm.AllocatePage());
+    dm.WritePage(page_id, data);
+  }
+  EXPECT_EQ(0, dm.Compact());
+
+  // Only the free pages at the end of the file can go.
+  dm.DeallocatePage(2);
+  dm.DeallocatePage(6);
+  dm.DeallocatePage(7);
+  EXPECT_EQ(2, dm.Compact());
+  EXPECT_EQ(0, dm.Compact());
+
+  // In the background.
+  dm.DeallocatePage(5);
+  dm.DeallocatePage(4);
+  dm.StartCompaction(std::chrono::milliseconds(5));
+  struct stat stat_buf;
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(0, stat(db_file.c_str(), &stat_buf));
+    if (stat_buf.st_size == 4 * PAGE_SIZE) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(4 * PAGE_SIZE, stat_buf.st_size);
+
+  // The file grows back as pages are reused.
+  EXPECT_EQ(2, dm.AllocatePage());
+  EXPECT_EQ(4, dm.AllocatePage());
+  dm.WritePage(4, data);
+  dm.ShutDown();
+  ASSERT_EQ(0, stat(db_file.c_str(), &stat_buf));
+  EXPECT_EQ(5 * PAGE_SIZE, stat_buf.st_size);
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, AsyncReadWritePageTest) {
+  const int num_threads = 8;
+  const page_id_t pages_per_thread = 32;
+  std::string db_file("test.db");
+  // Once through io_uring, where the kernel has it, and once through the thread pool.
+  for (bool io_uring : {true, false}) {
+    remove("test.db");
+    enable_io_uring = io_uring;
+    auto dm = FileDiskManager(db_file);
+    ASSERT_NE(nullptr, dm.GetIOEngine());
+
+    std::vector<std::vector<char>> data(num_threads * pages_per_thread, std::vector<char>(PAGE_SIZE));
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&dm, &data, tid] {
+        std::vector<std::future<void>> writes;
+        for (page_id_t i = 0; i < pages_per_thread; i++) {
+          page_id_t page_id = i * num_threads + tid;
+          std::memset(data[page_id].data(), page_id, PAGE_SIZE);
+          writes.push_back(dm.WritePageAsync(page_id, data[page_id].data()));
+        }
+        for (auto &write : writes) {
+          write.wait();
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumWrites());
+    if (io_uring && dynamic_cast<IoUringIOEngine *>(dm.GetIOEngine()) != nullptr) {
+      // Writes submitted by many threads at once share io_uring_enter calls.
+      EXPECT_LT(dm.GetIOEngine()->GetNumSubmitCalls(), static_cast<uint64_t>(num_threads * pages_per_thread));
+    }
+
+    // Read everything back, through callbacks this time.
+    std::vector<char> buf(num_threads * pages_per_thread * PAGE_SIZE);
+    std::atomic<int> num_reads = 0;
+    std::promise<void> done;
+    for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread; page_id++) {
+      dm.ReadPageAsync(page_id, buf.data() + page_id * PAGE_SIZE, [&num_reads, &done] {
+        if (++num_reads == num_threads * pages_per_thread) {
+          done.set_value();
+        }
+      });
+    }
+    done.get_future().wait();
+    for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread; page_id++) {
+      EXPECT_EQ(0, std::memcmp(buf.data() + page_id * PAGE_SIZE, data[page_id].data(), PAGE_SIZE));
+    }
+
+    // A page past the end of the file reads as zeroes, and the synchronous calls see the asynchronous writes.
+    std::vector<char> page(PAGE_SIZE, 1);
+    dm.ReadPageAsync(num_threads * pages_per_thread, page.data()).wait();
+    char zero[PAGE_SIZE] = {0};
+    EXPECT_EQ(0, std::memcmp(page.data(), zero, PAGE_SIZE));
+    dm.ReadPage(3, page.data());
+    EXPECT_EQ(0, std::memcmp(page.data(), data[3].data(), PAGE_SIZE));
+    dm.ShutDown();
+  }
+  enable_io_uring = true;
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, AsyncWriteLogTest) {
+  std::string db_file("test.db");
+  auto dm = FileDiskManager(db_file);
+  char first[16] = "first record";
+  char second[16] = "second record";
+  std::promise<void> first_done;
+  std::promise<void> second_done;
+  dm.WriteLogAsync(first, sizeof(first), [&first_done] { first_done.set_value(); });
+  dm.WriteLogAsync(second, sizeof(second), [&second_done] { second_done.set_value(); });
+  first_done.get_future().wait();
+  second_done.get_future().wait();
+  dm.WriteLog(first, sizeof(first));
+
+  // Appends land in the order they were made.
+  char buf[48] = {0};
+  EXPECT_TRUE(dm.ReadLog(buf, sizeof(buf), 0));
+  EXPECT_EQ(0, std::memcmp(buf, first, sizeof(first)));
+  EXPECT_EQ(0, std::memcmp(buf + 16, second, sizeof(second)));
+  EXPECT_EQ(0, std::memcmp(buf + 32, first, sizeof(first)));
+  EXPECT_EQ(3, dm.GetNumFlushes());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LogSegmentTest) {
+  std::string db_file("test.db");
+  std::string archive("test_log_archive");
+  StorageLayout layout;
+  layout.log_segment_size_ = 64;
+  std::vector<char> log(200);
+  for (size_t i = 0; i < log.size(); i++) {
+    log[i] = static_cast<char>(i);
+  }
+  struct stat stat_buf;
+  {
+    auto dm = FileDiskManager(db_file, DiskIOBackend::PREAD, layout);
+    // Writes that cross a segment boundary are split, synchronous or not.
+    dm.WriteLog(log.data(), 100);
+    std::promise<void> done;
+    dm.WriteLogAsync(log.data() + 100, 100, [&done] { done.set_value(); });
+    done.get_future().wait();
+    for (lsn_t start : {0, 64, 128, 192}) {
+      EXPECT_EQ(0, stat(dm.GetLogSegmentName(start).c_str(), &stat_buf));
+    }
+    EXPECT_EQ(dm.GetLogSegmentName(64), dm.GetLogSegmentName(127));
+    EXPECT_EQ("test.log.0000000000000040", dm.GetLogSegmentName(100));
+    dm.ShutDown();
+  }
+
+  // A reopened log continues where its last segment ends, and reads span segments.
+  layout.log_archive_directory_ = archive;
+  auto dm = FileDiskManager(db_file, DiskIOBackend::PREAD, layout);
+  dm.WriteLog(log.data(), 50);
+  std::vector<char> buf(300, 1);
+  EXPECT_TRUE(dm.ReadLog(buf.data(), static_cast<int>(buf.size()), 0));
+  EXPECT_EQ(0, std::memcmp(buf.data(), log.data(), log.size()));
+  EXPECT_EQ(0, std::memcmp(buf.data() + log.size(), log.data(), 50));
+  EXPECT_EQ(std::vector<char>(50, 0), std::vector<char>(buf.begin() + 250, buf.end()));
+  EXPECT_FALSE(dm.ReadLog(buf.data(), 10, 250));
+
+  // Only whole segments below the LSN are retired, into the archive.
+  EXPECT_EQ(2, dm.TruncateLog(150));
+  EXPECT_EQ(0, dm.TruncateLog(150));
+  EXPECT_NE(0, stat(dm.GetLogSegmentName(0).c_str(), &stat_buf));
+  EXPECT_EQ(0, stat((archive + "/" + dm.GetLogSegmentName(64)).c_str(), &stat_buf));
+  EXPECT_FALSE(dm.ReadLog(buf.data(), 10, 100));
+  EXPECT_TRUE(dm.ReadLog(buf.data(), 100, 128));
+  EXPECT_EQ(0, std::memcmp(buf.data(), log.data() + 128, 72));
+  dm.ShutDown();
+
+  // A fresh database starts a fresh log.
+  remove(db_file.c_str());
+  auto fresh = FileDiskManager(db_file, DiskIOBackend::PREAD, layout);
+  EXPECT_FALSE(fresh.ReadLog(buf.data(), 10, 128));
+  EXPECT_NE(0, stat(fresh.GetLogSegmentName(128).c_str(), &stat_buf));
+  fresh.ShutDown();
+  for (lsn_t start : {0, 64}) {
+    remove((archive + "/" + fresh.GetLogSegmentName(start)).c_str());
+  }
+  rmdir(archive.c_str());
+}
+
+/** Write pages through every path of a disk manager, with aligned and unaligned buffers, and read them back. */
+static void CheckRoundTrips(DiskManager *dm) {
+  std::shared_ptr<char> aligned(static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, PAGE_SIZE)), std::free);
+  std::vector<char> unaligned_storage(PAGE_SIZE + 1);
+  char *unaligned = unaligned_storage.data() + 1;
+  for (page_id_t page_id = 0; page_id < 8; page_id++) {
+    char *data = page_id % 2 == 0 ? aligned.get() : unaligned;
+    std::memset(data, 'a' + page_id, PAGE_SIZE);
+    if (page_id < 4) {
+      dm->WritePage(page_id, data);
+    } else {
+      dm->WritePageAsync(page_id, data).wait();
+    }
+  }
+  for (page_id_t page_id = 0; page_id < 8; page_id++) {
+    char *data = page_id % 3 == 0 ? aligned.get() : unaligned;
+    std::memset(data, 0, PAGE_SIZE);
+    if (page_id % 2 == 0) {
+      dm->ReadPage(page_id, data);
+    } else {
+      dm->ReadPageAsync(page_id, data).wait();
+    }
+    EXPECT_EQ('a' + page_id, data[0]);
+    EXPECT_EQ('a' + page_id, data[PAGE_SIZE - 1]);
+  }
+  dm->Sync();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DirectIOTest) {
+  std::string db_file("test.db");
+  {
+    auto dm = FileDiskManager(db_file, DiskIOBackend::DIRECT);
+    CheckRoundTrips(&dm);
+    dm.ShutDown();
+  }
+  // What went through O_DIRECT (if the filesystem took it) reads back through the page cache.
+  {
+    auto dm = FileDiskManager(db_file, DiskIOBackend::PREAD);
+    EXPECT_FALSE(dm.IsDirectIO());
+    char buf[PAGE_SIZE];
+    dm.ReadPage(5, buf);
+    EXPECT_EQ('a' + 5, buf[PAGE_SIZE / 2]);
+    dm.ShutDown();
+  }
+
+  // tmpfs rejects O_DIRECT before Linux 6.6, in which case the disk manager goes through the page cache instead.
+  struct stat stat_buf;
+  if (stat("/dev/shm", &stat_buf) == 0 && S_ISDIR(stat_buf.st_mode)) {
+    std::string shm_file("/dev/shm/bustub_direct_io_test.db");
+    remove(shm_file.c_str());
+    {
+      auto dm = FileDiskManager(shm_file, DiskIOBackend::DIRECT);
+      CheckRoundTrips(&dm);
+      dm.ShutDown();
+    }
+    remove(shm_file.c_str());
+    remove("/dev/shm/bustub_direct_io_test.log");
+    remove("/dev/shm/bustub_direct_io_test.fsm");
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ReadPagesWritePagesTest) {
+  for (auto backend : {DiskIOBackend::FSTREAM, DiskIOBackend::PREAD, DiskIOBackend::DIRECT}) {
+    remove("test.db");
+    std::string db_file("test.db");
+    auto dm = FileDiskManager(db_file, backend);
+    const page_id_t num_pages = 12;
+    // Aligned, so that O_DIRECT runs need no bounce buffers.
+    std::shared_ptr<char> data(static_cast<char *>(std::aligned_alloc(DIRECT_IO_ALIGNMENT, num_pages * PAGE_SIZE)),
+                               std::free);
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      std::memset(data.get() + page_id * PAGE_SIZE, 'a' + page_id, PAGE_SIZE);
+    }
+
+    // Pages 0..3 and 6..9, shuffled, make two runs. Of the two writes of page 2, the later one wins.
+    std::vector<char> stale(PAGE_SIZE, 'z');
+    std::vector<std::pair<page_id_t, const char *>> writes;
+    for (page_id_t page_id : {7, 2, 0, 9, 3, 6, 1, 8}) {
+      if (page_id == 2) {
+        writes.emplace_back(page_id, stale.data());
+      }
+      writes.emplace_back(page_id, data.get() + page_id * PAGE_SIZE);
+    }
+    int calls_before = dm.GetNumWriteCalls();
+    dm.WritePages(writes);
+    EXPECT_EQ(8, dm.GetNumWrites());
+    if (backend != DiskIOBackend::FSTREAM) {
+      EXPECT_EQ(2, dm.GetNumWriteCalls() - calls_before);
+    }
+
+    // Pages 8..11 straddle the end of the file: the missing ones read as zeroes.
+    std::vector<char> buf(num_pages * PAGE_SIZE, 'x');
+    std::vector<std::pair<page_id_t, char *>> reads;
+    for (page_id_t page_id : {11, 4, 0, 8, 2, 10, 9, 1, 3}) {
+      reads.emplace_back(page_id, buf.data() + page_id * PAGE_SIZE);
+    }
+    dm.ReadPages(reads);
+    for (page_id_t page_id : {0, 1, 2, 3, 8, 9}) {
+      EXPECT_EQ(0, std::memcmp(buf.data() + page_id * PAGE_SIZE, data.get() + page_id * PAGE_SIZE, PAGE_SIZE));
+    }
+    for (page_id_t page_id : {4, 10, 11}) {
+      EXPECT_EQ(0, buf[page_id * PAGE_SIZE]);
+      EXPECT_EQ(0, buf[(page_id + 1) * PAGE_SIZE - 1]);
+    }
+    // Page 5 was not asked for.
+    EXPECT_EQ('x', buf[5 * PAGE_SIZE]);
+    dm.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargeFileTest) {
+  // Pages past the 4 GB offset, written into a sparse file so that the test needs almost no disk space.
+  const page_id_t far_page_id = static_cast<page_id_t>((int64_t{1} << 32) / PAGE_SIZE) + 5;
+  for (auto backend : {DiskIOBackend::FSTREAM, DiskIOBackend::PREAD}) {
+    remove("test.db");
+    std::string db_file("test.db");
+    char data[PAGE_SIZE];
+    char buf[PAGE_SIZE];
+    {
+      auto dm = FileDiskManager(db_file, backend);
+      for (page_id_t page_id : {0, far_page_id, far_page_id + 1}) {
+        std::memset(data, 'a' + page_id % 26, PAGE_SIZE);
+        dm.WritePage(page_id, data);
+      }
+      dm.ShutDown();
+    }
+    struct stat stat_buf;
+    ASSERT_EQ(0, stat("test.db", &stat_buf));
+    EXPECT_EQ(static_cast<int64_t>(far_page_id + 2) * PAGE_SIZE, static_cast<int64_t>(stat_buf.st_size));
+
+    auto dm = FileDiskManager(db_file, backend);
+    for (page_id_t page_id : {0, far_page_id, far_page_id + 1}) {
+      std::memset(buf, 0, PAGE_SIZE);
+      dm.ReadPage(page_id, buf);
+      EXPECT_EQ('a' + page_id % 26, buf[0]);
+      EXPECT_EQ('a' + page_id % 26, buf[PAGE_SIZE - 1]);
+    }
+    // The hole reads back as zeroes, and a batch read crosses the 4 GB offset.
+    std::vector<char> batch(3 * PAGE_SIZE, 'x');
+    dm.ReadPages({{far_page_id - 1, batch.data()},
+                  {far_page_id, batch.data() + PAGE_SIZE},
+                  {far_page_id + 1, batch.data() + 2 * PAGE_SIZE}});
+    EXPECT_EQ(0, batch[0]);
+    EXPECT_EQ('a' + far_page_id % 26, batch[PAGE_SIZE]);
+    EXPECT_EQ('a' + (far_page_id + 1) % 26, batch[3 * PAGE_SIZE - 1]);
+    dm.ShutDown();
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, SegmentedLayoutTest) {
+  // Segments of 4 pages: test.db holds pages 0..3, and later segments alternate between the two directories.
+  std::vector<std::string> directories{"test_segments_a", "test_segments_b"};
+  auto remove_segments = [&directories] {
+    for (size_t i = 1; i <= 4; i++) {
+      remove((directories[(i - 1) % 2] + "/test.db." + std::to_string(i)).c_str());
+    }
+    for (const auto &directory : directories) {
+      rmdir(directory.c_str());
+    }
+  };
+  remove_segments();
+  for (const auto &directory : directories) {
+    ASSERT_EQ(0, mkdir(directory.c_str(), 0755));
+  }
+  StorageLayout layout;
+  layout.segment_pages_ = 4;
+  layout.directories_ = directories;
+  std::string db_file("test.db");
+  const page_id_t num_pages = 14;
+  char data[PAGE_SIZE];
+  {
+    // FSTREAM cannot do segments and is replaced by PREAD.
+    auto dm = FileDiskManager(db_file, DiskIOBackend::FSTREAM, layout);
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      EXPECT_EQ(page_id, dm.AllocatePage());
+    }
+    for (page_id_t page_id = 0; page_id < 6; page_id++) {
+      std::memset(data, 'a' + page_id, PAGE_SIZE);
+      dm.WritePage(page_id, data);
+    }
+    std::memset(data, 'a' + 6, PAGE_SIZE);
+    dm.WritePageAsync(6, data).wait();
+    // A batch of 7..13 is split at the segment boundaries 8 and 12.
+    std::vector<char> batch((num_pages - 7) * PAGE_SIZE);
+    std::vector<std::pair<page_id_t, const char *>> writes;
+    for (page_id_t page_id = 7; page_id < num_pages; page_id++) {
+      std::memset(batch.data() + (page_id - 7) * PAGE_SIZE, 'a' + page_id, PAGE_SIZE);
+      writes.emplace_back(page_id, batch.data() + (page_id - 7) * PAGE_SIZE);
+    }
+    int calls_before = dm.GetNumWriteCalls();
+    dm.WritePages(writes);
+    EXPECT_EQ(3, dm.GetNumWriteCalls() - calls_before);
+    dm.ShutDown();
+  }
+
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_EQ(4 * PAGE_SIZE, stat_buf.st_size);
+  ASSERT_EQ(0, stat("test_segments_a/test.db.1", &stat_buf));
+  EXPECT_EQ(4 * PAGE_SIZE, stat_buf.st_size);
+  ASSERT_EQ(0, stat("test_segments_b/test.db.2", &stat_buf));
+  EXPECT_EQ(4 * PAGE_SIZE, stat_buf.st_size);
+  ASSERT_EQ(0, stat("test_segments_a/test.db.3", &stat_buf));
+  EXPECT_EQ(2 * PAGE_SIZE, stat_buf.st_size);
+  EXPECT_NE(0, stat("test_segments_b/test.db.4", &stat_buf));
+
+  {
+    auto dm = FileDiskManager(db_file, DiskIOBackend::PREAD, layout);
+    char buf[PAGE_SIZE];
+    for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+      std::memset(buf, 0, PAGE_SIZE);
+      if (page_id % 2 == 0) {
+        dm.ReadPage(page_id, buf);
+      } else {
+        dm.ReadPageAsync(page_id, buf).wait();
+      }
+      EXPECT_EQ('a' + page_id, buf[0]);
+      EXPECT_EQ('a' + page_id, buf[PAGE_SIZE - 1]);
+    }
+    // Reads past the last page, even in a segment that does not exist, come back as zeroes.
+    std::vector<char> batch(4 * PAGE_SIZE, 'x');
+    dm.ReadPages({{3, batch.data()}, {4, batch.data() + PAGE_SIZE}, {13, batch.data() + 2 * PAGE_SIZE},
+                  {16, batch.data() + 3 * PAGE_SIZE}});
+    EXPECT_EQ('a' + 3, batch[PAGE_SIZE - 1]);
+    EXPECT_EQ('a' + 4, batch[PAGE_SIZE]);
+    EXPECT_EQ('a' + 13, batch[3 * PAGE_SIZE - 1]);
+    EXPECT_EQ(0, batch[3 * PAGE_SIZE]);
+    EXPECT_NE(0, stat("test_segments_b/test.db.4", &stat_buf));
+
+    // Compaction cuts back every segment past the last allocated page.
+    for (page_id_t page_id = 6; page_id < num_pages; page_id++) {
+      dm.DeallocatePage(page_id);
+    }
+    EXPECT_EQ(8, dm.Compact());
+    dm.ShutDown();
+  }
+  ASSERT_EQ(0, stat("test_segments_a/test.db.1", &stat_buf));
+  EXPECT_EQ(2 * PAGE_SIZE, stat_buf.st_size);
+  ASSERT_EQ(0, stat("test_segments_b/test.db.2", &stat_buf));
+  EXPECT_EQ(0, stat_buf.st_size);
+
+  // A fresh database of the same name starts without the old segments.
+  remove("test.db");
+  {
+    auto dm = FileDiskManager(db_file, DiskIOBackend::PREAD, layout);
+    dm.ShutDown();
+  }
+  EXPECT_NE(0, stat("test_segments_a/test.db.1", &stat_buf));
+  remove_segments();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, MemoryDiskManagerTest) {
+  MemoryDiskManager dm;
+  char data[PAGE_SIZE];
+  char buf[PAGE_SIZE];
+  std::memset(buf, 'x', PAGE_SIZE);
+  dm.ReadPage(3, buf);  // never written pages read as zeroes
+  EXPECT_EQ(0, buf[0]);
+
+  for (page_id_t page_id = 0; page_id < 4; page_id++) {
+    EXPECT_EQ(page_id, dm.AllocatePage());
+    std::memset(data, 'a' + page_id, PAGE_SIZE);
+    if (page_id % 2 == 0) {
+      dm.WritePage(page_id, data);
+    } else {
+      dm.WritePageAsync(page_id, data).wait();
+    }
+  }
+  for (page_id_t page_id = 0; page_id < 4; page_id++) {
+    dm.ReadPageAsync(page_id, buf).wait();
+    EXPECT_EQ('a' + page_id, buf[PAGE_SIZE - 1]);
+  }
+  std::vector<char> batch(2 * PAGE_SIZE);
+  dm.ReadPages({{2, batch.data()}, {1, batch.data() + PAGE_SIZE}});
+  EXPECT_EQ('c', batch[0]);
+  EXPECT_EQ('b', batch[PAGE_SIZE]);
+  EXPECT_EQ(4, dm.GetNumWrites());
+
+  // The free page map works without a file.
+  dm.DeallocatePage(1);
+  EXPECT_FALSE(dm.IsAllocated(1));
+  EXPECT_EQ(1, dm.AllocatePage());
+
+  char log[16] = "log record";
+  dm.WriteLog(log, sizeof(log));
+  char log_buf[32];
+  EXPECT_TRUE(dm.ReadLog(log_buf, sizeof(log_buf), 0));
+  EXPECT_EQ(0, std::strcmp(log, log_buf));
+  EXPECT_FALSE(dm.ReadLog(log_buf, sizeof(log_buf), sizeof(log)));
+  // Asynchronous appends count as flushes, like synchronous ones.
+  dm.WriteLogAsync(log, sizeof(log), [] {});
+  EXPECT_EQ(2, dm.GetNumFlushes());
+  EXPECT_TRUE(dm.ReadLog(log_buf, sizeof(log_buf), sizeof(log)));
+  EXPECT_EQ(0, std::strcmp(log, log_buf));
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, InjectedLatencyTest) {
+  using std::chrono::microseconds;
+  std::mt19937_64 rng(15445);
+  InjectedLatency fixed{LatencyDistribution::FIXED, microseconds(100), microseconds(0)};
+  InjectedLatency uniform{LatencyDistribution::UNIFORM, microseconds(100), microseconds(200)};
+  InjectedLatency pareto{LatencyDistribution::PARETO, microseconds(100), microseconds(100000), 1.1};
+  std::vector<int64_t> pareto_samples;
+  for (int i = 0; i < 10000; i++) {
+    EXPECT_EQ(100, fixed.Sample(&rng).count());
+    auto latency = uniform.Sample(&rng).count();
+    EXPECT_LE(100, latency);
+    EXPECT_GE(200, latency);
+    pareto_samples.push_back(pareto.Sample(&rng).count());
+  }
+  std::sort(pareto_samples.begin(), pareto_samples.end());
+  EXPECT_LE(100, pareto_samples.front());
+  EXPECT_GE(100000, pareto_samples.back());
+  // Most requests are fast, but the tail is long.
+  EXPECT_GT(200, pareto_samples[pareto_samples.size() / 2]);
+  EXPECT_LT(2000, pareto_samples[pareto_samples.size() * 99 / 100]);
+
+  // The same seed draws the same latencies.
+  std::mt19937_64 rng_a(7);
+  std::mt19937_64 rng_b(7);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(pareto.Sample(&rng_a), pareto.Sample(&rng_b));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FaultInjectingDiskManagerTest) {
+  MemoryDiskManager memory;
+  InjectedFaults faults;
+  faults.write_latency_ = {LatencyDistribution::FIXED, std::chrono::microseconds(1000), std::chrono::microseconds(0)};
+  faults.write_error_rate_ = 0.5;
+  faults.seed_ = 15445;
+  FaultInjectingDiskManager dm(&memory, faults);
+
+  const page_id_t num_pages = 100;
+  char data[PAGE_SIZE];
+  std::memset(data, 'a', PAGE_SIZE);
+  auto start = std::chrono::steady_clock::now();
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    EXPECT_EQ(page_id, dm.AllocatePage());
+    dm.WritePage(page_id, data);
+  }
+  EXPECT_LE(std::chrono::milliseconds(num_pages), std::chrono::steady_clock::now() - start);
+  EXPECT_EQ(num_pages, dm.GetNumWrites());
+  EXPECT_TRUE(memory.IsAllocated(num_pages - 1));
+
+  // Failed writes never reached the wrapped disk manager.
+  auto errors = dm.GetNumInjectedErrors();
+  EXPECT_LT(num_pages / 4, errors);
+  EXPECT_GT(num_pages * 3 / 4, errors);
+  EXPECT_EQ(num_pages - errors, memory.GetNumWrites());
+  char buf[PAGE_SIZE];
+  uint64_t lost = 0;
+  for (page_id_t page_id = 0; page_id < num_pages; page_id++) {
+    dm.ReadPage(page_id, buf);
+    lost += buf[0] == 0 ? 1 : 0;
+  }
+  EXPECT_EQ(errors, lost);
+
+  // A failed read leaves its buffer alone.
+  faults.read_error_rate_ = 1;
+  faults.write_latency_ = {};
+  FaultInjectingDiskManager failing(&memory, faults);
+  std::memset(buf, 'x', PAGE_SIZE);
+  failing.ReadPage(0, buf);
+  EXPECT_EQ('x', buf[0]);
+  EXPECT_EQ(1, failing.GetNumInjectedErrors());
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ThrowBadFileTest) {
+  EXPECT_THROW(FileDiskManager("dev/null\\/foo/bar/baz/test.db"), Exception);
+}
 
 }  // namespace bustub
@@ -0,0 +1,180 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// index_iterator_test.cpp
+//
+// Identification: test/storage/index_iterator_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+#include "storage/disk/file_disk_manager.h"
+#include "storage/index/b_plus_tree.h"
+#include "test_util.h"  // NOLINT
+
+namespace bustub {
+
+using LeafPage = BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
+
+// NOLINTNEXTLINE
+TEST(IndexIteratorTest, SiblingChainPrefetchTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  const int num_leaves = 8;
+  const int keys_per_leaf = 10;
+
+  auto *disk_manager = new FileDiskManager("test.db");
+  std::vector<page_id_t> leaf_page_ids;
+  {
+    // Build a chain of leaves by hand, with an empty leaf in the middle, and persist it.
+    BufferPoolManagerInstance bpm(num_leaves, disk_manager);
+    std::vector<LeafPage *> leaves;
+    for (int i = 0; i < num_leaves; ++i) {
+      page_id_t page_id;
+      auto *leaf = reinterpret_cast<LeafPage *>(bpm.NewPage(&page_id)->GetData());
+      leaf->Init(page_id);
+      if (i != num_leaves / 2) {
+        // Insert out of order; the leaf keeps its entries sorted.
+        for (int j = keys_per_leaf - 1; j >= 0; --j) {
+          GenericKey<8> key;
+          int64_t value = i * keys_per_leaf + j;
+          key.SetFromInteger(value);
+          leaf->Insert(key, RID(page_id, value), comparator);
+        }
+      }
+      if (!leaves.empty()) {
+        leaves.back()->SetNextPageId(page_id);
+      }
+      leaves.push_back(leaf);
+      leaf_page_ids.push_back(page_id);
+    }
+    for (auto page_id : leaf_page_ids) {
+      bpm.UnpinPage(page_id, true);
+    }
+    bpm.FlushAllPages();
+  }
+
+  auto *bpm = new BufferPoolManagerInstance(num_leaves, disk_manager);
+  using Iterator = IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
+  int64_t expected = 0;
+  for (Iterator iterator(bpm, leaf_page_ids[0], 0); iterator != Iterator(); ++iterator) {
+    if (expected == num_leaves / 2 * keys_per_leaf) {
+      expected += keys_per_leaf;
+    }
+    EXPECT_EQ(expected, (*iterator).second.GetSlotNum());
+    expected++;
+    // Give the prefetch threads time to read the next leaf before the iterator gets there.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(num_leaves * keys_per_leaf, expected);
+  // Every leaf but the first one was requested ahead of time.
+  EXPECT_EQ(num_leaves - 1, bpm->GetPrefetchHitCount() + bpm->GetPrefetchMissCount());
+  EXPECT_GT(bpm->GetPrefetchHitCount(), 0);
+
+  // Starting past the end of a leaf moves on to the next one, and the iterator releases every page it pinned.
+  {
+    Iterator iterator(bpm, leaf_page_ids[0], keys_per_leaf);
+    EXPECT_EQ(keys_per_leaf, (*iterator).second.GetSlotNum());
+  }
+  for (auto page_id : leaf_page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    bpm->UnpinPage(page_id, false);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+/** A buffer pool that remembers the batches of pages it was asked to prefetch. */
+class RecordingBufferPoolManager : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+
+  std::vector<std::vector<page_id_t>> prefetches_;
+
+ protected:
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, AccessHint hint) override {
+    prefetches_.push_back(page_ids);
+    BufferPoolManagerInstance::PrefetchPgsImp(page_ids, hint);
+  }
+};
+
+// NOLINTNEXTLINE
+TEST(IndexIteratorTest, PrefetchWindowTest) {
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+  const int num_leaves = 12;
+  const size_t window = 4;
+
+  auto *disk_manager = new FileDiskManager("test.db");
+  auto *bpm = new RecordingBufferPoolManager(num_leaves, disk_manager);
+  bpm->SetPrefetchWindow(window);
+  // A chain of leaves with one entry each, all of them resident.
+  std::vector<page_id_t> leaf_page_ids;
+  LeafPage *last = nullptr;
+  for (int i = 0; i < num_leaves; ++i) {
+    page_id_t page_id;
+    auto *leaf = reinterpret_cast<LeafPage *>(bpm->NewPage(&page_id)->GetData());
+    leaf->Init(page_id);
+    GenericKey<8> key;
+    key.SetFromInteger(i);
+    leaf->Insert(key, RID(page_id, i), comparator);
+    if (last != nullptr) {
+      last->SetNextPageId(page_id);
+    }
+    last = leaf;
+    leaf_page_ids.push_back(page_id);
+  }
+  for (auto page_id : leaf_page_ids) {
+    bpm->UnpinPage(page_id, true);
+  }
+
+  using Iterator = IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
+  int count = 0;
+  for (Iterator iterator(bpm, leaf_page_ids[0], 0); iterator != Iterator(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(num_leaves, count);
+  // The first leaf asks for the whole window at once, since the leaves in it are resident and can be followed. Every
+  // later leaf asks for the one leaf that slides into the window, until the window reaches the end of the chain.
+  ASSERT_EQ(num_leaves - window, bpm->prefetches_.size());
+  EXPECT_EQ(std::vector<page_id_t>(leaf_page_ids.begin() + 1, leaf_page_ids.begin() + 1 + window), bpm->prefetches_[0]);
+  for (size_t i = 1; i < bpm->prefetches_.size(); ++i) {
+    EXPECT_EQ(std::vector<page_id_t>{leaf_page_ids[window + i]}, bpm->prefetches_[i]);
+  }
+
+  // Peeking at the window does not pin anything for good.
+  for (auto page_id : leaf_page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(1, page->GetPinCount());
+    bpm->UnpinPage(page_id, false);
+  }
+
+  // Without a window nothing is prefetched.
+  bpm->prefetches_.clear();
+  bpm->SetPrefetchWindow(0);
+  for (Iterator iterator(bpm, leaf_page_ids[0], 0); iterator != Iterator(); ++iterator) {
+  }
+  EXPECT_TRUE(bpm->prefetches_.empty());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -11,14 +11,18 @@
 //===----------------------------------------------------------------------===//
 
 #include <algorithm>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
 #include "gtest/gtest.h"
 #include "logging/common.h"
+#include "storage/disk/file_disk_manager.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
 
@@ -38,7 +42,7 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
 
   // create transaction
   auto *transaction = new Transaction(0);
-  auto *disk_manager = new DiskManager("test.db");
+  auto *disk_manager = new FileDiskManager("test.db");
   auto *buffer_pool_manager = new BufferPoolManagerInstance(50, disk_manager);
   auto *lock_manager = new LockManager();
   auto *log_manager = new LogManager(disk_manager);
@@ -71,4 +75,193 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, ColdScanPrefetchTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Column col3{"c", TypeId::BIGINT};
+  Column col4{"d", TypeId::BOOLEAN};
+  Column col5{"e", TypeId::VARCHAR, 16};
+  std::vector<Column> cols{col1, col2, col3, col4, col5};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+  const int num_tuples = 5000;
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new FileDiskManager("test.db");
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  page_id_t first_page_id;
+  {
+    // Large enough to hold the whole table, so that loading it does not hit the disk.
+    BufferPoolManagerInstance buffer_pool_manager(1000, disk_manager);
+    TableHeap table(&buffer_pool_manager, lock_manager, log_manager, transaction);
+    RID rid;
+    for (int i = 0; i < num_tuples; ++i) {
+      ASSERT_TRUE(table.InsertTuple(tuple, &rid, transaction));
+    }
+    first_page_id = table.GetFirstPageId();
+    buffer_pool_manager.FlushAllPages();
+  }
+
+  // Every scan starts from an empty buffer pool, so each page of the table has to be read.
+  for (bool prefetch : {false, true}) {
+    BufferPoolManagerInstance buffer_pool_manager(50, disk_manager);
+    buffer_pool_manager.SetPrefetchEnabled(prefetch);
+    TableHeap table(&buffer_pool_manager, lock_manager, log_manager, first_page_id);
+    auto start = std::chrono::steady_clock::now();
+    int count = 0;
+    for (auto itr = table.Begin(transaction, AccessHint::SEQUENTIAL_SCAN); itr != table.End(); ++itr) {
+      count++;
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(num_tuples, count);
+    printf("cold scan %s prefetch: %.2f ms, %zu prefetch hits, %zu prefetch misses\n", prefetch ? "with" : "without",
+           elapsed, buffer_pool_manager.GetPrefetchHitCount(), buffer_pool_manager.GetPrefetchMissCount());
+    if (prefetch) {
+      // Every page but the first is requested ahead of time, whether or not the read finished before the scan got
+      // there.
+      EXPECT_GT(buffer_pool_manager.GetPrefetchHitCount() + buffer_pool_manager.GetPrefetchMissCount(), 0);
+    } else {
+      EXPECT_EQ(0, buffer_pool_manager.GetPrefetchHitCount() + buffer_pool_manager.GetPrefetchMissCount());
+    }
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete log_manager;
+  delete lock_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
+/** A buffer pool that remembers the batches of pages it was asked to prefetch. */
+class RecordingBufferPoolManager : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+
+  std::vector<std::vector<page_id_t>> prefetches_;
+
+ protected:
+  void PrefetchPgsImp(const std::vector<page_id_t> &page_ids, AccessHint hint) override {
+    prefetches_.push_back(page_ids);
+    BufferPoolManagerInstance::PrefetchPgsImp(page_ids, hint);
+  }
+};
+
+// NOLINTNEXTLINE
+TEST(TupleTest, ScanPrefetchWindowTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+  const size_t window = 8;
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new FileDiskManager("test.db");
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *buffer_pool_manager = new RecordingBufferPoolManager(100, disk_manager);
+  buffer_pool_manager->SetPrefetchWindow(window);
+  TableHeap table(buffer_pool_manager, lock_manager, log_manager, transaction);
+  RID rid;
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_TRUE(table.InsertTuple(tuple, &rid, transaction));
+  }
+  std::vector<page_id_t> page_ids;
+  for (page_id_t page_id = table.GetFirstPageId(); page_id != INVALID_PAGE_ID;) {
+    page_ids.push_back(page_id);
+    auto *page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(page_id));
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+  ASSERT_GT(page_ids.size(), window + 1);
+
+  // The table is resident, so the window fills up as soon as the scan starts; after that each page asks for one more.
+  // Every page after the first is asked for exactly once, in chain order.
+  buffer_pool_manager->prefetches_.clear();
+  for (auto itr = table.Begin(transaction, AccessHint::SEQUENTIAL_SCAN); itr != table.End(); ++itr) {
+  }
+  ASSERT_FALSE(buffer_pool_manager->prefetches_.empty());
+  EXPECT_EQ(window, buffer_pool_manager->prefetches_[0].size());
+  std::vector<page_id_t> prefetched;
+  for (const auto &batch : buffer_pool_manager->prefetches_) {
+    prefetched.insert(prefetched.end(), batch.begin(), batch.end());
+  }
+  EXPECT_EQ(std::vector<page_id_t>(page_ids.begin() + 1, page_ids.end()), prefetched);
+
+  delete buffer_pool_manager;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete log_manager;
+  delete lock_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
+// NOLINTNEXTLINE
+TEST(TupleTest, TableHeapExtentTest) {
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  Column col3{"c", TypeId::BIGINT};
+  Column col4{"d", TypeId::BOOLEAN};
+  Column col5{"e", TypeId::VARCHAR, 16};
+  std::vector<Column> cols{col1, col2, col3, col4, col5};
+  Schema schema{cols};
+  Tuple tuple = ConstructTuple(&schema);
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new FileDiskManager("test.db");
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  for (size_t num_instances : {1, 3}) {
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager;
+    if (num_instances == 1) {
+      buffer_pool_manager = std::make_unique<BufferPoolManagerInstance>(100, disk_manager);
+    } else {
+      buffer_pool_manager = std::make_unique<ParallelBufferPoolManager>(num_instances, 50, disk_manager);
+    }
+    // Two tables that grow at the same time still get pages that follow each other on disk.
+    TableHeap table_a(buffer_pool_manager.get(), lock_manager, log_manager, transaction);
+    TableHeap table_b(buffer_pool_manager.get(), lock_manager, log_manager, transaction);
+    RID rid;
+    for (int i = 0; i < 5000; ++i) {
+      ASSERT_TRUE(table_a.InsertTuple(tuple, &rid, transaction));
+      ASSERT_TRUE(table_b.InsertTuple(tuple, &rid, transaction));
+    }
+    for (TableHeap *table : {&table_a, &table_b}) {
+      std::vector<page_id_t> page_ids;
+      for (page_id_t page_id = table->GetFirstPageId(); page_id != INVALID_PAGE_ID;) {
+        page_ids.push_back(page_id);
+        auto *page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(page_id));
+        ASSERT_NE(nullptr, page);
+        page->RLatch();
+        page_id_t next_page_id = page->GetNextPageId();
+        page->RUnlatch();
+        buffer_pool_manager->UnpinPage(page_id, false);
+        page_id = next_page_id;
+      }
+      ASSERT_GT(page_ids.size(), EXTENT_SIZE);
+      // Within an extent every page directly follows the one before it; a jump only happens into a new extent.
+      for (size_t i = 1; i < page_ids.size(); i++) {
+        if (page_ids[i] % EXTENT_SIZE != 0) {
+          EXPECT_EQ(page_ids[i - 1] + 1, page_ids[i]);
+        }
+      }
+    }
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete log_manager;
+  delete lock_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
 }  // namespace bustub